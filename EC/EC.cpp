@@ -1,48 +1,20 @@
-// EC.cpp : This file contains the 'main' function. Program execution begins and ends there.
+// EC.cpp : Elliptic curve point arithmetic and EC ElGamal encryption.
 //
+#include "EC.h"
+#include "point64.h"
+#include "../common/op_counters.h"
+#include "../common/sha256.h"
 #include <iostream>
 #include <stdlib.h>
 #include <cmath>
 #include <stdbool.h>
-#include <ctime>
+#include <stdexcept>
+#include <cstring>
+#include <vector>
 
 using namespace std;
 
-struct ec_curve {
-    int a;
-    int b;
-    int p;
-};
-
-struct ec_point {
-    int x;
-    int y;
-};
-
-struct eea {
-    int r;
-    int s;
-    int t;
-};
-
-struct public_key {
-    ec_point Q;
-};
-
-struct private_key {
-    int d;
-};
-
-
-struct keys {
-    public_key pub_k;
-    private_key pr_k;
-};
-
-struct encrypted {
-    ec_point C1;
-    ec_point C2;
-};
+namespace ec {
 
 eea compute_eea(int r0, int r1) {
     int s0 = 1;
@@ -51,6 +23,7 @@ eea compute_eea(int r0, int r1) {
     int t1 = 1;
 
     while (r1 > 0) {
+        MATH241_COUNT(OP_EEA_ITERATION);
         int q = r0 / r1;
         int r2 = r0 - q * r1;
         int s2 = s0 - q * s1;
@@ -75,6 +48,7 @@ eea compute_eea(int r0, int r1) {
 
 
 int get_inverse(int a, int modular) {
+    MATH241_COUNT(OP_INVERSION);
     eea a_eea = compute_eea(modular, a);
 
     if (a_eea.r != 1) {
@@ -87,7 +61,8 @@ int get_inverse(int a, int modular) {
 
 
 /**
- * Performs point addition on two different points P and Q in an elliptic curve
+ * Performs point addition on two different points P and Q in an elliptic curve.
+ * Intermediates are 64-bit, so any prime p that fits an int works.
  *
  * @param P: An elliptic curve point represented as (x, y) coordinates.
  * @param Q: Differnt elliptic curve point represented as (x, y) coordinates.
@@ -96,13 +71,15 @@ int get_inverse(int a, int modular) {
  *          If the operation results in a point at infinity, (-1, -1) is returned.
  */
 ec_point point_addition(ec_point P, ec_point Q, ec_curve curve) {
-    
-    int x1 = P.x;
-    int y1 = P.y;
-    int x2 = Q.x;
-    int y2 = Q.y;
+    MATH241_COUNT(OP_POINT_ADD);
+
+    int64_t p = curve.p;
+    int64_t x1 = P.x;
+    int64_t y1 = P.y;
+    int64_t x2 = Q.x;
+    int64_t y2 = Q.y;
 
-    int den = x2 - x1;
+    int64_t den = mod_positive(x2 - x1, p);
 
     // checking if point at infinity is reached
     if (den == 0) {
@@ -112,42 +89,23 @@ ec_point point_addition(ec_point P, ec_point Q, ec_curve curve) {
         return new_p;
     }
 
-    if (den < 0) {
-        den += curve.p;
-    }
-
+    int64_t inv_den = mod_positive(get_inverse(static_cast<int>(den), curve.p), p);
 
-    int inv_den = get_inverse(den, curve.p);
-
-    int s = ((y2 - y1) * inv_den) % curve.p;
+    int64_t s = mod_positive(y2 - y1, p) * inv_den % p;
 
     ec_point new_p;
+    int64_t x3 = mod_positive(s * s - x1 - x2, p);
+    int64_t y3 = mod_positive(s * (x1 - x3) - y1, p);
 
-    int x3 = (static_cast<int>(pow(s, 2)) - x1 - x2) % curve.p;
-    int y3 = (s * (x1 - x3) - y1) % curve.p;
-
-    if (x3 < 0) {
-        while (x3 < 0) {
-            x3 += curve.p;
-        }
-    }
-
-    if (y3 < 0) {
-        while (y3 < 0) {
-            y3 += curve.p;
-        }
-    }
-
-    new_p.x = x3;
-    new_p.y = y3;
-
-
+    new_p.x = static_cast<int>(x3);
+    new_p.y = static_cast<int>(y3);
 
     return new_p;
 }
 
 /**
- * Performs point doubling on a point P in an elliptic curve
+ * Performs point doubling on a point P in an elliptic curve. Intermediates
+ * are 64-bit, so any prime p that fits an int works.
  *
  * @param P: An elliptic curve point represented as (x, y) coordinates.
  * @param curve: Parameters of the elliptic curve
@@ -155,9 +113,13 @@ ec_point point_addition(ec_point P, ec_point Q, ec_curve curve) {
  *          If the operation results in a point at infinity, (-1, -1) is returned.
  */
 ec_point point_doubling(ec_point P, ec_curve curve) {
-    int s;
+    MATH241_COUNT(OP_POINT_DOUBLE);
 
-    int den = 2 * P.y;
+    int64_t p = curve.p;
+    int64_t x = P.x;
+    int64_t y = P.y;
+
+    int64_t den = mod_positive(2 * y, p);
 
     if (den == 0) {
         ec_point new_p;
@@ -166,33 +128,17 @@ ec_point point_doubling(ec_point P, ec_curve curve) {
         return new_p;
     }
 
-    int inv_den = get_inverse(den, curve.p);
-
-    s = ((3 * pow(P.x, 2)) + curve.a) * inv_den;
+    int64_t inv_den = mod_positive(get_inverse(static_cast<int>(den), curve.p), p);
 
-    s %= curve.p;
+    int64_t num = mod_positive(3 * (x * x % p) + curve.a, p);
+    int64_t s = num * inv_den % p;
 
     ec_point new_p;
+    int64_t x3 = mod_positive(s * s - 2 * x, p);
+    int64_t y3 = mod_positive(s * (x - x3) - y, p);
 
-    int x3 = (static_cast<int>(pow(s, 2)) - P.x - P.x) % curve.p;
-    int y3 = (s * (P.x - x3) - P.y) % curve.p;
-
-    if (x3 < 0) {
-        while (x3 < 0) {
-            x3 += curve.p;
-        }
-    }
-
-    if (y3 < 0) {
-        while (y3 < 0) {
-            y3 += curve.p;
-        }
-    }
-
-    new_p.x = x3;
-    new_p.y = y3;
-
-
+    new_p.x = static_cast<int>(x3);
+    new_p.y = static_cast<int>(y3);
 
     return new_p;
 }
@@ -236,8 +182,13 @@ ec_point int_mult_point(ec_point P, int mult, ec_curve curve) {
  * @param P: An elliptic curve point represented as (x, y) coordinates.
  * @param curve: Parameters of the elliptic curve
  * @return: The additive inverse of the input point P, where the y-coordinate is negated.
+ *          The point at infinity is its own inverse.
  */
 ec_point point_inverse(ec_point P, ec_curve curve) {
+    if (is_infinity(P)) {
+        return P;
+    }
+
     P.y = -P.y;
 
     P.y %= curve.p;
@@ -260,14 +211,27 @@ ec_point point_inverse(ec_point P, ec_curve curve) {
  * @return: A structure containing the generated public and private keys.
  */
 keys generate_keys(ec_curve curve, ec_point P) {
-    srand(time(nullptr));
+    return generate_keys(curve, P, rng::thread_rng());
+}
 
-    ec_point Q;
-    int d;
-    do {
-        d = (rand() % (curve.p - 1)) + 1;
-        Q = int_mult_point(P, d, curve);
-    } while (Q.x == -1 and Q.y == -1);
+/**
+ * Generates public and private keys, drawing the private key from the given
+ * generator. d is uniform in [1, n) for the order n of P, so every key
+ * gives a distinct Q and none gives the point at infinity.
+ *
+ * @param curve: Parameters of the elliptic curve
+ * @param P: The base point on the elliptic curve.
+ * @param random: The random generator to draw from.
+ * @return: A structure containing the generated public and private keys.
+ */
+keys generate_keys(ec_curve curve, ec_point P, rng::chacha20_drbg& random) {
+    int n = point_order(P, curve);
+    if (n < 2) {
+        throw invalid_argument("the base point must be a point of the curve other than infinity");
+    }
+
+    int d = static_cast<int>(random.uniform(static_cast<uint32_t>(n - 1))) + 1;
+    ec_point Q = scalar_mult(P, d, curve);
 
     public_key pub_k;
     pub_k.Q = Q;
@@ -292,18 +256,33 @@ keys generate_keys(ec_curve curve, ec_point P) {
  * @return: A structure containing the encrypted message.
  */
 encrypted encryption(ec_curve curve, ec_point P, ec_point Q, ec_point M) {
+    return encryption(curve, P, Q, M, rng::thread_rng());
+}
+
+/**
+ * Performs encryption of a message, drawing the ephemeral key from the given
+ * generator.
+ *
+ * @param curve: Parameters of the elliptic curve including the prime modulus 'p'.
+ * @param P: The base point on the elliptic curve.
+ * @param Q: The public key point.
+ * @param M: The message point to be encrypted.
+ * @param random: The random generator to draw from.
+ * @return: A structure containing the encrypted message.
+ */
+encrypted encryption(ec_curve curve, ec_point P, ec_point Q, ec_point M, rng::chacha20_drbg& random) {
     ec_point C1;
     ec_point C2;
 
     int k;
-    k = rand() % (curve.p - 1) + 2;
+    k = static_cast<int>(random.uniform(curve.p - 1)) + 2;
 
     // first point of encrypted message
-    C1 = int_mult_point(P, k, curve);
+    C1 = scalar_mult(P, k, curve);
 
     // second point of encrypted message
-    C2 = int_mult_point(Q, k, curve);
-    C2 = point_addition(C2, M, curve);
+    C2 = scalar_mult(Q, k, curve);
+    C2 = point_sum(C2, M, curve);
 
     encrypted points;
     points.C1 = C1;
@@ -324,10 +303,10 @@ encrypted encryption(ec_curve curve, ec_point P, ec_point Q, ec_point M) {
 ec_point decryption(ec_curve curve, ec_point C1, ec_point C2, int d) {
     ec_point M;
 
-    ec_point mult_c1 = int_mult_point(C1, d, curve);
+    ec_point mult_c1 = scalar_mult(C1, d, curve);
     mult_c1 = point_inverse(mult_c1, curve);
 
-    M = point_addition(C2, mult_c1, curve);
+    M = point_sum(C2, mult_c1, curve);
     return M;
 }
 
@@ -365,6 +344,10 @@ int find_non_square(int n, int p) {
 
 
 ec_point rand_gen_point(ec_curve curve) {
+    return rand_gen_point(curve, rng::thread_rng());
+}
+
+ec_point rand_gen_point(ec_curve curve, rng::chacha20_drbg& random) {
 
     ec_point point;
 
@@ -376,7 +359,7 @@ ec_point rand_gen_point(ec_curve curve) {
     int a;
 
     while (true) {
-        x = rand() % curve.p;
+        x = static_cast<int>(random.uniform(curve.p));
         right = (static_cast<int>(pow(x, 3)) + (curve.a * x) + curve.b) % curve.p;
         bool has_res = euler_criterion(right, curve.p);
 
@@ -394,61 +377,645 @@ ec_point rand_gen_point(ec_curve curve) {
 
 }
 
+/**
+ * Checks whether a point is the point at infinity, stored as (-1, -1).
+ *
+ * @param P: An elliptic curve point.
+ * @return: True if P is the point at infinity.
+ */
+bool is_infinity(ec_point P) {
+    return P.x == -1 && P.y == -1;
+}
 
+/**
+ * Adds any two points of an elliptic curve. Unlike point_addition this also
+ * handles the point at infinity, P + P and P + (-P).
+ *
+ * @param P: An elliptic curve point, or (-1, -1).
+ * @param Q: An elliptic curve point, or (-1, -1).
+ * @param curve: Parameters of the elliptic curve
+ * @return: P + Q, or (-1, -1) if the sum is the point at infinity.
+ */
+ec_point point_sum(ec_point P, ec_point Q, ec_curve curve) {
+    if (is_infinity(P)) {
+        return Q;
+    }
+    if (is_infinity(Q)) {
+        return P;
+    }
+    if (P.x == Q.x) {
+        if (P.y == Q.y && P.y != 0) {
+            return point_doubling(P, curve);
+        }
+        ec_point inf;
+        inf.x = -1;
+        inf.y = -1;
+        return inf;
+    }
 
-int main()
-{
-    ec_curve curve;
-    curve.a = 0;
-    curve.b = 7;
-    curve.p = 17;
+    return point_addition(P, Q, curve);
+}
 
-    cout << "Elliptic Curve: " << endl;
-    cout << "y^2 = x^3 + " << curve.a << "x + " << curve.b << " (mod " << curve.p << ")" << endl;
+/**
+ * Fills a fixed-base table with P, 2P, 4P, ... so that any multiple of P
+ * is a sum of table entries. Stops early if a doubling reaches infinity.
+ *
+ * @param P: The base point.
+ * @param curve: Parameters of the elliptic curve
+ * @param table: Where the entries are written.
+ * @param max_size: The capacity of table.
+ * @return: The number of entries written.
+ */
+int build_fixed_base_table(ec_point P, ec_curve curve, ec_point* table, int max_size) {
+    int size = 0;
+    ec_point R = P;
+
+    while (size < max_size) {
+        table[size++] = R;
+        R = point_sum(R, R, curve);
+        if (is_infinity(R)) {
+            break;
+        }
+    }
 
-    ec_point point;
-    point.x = 8;
-    point.y = 3;
+    return size;
+}
+
+/**
+ * Performs scalar multiplication with a table from build_fixed_base_table,
+ * adding the entry for every set bit of the multiplier.
+ *
+ * @param table: The fixed-base table of the point.
+ * @param table_size: The number of entries in table.
+ * @param mult: The non-negative integer multiplier.
+ * @param curve: Parameters of the elliptic curve
+ * @return: mult times the base point, or (-1, -1) for the point at infinity.
+ */
+ec_point fixed_base_mult(const ec_point* table, int table_size, int mult, ec_curve curve) {
+    ec_point R;
+    R.x = -1;
+    R.y = -1;
+
+    for (int i = 0; i < table_size && (mult >> i) != 0; ++i) {
+        if ((mult >> i) & 1) {
+            R = point_sum(R, table[i], curve);
+        }
+    }
+
+    return R;
+}
+
+/**
+ * Checks whether a point satisfies the curve equation. The point at
+ * infinity does not count as being on the curve here.
+ *
+ * @param P: An elliptic curve point.
+ * @param curve: Parameters of the elliptic curve
+ * @return: True if P is a finite point of the curve.
+ */
+bool on_curve(ec_point P, ec_curve curve) {
+    if (P.x < 0 || P.x >= curve.p || P.y < 0 || P.y >= curve.p) {
+        return false;
+    }
+
+    long long p = curve.p;
+    long long right = ((long long)P.x * P.x % p * P.x + (long long)curve.a * P.x + curve.b) % p;
+    if (right < 0) {
+        right += p;
+    }
+
+    return (long long)P.y * P.y % p == right;
+}
+
+/**
+ * Performs scalar multiplication by double-and-add, so the cost grows with
+ * the bit length of the multiplier instead of its value like int_mult_point.
+ *
+ * @param P: An elliptic curve point, or (-1, -1).
+ * @param mult: The non-negative integer multiplier.
+ * @param curve: Parameters of the elliptic curve
+ * @return: mult times P, or (-1, -1) for the point at infinity.
+ */
+ec_point scalar_mult(ec_point P, int mult, ec_curve curve) {
+    ec_point R;
+    R.x = -1;
+    R.y = -1;
+
+    for (int bit = 30; bit >= 0; --bit) {
+        R = point_sum(R, R, curve);
+        if ((mult >> bit) & 1) {
+            R = point_sum(R, P, curve);
+        }
+    }
+
+    return R;
+}
+
+/**
+ * Computes aP + bQ in one pass over the bits of both multipliers (Shamir's
+ * trick): one doubling per bit plus at most one addition of P, Q or P + Q.
+ *
+ * @param P: The first point.
+ * @param a: The non-negative multiplier of P.
+ * @param Q: The second point.
+ * @param b: The non-negative multiplier of Q.
+ * @param curve: Parameters of the elliptic curve
+ * @return: aP + bQ, or (-1, -1) for the point at infinity.
+ */
+ec_point shamir_mult(ec_point P, int a, ec_point Q, int b, ec_curve curve) {
+    ec_point sum = point_sum(P, Q, curve);
+    ec_point R;
+    R.x = -1;
+    R.y = -1;
+
+    for (int bit = 30; bit >= 0; --bit) {
+        R = point_sum(R, R, curve);
+        int pick = ((a >> bit) & 1) | (((b >> bit) & 1) << 1);
+        if (pick == 1) {
+            R = point_sum(R, P, curve);
+        }
+        else if (pick == 2) {
+            R = point_sum(R, Q, curve);
+        }
+        else if (pick == 3) {
+            R = point_sum(R, sum, curve);
+        }
+    }
+
+    return R;
+}
+
+/**
+ * Computes the ECDH shared point d * peer_Q.
+ *
+ * @param peer_Q: The other party's public key.
+ * @param d: Our private key.
+ * @param curve: Parameters of the elliptic curve
+ * @return: The shared point, or (-1, -1) if peer_Q is not a valid public key.
+ */
+ec_point ecdh_shared_point(ec_point peer_Q, int d, ec_curve curve) {
+    if (!on_curve(peer_Q, curve)) {
+        ec_point inf;
+        inf.x = -1;
+        inf.y = -1;
+        return inf;
+    }
+
+    return scalar_mult(peer_Q, d, curve);
+}
+
+/**
+ * Derives an ECDH shared secret: SHA-256 of the x coordinate of the shared
+ * point, as a 4-byte big-endian integer.
+ *
+ * @param peer_Q: The other party's public key.
+ * @param d: Our private key.
+ * @param curve: Parameters of the elliptic curve
+ * @param secret: Receives the 32-byte secret.
+ * @return: False if peer_Q is invalid or the shared point is infinity.
+ */
+bool ecdh_shared_secret(ec_point peer_Q, int d, ec_curve curve, unsigned char secret[32]) {
+    ec_point S = ecdh_shared_point(peer_Q, d, curve);
+    if (is_infinity(S)) {
+        return false;
+    }
+
+    unsigned char x[4] = {
+        static_cast<unsigned char>(S.x >> 24), static_cast<unsigned char>(S.x >> 16),
+        static_cast<unsigned char>(S.x >> 8), static_cast<unsigned char>(S.x)
+    };
+    digest::sha256_digest(x, sizeof(x), secret);
+    return true;
+}
+
+int bit_length(int n) {
+    int bits = 0;
+    while (n >> bits) {
+        ++bits;
+    }
+    return bits;
+}
+
+/**
+ * RFC 6979 bits2int: the leftmost bit_length(n) bits of a byte string.
+ */
+int bits_to_int(const unsigned char* bytes, size_t len, int n) {
+    uint64_t top = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        top = top << 8 | (i < len ? bytes[i] : 0);
+    }
+    int qlen = bit_length(n);
+    if (len * 8 < static_cast<size_t>(qlen)) {
+        return static_cast<int>(top >> (64 - len * 8));
+    }
+    return static_cast<int>(top >> (64 - qlen));
+}
+
+/**
+ * RFC 6979 int2octets: x as a big-endian string of ceil(qlen / 8) bytes.
+ */
+size_t int_to_octets(int x, int n, unsigned char out[4]) {
+    size_t rlen = (bit_length(n) + 7) / 8;
+    for (size_t i = 0; i < rlen; ++i) {
+        out[i] = static_cast<unsigned char>(x >> (8 * (rlen - 1 - i)));
+    }
+    return rlen;
+}
+
+/**
+ * Inverse mod n of a value that may not have one.
+ *
+ * @return: The inverse in [1, n), or 0 if gcd(a, n) != 1.
+ */
+int inverse_or_zero(int a, int n) {
+    eea a_eea = compute_eea(n, a);
+    if (a_eea.r != 1) {
+        return 0;
+    }
+    int inv = a_eea.t % n;
+    return inv < 0 ? inv + n : inv;
+}
 
-    cout << "Point of Reference: " << endl;
-    cout << "(" << point.x << ", " << point.y << ")" << endl;
+/**
+ * Derives a deterministic ECDSA nonce from the private key and the message
+ * hash with HMAC-SHA256 (RFC 6979, section 3.2).
+ *
+ * @param n: The order of the base point.
+ * @param d: The private key, in [1, n).
+ * @param hash: The SHA-256 hash of the message.
+ * @param skip: How many candidates to skip, for when a nonce is rejected.
+ * @return: The nonce, in [1, n).
+ */
+int rfc6979_nonce(int n, int d, const unsigned char hash[32], int skip) {
+    unsigned char x_and_h[8];
+    size_t rlen = int_to_octets(d, n, x_and_h);
+    int h = bits_to_int(hash, 32, n) % n;
+    int_to_octets(h, n, x_and_h + rlen);
+
+    unsigned char V[32];
+    unsigned char K[32];
+    memset(V, 0x01, sizeof(V));
+    memset(K, 0x00, sizeof(K));
+
+    const unsigned char zero = 0x00;
+    const unsigned char one = 0x01;
+    digest::hmac_sha256(K, sizeof(K), V, sizeof(V), &zero, 1, x_and_h, 2 * rlen, K);
+    digest::hmac_sha256(K, sizeof(K), V, sizeof(V), V);
+    digest::hmac_sha256(K, sizeof(K), V, sizeof(V), &one, 1, x_and_h, 2 * rlen, K);
+    digest::hmac_sha256(K, sizeof(K), V, sizeof(V), V);
 
+    while (true) {
+        // qlen <= 31 bits, so one HMAC output is always enough
+        digest::hmac_sha256(K, sizeof(K), V, sizeof(V), V);
+        int k = bits_to_int(V, sizeof(V), n);
+        if (k >= 1 && k < n) {
+            if (skip == 0) {
+                return k;
+            }
+            --skip;
+        }
+        digest::hmac_sha256(K, sizeof(K), V, sizeof(V), &zero, 1, nullptr, 0, K);
+        digest::hmac_sha256(K, sizeof(K), V, sizeof(V), V);
+    }
+}
 
-    keys k = generate_keys(curve, point);
-    cout << "Public Key: " << endl;
-    cout << "Q = (" << k.pub_k.Q.x << ", " << k.pub_k.Q.y << ")" << endl;
+// Nonces tried before ecdsa_sign gives up. With n = 3, for example, kP
+// and -kP share an x coordinate divisible by n and no nonce works.
+const int ECDSA_MAX_NONCES = 64;
 
-    cout << "Private Key:" << endl;
-    cout << "d = " << k.pr_k.d << endl;
+/**
+ * Signs a message with ECDSA over SHA-256 and a deterministic nonce.
+ *
+ * @param curve: Parameters of the elliptic curve
+ * @param P: The base point.
+ * @param n: The order of P. Signing needs n prime, or at least the nonce
+ *           and signature coprime to n.
+ * @param d: The private key; it is reduced mod n.
+ * @param message: The message to sign.
+ * @return: The signature, or (0, 0) if d is 0 mod n or no nonce gives a
+ *          valid signature, which only happens for very small n.
+ */
+ecdsa_signature ecdsa_sign(ec_curve curve, ec_point P, int n, int d, const std::string& message) {
+    ecdsa_signature sig;
+    sig.r = 0;
+    sig.s = 0;
+
+    d %= n;
+    if (d <= 0 || n < 2) {
+        return sig;
+    }
 
+    unsigned char hash[32];
+    digest::sha256_digest(message.data(), message.size(), hash);
+    long long z = bits_to_int(hash, sizeof(hash), n) % n;
 
+    for (int skip = 0; skip < ECDSA_MAX_NONCES; ++skip) {
+        int k = rfc6979_nonce(n, d, hash, skip);
+        ec_point R = scalar_mult(P, k, curve);
+        int k_inv = inverse_or_zero(k, n);
+        if (is_infinity(R) || k_inv == 0) {
+            continue;
+        }
 
-    ec_point message;
-    message.x = 1;
-    message.y = 12;
+        long long r = R.x % n;
+        long long s = k_inv * ((z + r * d) % n) % n;
+        if (r == 0 || s == 0) {
+            continue;
+        }
 
-    cout << "Message Point:" << endl;
-    cout << "(" << message.x << ", " << message.y << ")" << endl;
+        sig.r = static_cast<int>(r);
+        sig.s = static_cast<int>(s);
+        return sig;
+    }
+
+    return sig;
+}
 
-    encrypted e_mes = encryption(curve, point, k.pub_k.Q, message);
+/**
+ * Verifies an ECDSA signature with one fused double-scalar multiplication.
+ *
+ * @param curve: Parameters of the elliptic curve
+ * @param P: The base point.
+ * @param n: The order of P.
+ * @param Q: The signer's public key.
+ * @param message: The signed message.
+ * @param sig: The signature to check.
+ * @return: True if the signature is valid.
+ */
+bool ecdsa_verify(ec_curve curve, ec_point P, int n, ec_point Q, const std::string& message, ecdsa_signature sig) {
+    if (sig.r < 1 || sig.r >= n || sig.s < 1 || sig.s >= n || !on_curve(Q, curve)) {
+        return false;
+    }
 
-    cout << "Encrypted Points:" << endl;
-    cout << "C1: (" << e_mes.C1.x << ", " << e_mes.C1.y << ")" << endl;
-    cout << "C2: (" << e_mes.C2.x << ", " << e_mes.C2.y << ")" << endl;
+    int w = inverse_or_zero(sig.s, n);
+    if (w == 0) {
+        return false;
+    }
+
+    unsigned char hash[32];
+    digest::sha256_digest(message.data(), message.size(), hash);
+    long long z = bits_to_int(hash, sizeof(hash), n) % n;
+
+    int u1 = static_cast<int>(z * w % n);
+    int u2 = static_cast<int>((long long)sig.r * w % n);
+    ec_point X = shamir_mult(P, u1, Q, u2, curve);
+    if (is_infinity(X)) {
+        return false;
+    }
+
+    return X.x % n == sig.r;
+}
 
-    ec_point decrypted = decryption(curve, e_mes.C1, e_mes.C2, k.pr_k.d);
-    cout << "Decrypted Point:" << endl;
-    cout << "(" << decrypted.x << ", " << decrypted.y << ")" << endl;
+// Messages encrypted in lockstep by encryption_batch. Each coordinate of a
+// block of lanes is its own array, so every step is one flat loop over the
+// lanes with no data-dependent branches.
+const size_t EC_BATCH_LANES = 256;
 
+/**
+ * Points in Jacobian coordinates (X / Z^2, Y / Z^3), one per lane.
+ * Z = 0 is the point at infinity.
+ */
+struct jacobian_lanes {
+    int64_t X[EC_BATCH_LANES];
+    int64_t Y[EC_BATCH_LANES];
+    int64_t Z[EC_BATCH_LANES];
+};
+
+inline int64_t mod_p(int64_t v, int64_t p) {
+    v %= p;
+    return v < 0 ? v + p : v;
+}
+
+/**
+ * Doubles one Jacobian point in place, for any curve coefficient a.
+ */
+void jacobian_double(int64_t& X, int64_t& Y, int64_t& Z, ec_curve curve) {
+    int64_t p = curve.p;
+    if (Z == 0 || Y == 0) {
+        Z = 0;
+        return;
+    }
+
+    int64_t XX = X * X % p;
+    int64_t YY = Y * Y % p;
+    int64_t ZZ = Z * Z % p;
+    int64_t S = 4 * X % p * YY % p;
+    int64_t M = mod_p(3 * XX + curve.a * (ZZ * ZZ % p), p);
+    int64_t X3 = mod_p(M * M - 2 * S, p);
+    int64_t Y3 = mod_p(M * mod_p(S - X3, p) - 8 * (YY * YY % p), p);
+    Z = 2 * Y % p * Z % p;
+    X = X3;
+    Y = Y3;
+}
+
+/**
+ * Adds an affine point to one Jacobian point in place, covering infinity,
+ * P + P and P + (-P).
+ */
+void jacobian_add_affine(int64_t& X, int64_t& Y, int64_t& Z, ec_point A, ec_curve curve) {
+    int64_t p = curve.p;
+    if (is_infinity(A)) {
+        return;
+    }
+    if (Z == 0) {
+        X = A.x;
+        Y = A.y;
+        Z = 1;
+        return;
+    }
+
+    int64_t ZZ = Z * Z % p;
+    int64_t H = mod_p(A.x * ZZ - X, p);
+    int64_t r = mod_p(A.y * (ZZ * Z % p) - Y, p);
+    if (H == 0) {
+        if (r == 0) {
+            jacobian_double(X, Y, Z, curve);
+        }
+        else {
+            Z = 0;
+        }
+        return;
+    }
+
+    int64_t HH = H * H % p;
+    int64_t HHH = H * HH % p;
+    int64_t V = X * HH % p;
+    int64_t X3 = mod_p(r * r - HHH - 2 * V, p);
+    Y = mod_p(r * mod_p(V - X3, p) - Y * HHH, p);
+    Z = Z * H % p;
+    X = X3;
+}
+
+/**
+ * Adds an affine point to every selected lane. The common case runs as one
+ * branch-free loop; lanes where the general formula does not apply
+ * (infinity, or the same x coordinate) are redone one at a time.
+ *
+ * @param acc: The lanes to add to.
+ * @param count: The number of lanes in use.
+ * @param select: 1 for lanes that take the addition, 0 for the others.
+ * @param points: The affine point for each lane.
+ * @param stride: 1 for one point per lane, 0 to add points[0] everywhere.
+ * @param curve: Parameters of the elliptic curve
+ */
+void add_affine_lanes(jacobian_lanes& acc, size_t count, const uint8_t* select, const ec_point* points,
+                      size_t stride, ec_curve curve) {
+    int64_t p = curve.p;
+    uint8_t special[EC_BATCH_LANES];
+
+    for (size_t i = 0; i < count; ++i) {
+        int64_t x2 = points[i * stride].x;
+        int64_t y2 = points[i * stride].y;
+        int64_t X = acc.X[i];
+        int64_t Y = acc.Y[i];
+        int64_t Z = acc.Z[i];
+
+        int64_t ZZ = Z * Z % p;
+        int64_t H = mod_p(x2 * ZZ - X, p);
+        int64_t r = mod_p(y2 * (ZZ * Z % p) - Y, p);
+        int64_t HH = H * H % p;
+        int64_t HHH = H * HH % p;
+        int64_t V = X * HH % p;
+        int64_t X3 = mod_p(r * r - HHH - 2 * V, p);
+        int64_t Y3 = mod_p(r * mod_p(V - X3, p) - Y * HHH, p);
+        int64_t Z3 = Z * H % p;
+
+        bool take = select[i] && x2 >= 0;
+        special[i] = take && (Z == 0 || H == 0);
+        bool use = take && !special[i];
+        acc.X[i] = use ? X3 : X;
+        acc.Y[i] = use ? Y3 : Y;
+        acc.Z[i] = use ? Z3 : Z;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (special[i]) {
+            jacobian_add_affine(acc.X[i], acc.Y[i], acc.Z[i], points[i * stride], curve);
+        }
+    }
+}
+
+/**
+ * Converts Jacobian points to affine with a single inversion (Montgomery's
+ * trick): invert the product of all Z, then peel off one Z at a time.
+ *
+ * @param X, Y, Z: The coordinates, count of each.
+ * @param out: Receives the affine points, (-1, -1) where Z = 0.
+ * @param count: The number of points.
+ * @param curve: Parameters of the elliptic curve
+ */
+void normalize_batch(const int64_t* X, const int64_t* Y, const int64_t* Z, ec_point* out, size_t count,
+                     ec_curve curve) {
+    int64_t p = curve.p;
+    vector<int64_t> prefix(count + 1);
+    prefix[0] = 1;
+    for (size_t i = 0; i < count; ++i) {
+        prefix[i + 1] = Z[i] ? prefix[i] * Z[i] % p : prefix[i];
+    }
+
+    int64_t inv = mod_p(get_inverse(static_cast<int>(prefix[count]), curve.p), p);
+    for (size_t i = count; i-- > 0;) {
+        if (Z[i] == 0) {
+            out[i].x = -1;
+            out[i].y = -1;
+            continue;
+        }
+        int64_t z_inv = inv * prefix[i] % p;
+        inv = inv * Z[i] % p;
+
+        int64_t zz_inv = z_inv * z_inv % p;
+        out[i].x = static_cast<int>(X[i] * zz_inv % p);
+        out[i].y = static_cast<int>(Y[i] * (zz_inv * z_inv % p) % p);
+    }
+}
+
+/**
+ * Encrypts many message points with EC ElGamal, drawing one ephemeral key
+ * per message like encryption().
+ *
+ * @param curve: Parameters of the elliptic curve including the prime modulus 'p'.
+ * @param P: The base point on the elliptic curve.
+ * @param Q: The public key point.
+ * @param M: The message points to be encrypted.
+ * @param out: Receives the encrypted messages, count of them.
+ * @param count: The number of messages.
+ */
+void encryption_batch(ec_curve curve, ec_point P, ec_point Q, const ec_point* M, encrypted* out, size_t count) {
+    encryption_batch(curve, P, Q, M, out, count, rng::thread_rng());
+}
+
+/**
+ * Encrypts many message points with EC ElGamal. Messages are processed in
+ * blocks of EC_BATCH_LANES lanes: kP and kQ are summed from the fixed-base
+ * tables of P and Q one bit at a time for every lane together, in Jacobian
+ * coordinates so no lane needs an inversion, and each block is brought back
+ * to affine with a single inversion.
+ *
+ * @param curve: Parameters of the elliptic curve including the prime modulus 'p'.
+ * @param P: The base point on the elliptic curve.
+ * @param Q: The public key point.
+ * @param M: The message points to be encrypted.
+ * @param out: Receives the encrypted messages, count of them.
+ * @param count: The number of messages.
+ * @param random: The random generator to draw the ephemeral keys from.
+ */
+void encryption_batch(ec_curve curve, ec_point P, ec_point Q, const ec_point* M, encrypted* out, size_t count,
+                      rng::chacha20_drbg& random) {
+    ec_point p_table[32];
+    ec_point q_table[32];
+    int p_size = build_fixed_base_table(P, curve, p_table, 32);
+    int q_size = build_fixed_base_table(Q, curve, q_table, 32);
+
+    jacobian_lanes c1;
+    jacobian_lanes c2;
+    int k[EC_BATCH_LANES];
+    uint8_t select[EC_BATCH_LANES];
+    int64_t X[2 * EC_BATCH_LANES];
+    int64_t Y[2 * EC_BATCH_LANES];
+    int64_t Z[2 * EC_BATCH_LANES];
+    ec_point affine[2 * EC_BATCH_LANES];
+
+    for (size_t first = 0; first < count; first += EC_BATCH_LANES) {
+        size_t lanes = min(EC_BATCH_LANES, count - first);
+
+        int max_k = 0;
+        for (size_t i = 0; i < lanes; ++i) {
+            k[i] = static_cast<int>(random.uniform(curve.p - 1)) + 2;
+            max_k = max(max_k, k[i]);
+            c1.Z[i] = 0;
+            c2.Z[i] = 0;
+        }
+
+        for (int bit = 0; (max_k >> bit) != 0; ++bit) {
+            for (size_t i = 0; i < lanes; ++i) {
+                select[i] = (k[i] >> bit) & 1;
+            }
+            if (bit < p_size) {
+                add_affine_lanes(c1, lanes, select, &p_table[bit], 0, curve);
+            }
+            if (bit < q_size) {
+                add_affine_lanes(c2, lanes, select, &q_table[bit], 0, curve);
+            }
+        }
+
+        // C2 = kQ + M
+        memset(select, 1, lanes);
+        add_affine_lanes(c2, lanes, select, M + first, 1, curve);
+
+        memcpy(X, c1.X, lanes * sizeof(int64_t));
+        memcpy(Y, c1.Y, lanes * sizeof(int64_t));
+        memcpy(Z, c1.Z, lanes * sizeof(int64_t));
+        memcpy(X + lanes, c2.X, lanes * sizeof(int64_t));
+        memcpy(Y + lanes, c2.Y, lanes * sizeof(int64_t));
+        memcpy(Z + lanes, c2.Z, lanes * sizeof(int64_t));
+        normalize_batch(X, Y, Z, affine, 2 * lanes, curve);
+
+        for (size_t i = 0; i < lanes; ++i) {
+            out[first + i].C1 = affine[i];
+            out[first + i].C2 = affine[lanes + i];
+        }
+    }
 }
 
-// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
-// Debug program: F5 or Debug > Start Debugging menu
+} // namespace ec
 
-// Tips for Getting Started: 
-//   1. Use the Solution Explorer window to add/manage files
-//   2. Use the Team Explorer window to connect to source control
-//   3. Use the Output window to see build output and other messages
-//   4. Use the Error List window to view errors
-//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
-//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
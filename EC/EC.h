@@ -0,0 +1,86 @@
+#ifndef EC_H
+#define EC_H
+#include <cstddef>
+#include <string>
+#include "../common/chacha20.h"
+
+namespace ec {
+
+struct ec_curve {
+    int a;
+    int b;
+    int p;
+};
+
+struct ec_point {
+    int x;
+    int y;
+};
+
+struct eea {
+    int r;
+    int s;
+    int t;
+};
+
+struct public_key {
+    ec_point Q;
+};
+
+struct private_key {
+    int d;
+};
+
+
+struct keys {
+    public_key pub_k;
+    private_key pr_k;
+};
+
+struct encrypted {
+    ec_point C1;
+    ec_point C2;
+};
+
+struct ecdsa_signature {
+    int r;
+    int s;
+};
+
+eea compute_eea(int r0, int r1);
+int get_inverse(int a, int modular);
+ec_point point_addition(ec_point P, ec_point Q, ec_curve curve);
+ec_point point_doubling(ec_point P, ec_curve curve);
+ec_point int_mult_point(ec_point P, int mult, ec_curve curve);
+ec_point point_inverse(ec_point P, ec_curve curve);
+keys generate_keys(ec_curve curve, ec_point P);
+keys generate_keys(ec_curve curve, ec_point P, rng::chacha20_drbg& random);
+encrypted encryption(ec_curve curve, ec_point P, ec_point Q, ec_point M);
+encrypted encryption(ec_curve curve, ec_point P, ec_point Q, ec_point M, rng::chacha20_drbg& random);
+void encryption_batch(ec_curve curve, ec_point P, ec_point Q, const ec_point* M, encrypted* out, size_t count);
+void encryption_batch(ec_curve curve, ec_point P, ec_point Q, const ec_point* M, encrypted* out, size_t count,
+                      rng::chacha20_drbg& random);
+ec_point decryption(ec_curve curve, ec_point C1, ec_point C2, int d);
+bool euler_criterion(int a, int p);
+int find_non_square(int n, int p);
+ec_point rand_gen_point(ec_curve curve);
+ec_point rand_gen_point(ec_curve curve, rng::chacha20_drbg& random);
+bool is_infinity(ec_point P);
+ec_point point_sum(ec_point P, ec_point Q, ec_curve curve);
+int build_fixed_base_table(ec_point P, ec_curve curve, ec_point* table, int max_size);
+ec_point fixed_base_mult(const ec_point* table, int table_size, int mult, ec_curve curve);
+bool on_curve(ec_point P, ec_curve curve);
+ec_point scalar_mult(ec_point P, int mult, ec_curve curve);
+ec_point shamir_mult(ec_point P, int a, ec_point Q, int b, ec_curve curve);
+int curve_order(ec_curve curve);
+int point_order(ec_point P, ec_curve curve);
+int fixed_base_table_size(ec_point P, ec_curve curve);
+ec_point ecdh_shared_point(ec_point peer_Q, int d, ec_curve curve);
+bool ecdh_shared_secret(ec_point peer_Q, int d, ec_curve curve, unsigned char secret[32]);
+int rfc6979_nonce(int n, int d, const unsigned char hash[32], int skip);
+ecdsa_signature ecdsa_sign(ec_curve curve, ec_point P, int n, int d, const std::string& message);
+bool ecdsa_verify(ec_curve curve, ec_point P, int n, ec_point Q, const std::string& message, ecdsa_signature sig);
+
+} // namespace ec
+
+#endif
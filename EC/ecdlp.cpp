@@ -0,0 +1,384 @@
+// ecdlp.cpp : Baby-step giant-step, parallel Pollard rho and Pohlig-Hellman.
+//
+#include "ecdlp.h"
+#include "point64.h"
+#include "point_table.h"
+#include "../common/parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+namespace ec {
+
+// Walks each rho thread advances together, sharing one field inversion per
+// step (Montgomery's trick)
+const int RHO_WALKS = 32;
+
+// Precomputed steps of the r-adding walk
+const int RHO_PARTITIONS = 32;
+
+point64 to_point64(ec_point P) {
+    if (is_infinity(P)) {
+        return { 0, 0, true };
+    }
+    return { P.x, P.y, false };
+}
+
+curve64 to_curve64(ec_curve curve) {
+    return { mod_positive(curve.a, curve.p), mod_positive(curve.b, curve.p), curve.p };
+}
+
+/**
+ * Baby-step giant-step in a group of order n: with m = ceil(sqrt(n)), store
+ * jP for j < m and walk Q - i mP until it lands on a stored point.
+ *
+ * @return: k in [0, n) with kP = Q, or -1 if Q is not a multiple of P.
+ */
+int64_t bsgs64(const point64& P, const point64& Q, int64_t n, const curve64& c, uint64_t& additions) {
+    int64_t m = static_cast<int64_t>(ceil(sqrt(static_cast<double>(n))));
+
+    point_table baby(static_cast<size_t>(m));
+    point64 jP = P;
+    uint64_t unused;
+    for (int64_t j = 1; j < m && !jP.infinity; ++j) {
+        baby.insert(point_key(jP.x, jP.y), static_cast<uint64_t>(j), unused);
+        jP = add64(jP, P, c);
+    }
+    additions += m;
+
+    point64 minus_mP = neg64(mult64(P, m, c), c);
+    point64 R = Q;
+    for (int64_t i = 0; i <= m; ++i) {
+        // R = jP gives k = i m + j, R = -jP (the other parity) k = i m - j
+        int64_t candidates[3] = { -1, -1, -1 };
+        uint64_t j;
+        if (R.infinity) {
+            candidates[0] = i * m;
+        }
+        else {
+            uint64_t key = point_key(R.x, R.y);
+            if (baby.find(key, j)) {
+                candidates[1] = i * m + static_cast<int64_t>(j);
+            }
+            if (baby.find(key ^ 1, j)) {
+                candidates[2] = mod_positive(i * m - static_cast<int64_t>(j), n);
+            }
+        }
+        for (int64_t candidate : candidates) {
+            if (candidate >= 0 && equal64(mult64(P, candidate % n, c), Q)) {
+                return candidate % n;
+            }
+        }
+        R = add64(R, minus_mP, c);
+        ++additions;
+    }
+    return -1;
+}
+
+/**
+ * Shared state of one rho run.
+ */
+struct rho_state {
+    curve64 c;
+    point64 P;
+    point64 Q;
+    int64_t n;
+    int dp_bits;
+    uint64_t max_walk;
+    uint64_t max_additions;
+    point64 step[RHO_PARTITIONS];
+    int64_t step_a[RHO_PARTITIONS];
+    int64_t step_b[RHO_PARTITIONS];
+    point_table table;
+    atomic<bool> done{ false };
+    atomic<int64_t> result{ -1 };
+    atomic<uint64_t> additions{ 0 };
+
+    explicit rho_state(size_t expected_dps) : table(expected_dps) {}
+};
+
+inline uint64_t mix_x(int64_t x) {
+    return static_cast<uint64_t>(x) * 0x9e3779b97f4a7c15ULL;
+}
+
+/**
+ * Turns a collision aP + bQ = +-(a'P + b'Q) into k, if b - b' (or b + b')
+ * is invertible mod n.
+ */
+bool solve_collision(rho_state& s, int64_t a, int64_t b, int64_t y, uint64_t stored) {
+    int64_t a2 = static_cast<int64_t>((stored >> 31) & 0x7fffffff);
+    int64_t b2 = static_cast<int64_t>(stored & 0x7fffffff);
+    int stored_parity = static_cast<int>((stored >> 62) & 1);
+
+    // try the sign the parities point to first; y = 0 fits both
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool same = (stored_parity == (y & 1)) != (attempt == 1);
+        int64_t num = same ? mod_positive(a - a2, s.n) : mod_positive(-(a + a2), s.n);
+        int64_t den = same ? mod_positive(b2 - b, s.n) : mod_positive(b + b2, s.n);
+        if (den == 0 || gcd64(den, s.n) != 1) {
+            continue;
+        }
+        int64_t k = num * inverse64(den, s.n) % s.n;
+        if (equal64(mult64(s.P, k, s.c), s.Q)) {
+            s.result.store(k);
+            s.done.store(true, memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * One thread of the rho search: RHO_WALKS r-adding walks X -> X + M_j,
+ * stepped together so the slope denominators of all walks share one
+ * inversion. Every distinguished point goes into the shared table; two
+ * walks that meet produce the same distinguished point from then on.
+ */
+void rho_worker(rho_state& s) {
+    rng::chacha20_drbg& random = rng::thread_rng();
+    uint32_t n32 = static_cast<uint32_t>(s.n);
+
+    point64 X[RHO_WALKS];
+    int64_t a[RHO_WALKS];
+    int64_t b[RHO_WALKS];
+    uint64_t length[RHO_WALKS];
+
+    auto restart = [&](int w) {
+        do {
+            a[w] = random.uniform(n32);
+            b[w] = random.uniform(n32);
+            X[w] = add64(mult64(s.P, a[w], s.c), mult64(s.Q, b[w], s.c), s.c);
+        } while (X[w].infinity);
+        length[w] = 0;
+    };
+    for (int w = 0; w < RHO_WALKS; ++w) {
+        restart(w);
+    }
+
+    int partition[RHO_WALKS];
+    int64_t den[RHO_WALKS];
+    int64_t prefix[RHO_WALKS];
+    uint64_t dp_mask = (uint64_t(1) << s.dp_bits) - 1;
+
+    while (!s.done.load(memory_order_acquire)) {
+        // slope denominators, with the product of all of them inverted once
+        int64_t running = 1;
+        for (int w = 0; w < RHO_WALKS; ++w) {
+            partition[w] = static_cast<int>(mix_x(X[w].x) >> 59);
+            den[w] = mod_positive(s.step[partition[w]].x - X[w].x, s.c.p);
+            if (den[w] == 0) {
+                den[w] = 1;     // doubling or infinity; added the slow way below
+            }
+            prefix[w] = running;
+            running = running * den[w] % s.c.p;
+        }
+        int64_t inverse = inverse64(running, s.c.p);
+
+        for (int w = RHO_WALKS - 1; w >= 0; --w) {
+            int64_t inv_den = inverse * prefix[w] % s.c.p;
+            inverse = inverse * den[w] % s.c.p;
+
+            const point64& M = s.step[partition[w]];
+            if (M.x == X[w].x) {
+                X[w] = add64(X[w], M, s.c);
+                if (X[w].infinity) {
+                    restart(w);
+                    continue;
+                }
+            }
+            else {
+                int64_t lambda = mod_positive(M.y - X[w].y, s.c.p) * inv_den % s.c.p;
+                int64_t x = mod_positive(lambda * lambda % s.c.p - X[w].x - M.x, s.c.p);
+                X[w].y = mod_positive(lambda * mod_positive(X[w].x - x, s.c.p) % s.c.p - X[w].y, s.c.p);
+                X[w].x = x;
+            }
+            a[w] += s.step_a[partition[w]];
+            a[w] -= a[w] >= s.n ? s.n : 0;
+            b[w] += s.step_b[partition[w]];
+            b[w] -= b[w] >= s.n ? s.n : 0;
+
+            if (((mix_x(X[w].x) >> 20) & dp_mask) == 0) {
+                // keyed by x alone so that X and -X collide; y's parity
+                // goes into the value
+                uint64_t value = uint64_t(X[w].y & 1) << 62 | uint64_t(a[w]) << 31 | uint64_t(b[w]);
+                uint64_t stored;
+                if (s.table.insert(point_key(X[w].x, 0), value, stored) == POINT_TABLE_FOUND &&
+                    stored != value && !solve_collision(s, a[w], b[w], X[w].y, stored)) {
+                    // met its own trail, or a useless collision
+                    restart(w);
+                }
+            }
+            else if (++length[w] > s.max_walk) {
+                // stuck in a cycle without distinguished points
+                restart(w);
+            }
+        }
+
+        if (s.additions.fetch_add(RHO_WALKS, memory_order_relaxed) > s.max_additions) {
+            s.done.store(true, memory_order_release);
+        }
+    }
+}
+
+/**
+ * Parallel Pollard rho (van Oorschot-Wiener) in a group of prime order n.
+ */
+int64_t rho64(const point64& P, const point64& Q, int64_t n, const curve64& c, unsigned int num_threads,
+              uint64_t& additions) {
+    if (n < 1024) {
+        return bsgs64(P, Q, n, c, additions);
+    }
+    num_threads = parallel::thread_count(num_threads);
+
+    // about 1.25 sqrt(n) steps in total; aim for each walk to pass several
+    // distinguished points before the collision
+    double expected = 1.25 * sqrt(static_cast<double>(n));
+    double walks = static_cast<double>(num_threads) * RHO_WALKS;
+    int dp_bits = 0;
+    while (dp_bits < 30 && double(uint64_t(1) << (dp_bits + 1)) * walks * 8 < expected) {
+        ++dp_bits;
+    }
+    size_t expected_dps = static_cast<size_t>(expected / double(uint64_t(1) << dp_bits) + walks);
+
+    rho_state s(2 * expected_dps);
+    s.c = c;
+    s.P = P;
+    s.Q = Q;
+    s.n = n;
+    s.dp_bits = dp_bits;
+    s.max_walk = uint64_t(20) << dp_bits;
+    s.max_additions = static_cast<uint64_t>(64 * expected) + uint64_t(walks) * s.max_walk;
+
+    rng::chacha20_drbg& random = rng::thread_rng();
+    for (int j = 0; j < RHO_PARTITIONS; ++j) {
+        do {
+            s.step_a[j] = random.uniform(static_cast<uint32_t>(n));
+            s.step_b[j] = random.uniform(static_cast<uint32_t>(n));
+            s.step[j] = add64(mult64(P, s.step_a[j], c), mult64(Q, s.step_b[j], c), c);
+        } while (s.step[j].infinity);
+    }
+
+    parallel::run_workers(num_threads, [&s] { rho_worker(s); });
+
+    additions += s.additions.load();
+    return s.result.load();
+}
+
+/**
+ * Solves kP = Q by baby-step giant-step.
+ *
+ * @param curve: Parameters of the elliptic curve
+ * @param P: The base point.
+ * @param Q: A multiple of P.
+ * @param n: The order of P.
+ * @param additions: If not null, increased by the point additions used.
+ * @return: k in [0, n), or -1 if Q is not a multiple of P.
+ */
+int ecdlp_bsgs(ec_curve curve, ec_point P, ec_point Q, int n, uint64_t* additions) {
+    uint64_t count = 0;
+    int64_t k = bsgs64(to_point64(P), to_point64(Q), n, to_curve64(curve), count);
+    if (additions) {
+        *additions += count;
+    }
+    return static_cast<int>(k);
+}
+
+/**
+ * Solves kP = Q by Pollard rho on all cores. Expects about 1.25 sqrt(n)
+ * additions in total.
+ *
+ * @param curve: Parameters of the elliptic curve
+ * @param P: The base point.
+ * @param Q: A multiple of P.
+ * @param n: The order of P, a prime.
+ * @param num_threads: The number of threads to use, 0 for one per core.
+ * @param additions: If not null, increased by the point additions used.
+ * @return: k in [0, n), or -1 if the search gave up.
+ */
+int ecdlp_rho(ec_curve curve, ec_point P, ec_point Q, int n, unsigned int num_threads, uint64_t* additions) {
+    uint64_t count = 0;
+    int64_t k = rho64(to_point64(P), to_point64(Q), n, to_curve64(curve), num_threads, count);
+    if (additions) {
+        *additions += count;
+    }
+    return static_cast<int>(k);
+}
+
+/**
+ * Solves kP = Q for any base point: Pohlig-Hellman reduces the problem to
+ * one per prime q dividing the order of P, solved digit by digit for
+ * prime powers, and the results are joined by the Chinese remainder theorem.
+ *
+ * @param curve: Parameters of the elliptic curve
+ * @param P: The base point.
+ * @param Q: A multiple of P.
+ * @param num_threads: The number of threads for Pollard rho, 0 for one per core.
+ * @param stats: If not null, filled in with the order and the work done.
+ * @return: k in [0, n), or -1 if Q is not a multiple of P.
+ */
+int ecdlp_solve(ec_curve curve, ec_point P, ec_point Q, unsigned int num_threads, ecdlp_stats* stats) {
+    int n = point_order(P, curve);
+    curve64 c = to_curve64(curve);
+    point64 P64 = to_point64(P);
+    point64 Q64 = to_point64(Q);
+    uint64_t additions = 0;
+    vector<int64_t> factors = n > 0 ? prime_factors(n) : vector<int64_t>();
+
+    if (stats) {
+        stats->order = n;
+        stats->largest_prime = factors.empty() ? 0 : static_cast<int>(factors.back());
+        stats->additions = 0;
+        stats->threads = parallel::thread_count(num_threads);
+    }
+    if (n == 0 || (!is_infinity(Q) && !on_curve(Q, curve))) {
+        return -1;
+    }
+
+    int64_t k = 0;
+    int64_t modulus = 1;
+    for (int64_t q : factors) {
+        int64_t q_power = 1;
+        int e = 0;
+        while (n / q_power % q == 0) {
+            q_power *= q;
+            ++e;
+        }
+
+        // the parts of P and Q in the subgroup of order q^e
+        point64 P1 = mult64(P64, n / q_power, c);
+        point64 Q1 = mult64(Q64, n / q_power, c);
+        point64 P0 = mult64(P1, q_power / q, c);
+
+        int64_t x = 0;
+        int64_t q_j = 1;
+        for (int j = 0; j < e; ++j) {
+            point64 rest = add64(Q1, neg64(mult64(P1, x, c), c), c);
+            point64 Qj = mult64(rest, q_power / q_j / q, c);
+            int64_t digit = q <= ECDLP_BSGS_LIMIT ? bsgs64(P0, Qj, q, c, additions)
+                                                   : rho64(P0, Qj, q, c, num_threads, additions);
+            if (digit < 0) {
+                if (stats) {
+                    stats->additions = additions;
+                }
+                return -1;
+            }
+            x += digit * q_j;
+            q_j *= q;
+        }
+
+        // k = k mod modulus and x mod q^e
+        int64_t t = mod_positive(x - k, q_power) * inverse64(modulus % q_power, q_power) % q_power;
+        k += modulus * t;
+        modulus *= q_power;
+    }
+
+    if (stats) {
+        stats->additions = additions;
+    }
+    return equal64(mult64(P64, k, c), Q64) ? static_cast<int>(k) : -1;
+}
+
+} // namespace ec
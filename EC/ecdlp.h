@@ -0,0 +1,32 @@
+#ifndef ECDLP_H
+#define ECDLP_H
+// Elliptic curve discrete logarithms: given P and Q = kP, find k. Meant for
+// judging how strong a configured ec_curve is, since the cost of breaking
+// a curve is about the square root of the largest prime dividing the order
+// of P, and as a stress test of point addition.
+//
+// ecdlp_solve splits the order with Pohlig-Hellman and solves each prime
+// part by baby-step giant-step up to ECDLP_BSGS_LIMIT and by parallel
+// Pollard rho with distinguished points above it.
+#include <cstdint>
+#include "EC.h"
+
+namespace ec {
+
+const int64_t ECDLP_BSGS_LIMIT = int64_t(1) << 24;
+
+struct ecdlp_stats {
+    int order;              // order of P
+    int largest_prime;      // largest prime factor of the order
+    uint64_t additions;     // point additions spent
+    unsigned int threads;
+};
+
+int ecdlp_bsgs(ec_curve curve, ec_point P, ec_point Q, int n, uint64_t* additions = nullptr);
+int ecdlp_rho(ec_curve curve, ec_point P, ec_point Q, int n, unsigned int num_threads = 0,
+              uint64_t* additions = nullptr);
+int ecdlp_solve(ec_curve curve, ec_point P, ec_point Q, unsigned int num_threads = 0, ecdlp_stats* stats = nullptr);
+
+} // namespace ec
+
+#endif
@@ -0,0 +1,102 @@
+// ecdlp_tool.cpp : Estimates how strong a curve is by breaking a key on it.
+//
+//   ecdlp A B P X Y [--target QX QY] [--threads N] [--seed N]
+//
+// Without --target, Q = kP for a random k. Prints the orders involved, the
+// expected work and what the solve actually took.
+//
+#include "ecdlp.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void usage() {
+    cerr << "usage: ecdlp A B P X Y [--target QX QY] [--threads N] [--seed N]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 6) {
+        usage();
+        return 1;
+    }
+
+    ec::ec_curve curve;
+    curve.a = atoi(argv[1]);
+    curve.b = atoi(argv[2]);
+    curve.p = atoi(argv[3]);
+    ec::ec_point P;
+    P.x = atoi(argv[4]);
+    P.y = atoi(argv[5]);
+    ec::ec_point Q;
+    bool has_target = false;
+    unsigned int num_threads = 0;
+
+    for (int i = 6; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--target" && i + 2 < argc) {
+            Q.x = atoi(argv[++i]);
+            Q.y = atoi(argv[++i]);
+            has_target = true;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            num_threads = static_cast<unsigned int>(atoi(argv[++i]));
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            rng::set_seed(strtoull(argv[++i], nullptr, 10));
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!ec::on_curve(P, curve)) {
+        cerr << "P is not on the curve" << endl;
+        return 1;
+    }
+    int group = ec::curve_order(curve);
+    int n = ec::point_order(P, curve);
+    cout << "curve order:   " << group << endl;
+    cout << "point order:   " << n << endl;
+    if (group == 0) {
+        cerr << "the curve is singular or p is not a prime above 3" << endl;
+        return 1;
+    }
+
+    int k = -1;
+    if (!has_target) {
+        k = static_cast<int>(rng::thread_rng().uniform(static_cast<uint32_t>(n)));
+        Q = ec::scalar_mult(P, k, curve);
+    }
+
+    auto start = chrono::steady_clock::now();
+    ec::ecdlp_stats stats;
+    int found = ec::ecdlp_solve(curve, P, Q, num_threads, &stats);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Pollard rho needs about sqrt(pi q / 2) additions for the largest prime q
+    double expected = sqrt(3.14159265358979 * stats.largest_prime / 2);
+    cout << "largest prime: " << stats.largest_prime << endl;
+    cout << "security:      about 2^" << log2(expected) << " additions" << endl;
+    cout << "threads:       " << stats.threads << endl;
+    if (found < 0) {
+        cout << "no solution, Q is not a multiple of P" << endl;
+        return 1;
+    }
+
+    cout << "k:             " << found;
+    if (k >= 0 && found != k) {
+        cout << " (expected " << k << ")";
+    }
+    cout << endl;
+    cout << "time:          " << seconds << " s" << endl;
+    cout << "additions:     " << stats.additions << " (" << stats.additions / max(seconds, 1e-9) / 1e6
+         << " M/s)" << endl;
+    return 0;
+}
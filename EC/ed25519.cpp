@@ -0,0 +1,714 @@
+// ed25519.cpp : Edwards curve arithmetic and Ed25519 signatures.
+//
+#include "ed25519.h"
+#include "fe25519.h"
+#include "../common/parallel.h"
+#include "../common/sha512.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace ec {
+
+/**
+ * A point in extended coordinates.
+ */
+struct ed_point {
+    fe X, Y, Z, T;
+};
+
+/**
+ * The second operand of an addition, with the sums and products that do
+ * not depend on the first operand done in advance.
+ */
+struct ed_cached {
+    fe YplusX, YminusX, Z2, T2d;
+};
+
+struct ed_constants {
+    fe d;
+    fe d2;
+    fe sqrtm1;
+};
+
+/**
+ * @return: d = -121665/121666, 2d and sqrt(-1) = 2^((p-1)/4), computed
+ *          once rather than written out as limbs.
+ */
+const ed_constants& constants() {
+    static const ed_constants c = [] {
+        ed_constants k;
+        fe num, den;
+        fe_zero(num);
+        num.v[0] = 121665;
+        fe_neg(num, num);
+        fe_zero(den);
+        den.v[0] = 121666;
+        fe_invert(den, den);
+        fe_mul(k.d, num, den);
+        fe_add(k.d2, k.d, k.d);
+
+        // (p - 1) / 4 = 2^253 - 5
+        uint8_t exponent[32];
+        memset(exponent, 0xff, sizeof(exponent));
+        exponent[0] = 0xfb;
+        exponent[31] = 0x1f;
+        fe two, r;
+        fe_zero(two);
+        two.v[0] = 2;
+        fe_one(r);
+        for (int bit = 252; bit >= 0; --bit) {
+            fe_sq(r, r);
+            if ((exponent[bit >> 3] >> (bit & 7)) & 1) {
+                fe_mul(r, r, two);
+            }
+        }
+        k.sqrtm1 = r;
+        return k;
+    }();
+    return c;
+}
+
+void ed_identity(ed_point& p) {
+    fe_zero(p.X);
+    fe_one(p.Y);
+    fe_one(p.Z);
+    fe_zero(p.T);
+}
+
+void ed_cached_identity(ed_cached& c) {
+    fe_one(c.YplusX);
+    fe_one(c.YminusX);
+    fe_zero(c.Z2);
+    c.Z2.v[0] = 2;
+    fe_zero(c.T2d);
+}
+
+void ed_to_cached(ed_cached& c, const ed_point& p) {
+    fe_add(c.YplusX, p.Y, p.X);
+    fe_sub(c.YminusX, p.Y, p.X);
+    fe_add(c.Z2, p.Z, p.Z);
+    fe_mul(c.T2d, p.T, constants().d2);
+}
+
+/**
+ * -q, for subtraction.
+ */
+void ed_cached_neg(ed_cached& r, const ed_cached& q) {
+    fe YplusX = q.YplusX;
+    r.YplusX = q.YminusX;
+    r.YminusX = YplusX;
+    r.Z2 = q.Z2;
+    fe_neg(r.T2d, q.T2d);
+}
+
+/**
+ * r = p + q with the unified formula (add-2008-hwcd-3), correct for every
+ * pair of inputs including p = q and the identity.
+ */
+void ed_add(ed_point& r, const ed_point& p, const ed_cached& q) {
+    fe A, B, C, D, E, F, G, H, t;
+    fe_sub(t, p.Y, p.X);
+    fe_mul(A, t, q.YminusX);
+    fe_add(t, p.Y, p.X);
+    fe_mul(B, t, q.YplusX);
+    fe_mul(C, p.T, q.T2d);
+    fe_mul(D, p.Z, q.Z2);
+    fe_sub(E, B, A);
+    fe_sub(F, D, C);
+    fe_add(G, D, C);
+    fe_add(H, B, A);
+    fe_mul(r.X, E, F);
+    fe_mul(r.Y, G, H);
+    fe_mul(r.T, E, H);
+    fe_mul(r.Z, F, G);
+}
+
+/**
+ * r = 2p (dbl-2008-hwcd), cheaper than ed_add(p, p).
+ */
+void ed_double(ed_point& r, const ed_point& p) {
+    fe A, B, C, E, F, G, H, t;
+    fe_sq(A, p.X);
+    fe_sq(B, p.Y);
+    fe_sq(t, p.Z);
+    fe_add(C, t, t);
+    fe_add(H, A, B);
+    fe_add(t, p.X, p.Y);
+    fe_sq(t, t);
+    fe_sub(E, H, t);
+    fe_sub(G, A, B);
+    fe_add(F, C, G);
+    fe_mul(r.X, E, F);
+    fe_mul(r.Y, G, H);
+    fe_mul(r.T, E, H);
+    fe_mul(r.Z, F, G);
+}
+
+bool ed_is_identity(const ed_point& p) {
+    return fe_iszero(p.X) && fe_equal(p.Y, p.Z);
+}
+
+void ed_encode(uint8_t s[ED25519_KEY_SIZE], const ed_point& p) {
+    fe zinv, x, y;
+    fe_invert(zinv, p.Z);
+    fe_mul(x, p.X, zinv);
+    fe_mul(y, p.Y, zinv);
+    fe_tobytes(s, y);
+    s[31] ^= static_cast<uint8_t>(fe_isnegative(x) << 7);
+}
+
+/**
+ * Decodes a point as in RFC 8032, section 5.1.3: y and the sign of x, with
+ * x recovered as a square root.
+ *
+ * @param p: Receives the point.
+ * @param s: The 32-byte encoding.
+ * @return: False if y is not reduced or no point has that y.
+ */
+bool ed_decode(ed_point& p, const uint8_t s[ED25519_KEY_SIZE]) {
+    const ed_constants& k = constants();
+
+    fe y;
+    fe_frombytes(y, s);
+    uint8_t canonical[32];
+    fe_tobytes(canonical, y);
+    canonical[31] |= s[31] & 0x80;
+    if (memcmp(canonical, s, sizeof(canonical)) != 0) {
+        return false;
+    }
+
+    // x^2 = u / v with u = y^2 - 1, v = d y^2 + 1
+    fe u, v, one, y2;
+    fe_one(one);
+    fe_sq(y2, y);
+    fe_sub(u, y2, one);
+    fe_mul(v, y2, k.d);
+    fe_add(v, v, one);
+
+    // x = u v^3 (u v^7)^((p - 5) / 8)
+    fe v3, v7, x, t;
+    fe_sq(v3, v);
+    fe_mul(v3, v3, v);
+    fe_sq(v7, v3);
+    fe_mul(v7, v7, v);
+    fe_mul(t, u, v7);
+    fe_pow22523(t, t);
+    fe_mul(x, u, v3);
+    fe_mul(x, x, t);
+
+    fe vxx, neg_u;
+    fe_sq(vxx, x);
+    fe_mul(vxx, vxx, v);
+    if (!fe_equal(vxx, u)) {
+        fe_neg(neg_u, u);
+        if (!fe_equal(vxx, neg_u)) {
+            return false;
+        }
+        fe_mul(x, x, k.sqrtm1);
+    }
+
+    int sign = s[31] >> 7;
+    if (sign && fe_iszero(x)) {
+        return false;
+    }
+    if (fe_isnegative(x) != sign) {
+        fe_neg(x, x);
+    }
+
+    p.X = x;
+    p.Y = y;
+    fe_one(p.Z);
+    fe_mul(p.T, x, y);
+    return true;
+}
+
+// Scalars mod L = 2^252 + 27742317777372353535851937790883648493, little
+// endian bytes
+const int64_t SC_L[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10
+};
+
+/**
+ * Reduces a 64-limb number (limbs may exceed a byte) mod L, folding the
+ * top limbs down with 2^252 = -(L - 2^252).
+ *
+ * @param out: Receives the 32-byte result.
+ * @param x: The number, destroyed.
+ */
+void sc_mod_l(uint8_t out[32], int64_t x[64]) {
+    for (int i = 63; i >= 32; --i) {
+        int64_t carry = 0;
+        int j;
+        for (j = i - 32; j < i - 12; ++j) {
+            x[j] += carry - 16 * x[i] * SC_L[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry * 256;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+
+    int64_t carry = 0;
+    for (int j = 0; j < 32; ++j) {
+        x[j] += carry - (x[31] >> 4) * SC_L[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for (int j = 0; j < 32; ++j) {
+        x[j] -= carry * SC_L[j];
+    }
+    for (int i = 0; i < 32; ++i) {
+        x[i + 1] += x[i] >> 8;
+        out[i] = static_cast<uint8_t>(x[i] & 255);
+    }
+}
+
+/**
+ * out = a 64-byte hash mod L.
+ */
+void sc_reduce(uint8_t out[32], const uint8_t in[64]) {
+    int64_t x[64];
+    for (int i = 0; i < 64; ++i) {
+        x[i] = in[i];
+    }
+    sc_mod_l(out, x);
+}
+
+/**
+ * out = a b + c mod L. out may alias any input.
+ */
+void sc_muladd(uint8_t out[32], const uint8_t a[32], const uint8_t b[32], const uint8_t c[32]) {
+    int64_t x[64] = {};
+    for (int i = 0; i < 32; ++i) {
+        x[i] = c[i];
+    }
+    for (int i = 0; i < 32; ++i) {
+        for (int j = 0; j < 32; ++j) {
+            x[i + j] += int64_t(a[i]) * b[j];
+        }
+    }
+    sc_mod_l(out, x);
+}
+
+/**
+ * @return: True if s < L, the only S values RFC 8032 accepts.
+ */
+bool sc_is_canonical(const uint8_t s[32]) {
+    for (int i = 31; i >= 0; --i) {
+        if (s[i] != SC_L[i]) {
+            return s[i] < SC_L[i];
+        }
+    }
+    return false;
+}
+
+/**
+ * Writes a scalar below 2^255 as 64 signed digits in [-8, 8], a = sum of
+ * e[i] 16^i.
+ */
+void recode_radix16(int8_t e[64], const uint8_t a[32]) {
+    for (int i = 0; i < 32; ++i) {
+        e[2 * i] = static_cast<int8_t>(a[i] & 15);
+        e[2 * i + 1] = static_cast<int8_t>(a[i] >> 4);
+    }
+    int8_t carry = 0;
+    for (int i = 0; i < 63; ++i) {
+        e[i] = static_cast<int8_t>(e[i] + carry);
+        carry = static_cast<int8_t>((e[i] + 8) >> 4);
+        e[i] = static_cast<int8_t>(e[i] - carry * 16);
+    }
+    e[63] = static_cast<int8_t>(e[63] + carry);
+}
+
+/**
+ * base_table[i][j] = (j + 1) 16^i B, so [a]B is 64 table additions and
+ * no doublings.
+ */
+typedef ed_cached base_table_t[64][8];
+
+const base_table_t& base_table() {
+    static const base_table_t* table = [] {
+        static base_table_t t;
+        static const uint8_t encoded_base[32] = {
+            0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+            0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+        };
+        ed_point P;
+        ed_decode(P, encoded_base);
+
+        for (int i = 0; i < 64; ++i) {
+            ed_cached P_cached;
+            ed_to_cached(P_cached, P);
+            t[i][0] = P_cached;
+            ed_point Q = P;
+            for (int j = 1; j < 8; ++j) {
+                ed_add(Q, Q, P_cached);
+                ed_to_cached(t[i][j], Q);
+            }
+            for (int k = 0; k < 4; ++k) {
+                ed_double(P, P);
+            }
+        }
+        return &t;
+    }();
+    return *table;
+}
+
+void ed_cached_cmov(ed_cached& r, const ed_cached& q, uint64_t move) {
+    fe_cmov(r.YplusX, q.YplusX, move);
+    fe_cmov(r.YminusX, q.YminusX, move);
+    fe_cmov(r.Z2, q.Z2, move);
+    fe_cmov(r.T2d, q.T2d, move);
+}
+
+/**
+ * r = [a]B in constant time: every table entry of a row is read and the
+ * sign is applied with a conditional move.
+ *
+ * @param r: Receives the point.
+ * @param a: The scalar, a[31] <= 127.
+ */
+void base_mult(ed_point& r, const uint8_t a[32]) {
+    const base_table_t& table = base_table();
+    int8_t e[64];
+    recode_radix16(e, a);
+
+    ed_identity(r);
+    for (int i = 0; i < 64; ++i) {
+        int64_t digit = e[i];
+        int64_t sign_mask = digit >> 63;
+        uint64_t negative = static_cast<uint64_t>(sign_mask) & 1;
+        uint64_t magnitude = static_cast<uint64_t>((digit ^ sign_mask) - sign_mask);
+
+        ed_cached t, minus;
+        ed_cached_identity(t);
+        for (uint64_t j = 1; j <= 8; ++j) {
+            uint64_t equal = ((magnitude ^ j) - 1) >> 63;
+            ed_cached_cmov(t, table[i][j - 1], equal);
+        }
+        ed_cached_neg(minus, t);
+        ed_cached_cmov(t, minus, negative);
+        ed_add(r, r, t);
+    }
+}
+
+/**
+ * r = [a]B for a public scalar, skipping zero digits.
+ */
+void base_mult_vartime(ed_point& r, const uint8_t a[32]) {
+    const base_table_t& table = base_table();
+    int8_t e[64];
+    recode_radix16(e, a);
+
+    ed_identity(r);
+    for (int i = 0; i < 64; ++i) {
+        if (e[i] > 0) {
+            ed_add(r, r, table[i][e[i] - 1]);
+        }
+        else if (e[i] < 0) {
+            ed_cached minus;
+            ed_cached_neg(minus, table[i][-e[i] - 1]);
+            ed_add(r, r, minus);
+        }
+    }
+}
+
+/**
+ * Multi-scalar multiplication, r = sum of [scalars[i]] points[i], by
+ * Straus' method: the four doublings per radix-16 digit are shared by all
+ * the points, so each extra point costs only its table and one addition
+ * per non-zero digit. Variable time.
+ *
+ * @param r: Receives the sum.
+ * @param points: The points.
+ * @param scalars: One 32-byte scalar per point, each below 2^255.
+ * @param count: The number of points.
+ */
+void multi_scalar_mult(ed_point& r, const ed_point* points, const uint8_t (*scalars)[32], size_t count) {
+    vector<array<ed_cached, 8>> tables(count);
+    vector<array<int8_t, 64>> digits(count);
+    int top = -1;
+
+    for (size_t k = 0; k < count; ++k) {
+        recode_radix16(digits[k].data(), scalars[k]);
+        for (int i = 63; i > top; --i) {
+            if (digits[k][i] != 0) {
+                top = i;
+                break;
+            }
+        }
+
+        ed_to_cached(tables[k][0], points[k]);
+        ed_point Q;
+        ed_double(Q, points[k]);
+        ed_to_cached(tables[k][1], Q);
+        for (int j = 2; j < 8; ++j) {
+            ed_add(Q, Q, tables[k][0]);
+            ed_to_cached(tables[k][j], Q);
+        }
+    }
+
+    ed_identity(r);
+    for (int i = top; i >= 0; --i) {
+        if (i < top) {
+            for (int j = 0; j < 4; ++j) {
+                ed_double(r, r);
+            }
+        }
+        for (size_t k = 0; k < count; ++k) {
+            int8_t d = digits[k][i];
+            if (d > 0) {
+                ed_add(r, r, tables[k][d - 1]);
+            }
+            else if (d < 0) {
+                ed_cached minus;
+                ed_cached_neg(minus, tables[k][-d - 1]);
+                ed_add(r, r, minus);
+            }
+        }
+    }
+}
+
+/**
+ * Checks [8]([s]B - sum) = 0, the cofactored verification equation with
+ * the R and A terms already summed.
+ */
+bool check_equation(const uint8_t s[32], const ed_point& sum) {
+    ed_point Q;
+    base_mult_vartime(Q, s);
+
+    ed_cached minus;
+    ed_to_cached(minus, sum);
+    ed_cached_neg(minus, minus);
+    ed_add(Q, Q, minus);
+    for (int i = 0; i < 3; ++i) {
+        ed_double(Q, Q);
+    }
+    return ed_is_identity(Q);
+}
+
+/**
+ * The parts of a signature that do not depend on the rest of a batch.
+ */
+struct parsed_signature {
+    ed_point A;
+    ed_point R;
+    uint8_t S[32];
+    uint8_t k[32];     // SHA-512(R || A || M) mod L
+};
+
+/**
+ * Decodes R, A and S and hashes the message.
+ *
+ * @return: False if a point does not decode or S is not below L.
+ */
+bool parse_signature(parsed_signature& out, const uint8_t public_key[ED25519_KEY_SIZE], const string& message,
+                     const ed25519_signature& signature) {
+    const uint8_t* R = signature.bytes;
+    const uint8_t* S = signature.bytes + 32;
+    if (!sc_is_canonical(S) || !ed_decode(out.A, public_key) || !ed_decode(out.R, R)) {
+        return false;
+    }
+    memcpy(out.S, S, 32);
+
+    digest::sha512 h;
+    h.update(R, 32);
+    h.update(public_key, ED25519_KEY_SIZE);
+    h.update(message);
+    uint8_t hash[digest::SHA512_SIZE];
+    h.final(hash);
+    sc_reduce(out.k, hash);
+    return true;
+}
+
+/**
+ * Verifies one parsed signature: R + [k]A = [S]B up to the cofactor.
+ */
+bool verify_parsed(const parsed_signature& sig) {
+    ed_point sum;
+    multi_scalar_mult(sum, &sig.A, &sig.k, 1);
+    ed_cached R;
+    ed_to_cached(R, sig.R);
+    ed_add(sum, sum, R);
+    return check_equation(sig.S, sum);
+}
+
+/**
+ * Derives the key pair of an RFC 8032 seed.
+ *
+ * @param seed: The 32-byte private key.
+ * @return: The key pair.
+ */
+ed25519_keys ed25519_keys_from_seed(const uint8_t seed[ED25519_KEY_SIZE]) {
+    uint8_t h[digest::SHA512_SIZE];
+    digest::sha512_digest(seed, ED25519_KEY_SIZE, h);
+    h[0] &= 248;
+    h[31] &= 127;
+    h[31] |= 64;
+
+    ed_point A;
+    base_mult(A, h);
+
+    ed25519_keys keys;
+    memcpy(keys.private_key, seed, ED25519_KEY_SIZE);
+    ed_encode(keys.public_key, A);
+    return keys;
+}
+
+/**
+ * Generates an Ed25519 key pair from the thread's random generator.
+ *
+ * @return: The key pair.
+ */
+ed25519_keys ed25519_generate_keys() {
+    return ed25519_generate_keys(rng::thread_rng());
+}
+
+/**
+ * Generates an Ed25519 key pair.
+ *
+ * @param random: The random generator to draw the seed from.
+ * @return: The key pair.
+ */
+ed25519_keys ed25519_generate_keys(rng::chacha20_drbg& random) {
+    uint8_t seed[ED25519_KEY_SIZE];
+    random.fill(seed, sizeof(seed));
+    return ed25519_keys_from_seed(seed);
+}
+
+/**
+ * Signs a message (RFC 8032, section 5.1.6). The nonce is derived from
+ * the key and the message, so no randomness is needed.
+ *
+ * @param keys: The signer's key pair.
+ * @param message: The message.
+ * @return: The 64-byte signature R || S.
+ */
+ed25519_signature ed25519_sign(const ed25519_keys& keys, const string& message) {
+    uint8_t h[digest::SHA512_SIZE];
+    digest::sha512_digest(keys.private_key, ED25519_KEY_SIZE, h);
+    h[0] &= 248;
+    h[31] &= 127;
+    h[31] |= 64;
+
+    uint8_t hash[digest::SHA512_SIZE];
+    digest::sha512 nonce_hash;
+    nonce_hash.update(h + 32, 32);
+    nonce_hash.update(message);
+    nonce_hash.final(hash);
+    uint8_t r[32];
+    sc_reduce(r, hash);
+
+    ed25519_signature signature;
+    ed_point R;
+    base_mult(R, r);
+    ed_encode(signature.bytes, R);
+
+    digest::sha512 challenge_hash;
+    challenge_hash.update(signature.bytes, 32);
+    challenge_hash.update(keys.public_key, ED25519_KEY_SIZE);
+    challenge_hash.update(message);
+    challenge_hash.final(hash);
+    uint8_t k[32];
+    sc_reduce(k, hash);
+
+    sc_muladd(signature.bytes + 32, k, h, r);
+    return signature;
+}
+
+/**
+ * Verifies a signature.
+ *
+ * @param public_key: The signer's public key.
+ * @param message: The message.
+ * @param signature: The signature.
+ * @return: True if the signature is valid.
+ */
+bool ed25519_verify(const uint8_t public_key[ED25519_KEY_SIZE], const string& message,
+                    const ed25519_signature& signature) {
+    parsed_signature sig;
+    return parse_signature(sig, public_key, message, signature) && verify_parsed(sig);
+}
+
+/**
+ * Checks one batch with a random linear combination: for random 128-bit
+ * z_i, [8]([sum z_i S_i]B - sum [z_i]R_i - sum [z_i k_i]A_i) = 0. A
+ * batch holding a bad signature passes with probability about 2^-128.
+ */
+bool verify_combined(const vector<parsed_signature>& batch, rng::chacha20_drbg& random) {
+    size_t count = batch.size();
+    vector<ed_point> points(2 * count);
+    vector<array<uint8_t, 32>> scalars(2 * count);
+    uint8_t s_sum[32] = {};
+
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t z[32] = {};
+        random.fill(z, 16);
+
+        sc_muladd(s_sum, z, batch[i].S, s_sum);
+        points[2 * i] = batch[i].R;
+        memcpy(scalars[2 * i].data(), z, 32);
+        points[2 * i + 1] = batch[i].A;
+        uint8_t zero[32] = {};
+        sc_muladd(scalars[2 * i + 1].data(), z, batch[i].k, zero);
+    }
+
+    ed_point sum;
+    multi_scalar_mult(sum, points.data(), reinterpret_cast<const uint8_t (*)[32]>(scalars.data()), 2 * count);
+    return check_equation(s_sum, sum);
+}
+
+/**
+ * Verifies signatures in randomized batches of ED25519_BATCH. A batch that
+ * fails is verified one signature at a time to find the bad ones, so the
+ * result is the same as calling ed25519_verify on each.
+ *
+ * @param public_keys: The signers' public keys.
+ * @param messages: The messages.
+ * @param signatures: The signatures, signatures[i] over messages[i].
+ * @param num_threads: The number of threads to use, 0 for one per core.
+ * @return: valid[i] is 1 if signature i verified, else 0.
+ */
+vector<uint8_t> ed25519_verify_batch(const vector<ed25519_public_key>& public_keys, const vector<string>& messages,
+                                     const vector<ed25519_signature>& signatures, unsigned int num_threads) {
+    size_t count = min(public_keys.size(), min(messages.size(), signatures.size()));
+    vector<uint8_t> valid(count);
+
+    auto verify_range = [&](size_t begin, size_t end) {
+        rng::chacha20_drbg& random = rng::thread_rng();
+        vector<parsed_signature> batch;
+        vector<size_t> index;
+
+        for (size_t first = begin; first < end; first += ED25519_BATCH) {
+            size_t last = min(first + ED25519_BATCH, end);
+            batch.clear();
+            index.clear();
+            for (size_t i = first; i < last; ++i) {
+                parsed_signature sig;
+                if (parse_signature(sig, public_keys[i].data(), messages[i], signatures[i])) {
+                    batch.push_back(sig);
+                    index.push_back(i);
+                }
+            }
+
+            if (batch.size() > 1 && verify_combined(batch, random)) {
+                for (size_t i : index) {
+                    valid[i] = 1;
+                }
+                continue;
+            }
+            for (size_t j = 0; j < batch.size(); ++j) {
+                valid[index[j]] = verify_parsed(batch[j]) ? 1 : 0;
+            }
+        }
+    };
+
+    // whole batches per worker
+    parallel::for_ranges(count, num_threads, ED25519_BATCH, verify_range);
+    return valid;
+}
+
+} // namespace ec
@@ -0,0 +1,52 @@
+#ifndef ED25519_H
+#define ED25519_H
+// Ed25519 signatures (RFC 8032) on the twisted Edwards curve
+// -x^2 + y^2 = 1 + d x^2 y^2 over GF(2^255 - 19).
+//
+// Points are kept in extended coordinates (X : Y : Z : T) with x = X/Z,
+// y = Y/Z and T = XY/Z, where the same addition formula handles doubling,
+// the identity and negatives, so the arithmetic has no special cases.
+// Signing uses a constant-time fixed-base table; verification is variable
+// time, since everything it handles is public.
+//
+// Verification uses the cofactored equation [8][S]B = [8]R + [8][k]A, so a
+// batch and the signatures in it checked one at a time always agree.
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../common/chacha20.h"
+
+namespace ec {
+
+const int ED25519_KEY_SIZE = 32;
+const int ED25519_SIGNATURE_SIZE = 64;
+
+// Signatures per randomized batch in ed25519_verify_batch
+const size_t ED25519_BATCH = 64;
+
+typedef std::array<uint8_t, ED25519_KEY_SIZE> ed25519_public_key;
+
+struct ed25519_keys {
+    uint8_t public_key[ED25519_KEY_SIZE];
+    uint8_t private_key[ED25519_KEY_SIZE];     // the RFC 8032 seed
+};
+
+struct ed25519_signature {
+    uint8_t bytes[ED25519_SIGNATURE_SIZE];     // R || S
+};
+
+ed25519_keys ed25519_generate_keys();
+ed25519_keys ed25519_generate_keys(rng::chacha20_drbg& random);
+ed25519_keys ed25519_keys_from_seed(const uint8_t seed[ED25519_KEY_SIZE]);
+ed25519_signature ed25519_sign(const ed25519_keys& keys, const std::string& message);
+bool ed25519_verify(const uint8_t public_key[ED25519_KEY_SIZE], const std::string& message,
+                    const ed25519_signature& signature);
+std::vector<uint8_t> ed25519_verify_batch(const std::vector<ed25519_public_key>& public_keys,
+                                          const std::vector<std::string>& messages,
+                                          const std::vector<ed25519_signature>& signatures,
+                                          unsigned int num_threads = 0);
+
+} // namespace ec
+
+#endif
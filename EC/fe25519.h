@@ -0,0 +1,391 @@
+#ifndef FE25519_H
+#define FE25519_H
+// Arithmetic in GF(2^255 - 19), shared by X25519 and Ed25519.
+//
+// An element is five 51-bit limbs, v[0] + v[1] 2^51 + ... + v[4] 2^204.
+// Products are accumulated in 128 bits and carried back to just over 51
+// bits per limb, so sums of a few products can be fed to fe_mul without
+// reducing first. Nothing here branches on the values.
+#include <cstdint>
+#include <cstring>
+
+#if !defined(__SIZEOF_INT128__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ec {
+
+const uint64_t FE_MASK51 = (uint64_t(1) << 51) - 1;
+
+#if defined(__SIZEOF_INT128__)
+typedef unsigned __int128 u128;
+
+inline u128 mul64(uint64_t a, uint64_t b) {
+    return static_cast<u128>(a) * b;
+}
+
+inline uint64_t lo64(u128 v) {
+    return static_cast<uint64_t>(v);
+}
+
+inline uint64_t shr51(u128 v) {
+    return static_cast<uint64_t>(v >> 51);
+}
+#else
+// MSVC has no 128-bit integer; only the operations the field needs
+struct u128 {
+    uint64_t lo;
+    uint64_t hi;
+};
+
+inline u128 mul64(uint64_t a, uint64_t b) {
+    u128 r;
+    r.lo = _umul128(a, b, &r.hi);
+    return r;
+}
+
+inline u128 operator+(u128 a, u128 b) {
+    u128 r;
+    r.lo = a.lo + b.lo;
+    r.hi = a.hi + b.hi + (r.lo < a.lo);
+    return r;
+}
+
+inline u128& operator+=(u128& a, u128 b) {
+    a = a + b;
+    return a;
+}
+
+inline u128& operator+=(u128& a, uint64_t b) {
+    u128 wide = { b, 0 };
+    a = a + wide;
+    return a;
+}
+
+inline uint64_t lo64(u128 v) {
+    return v.lo;
+}
+
+inline uint64_t shr51(u128 v) {
+    return (v.lo >> 51) | (v.hi << 13);
+}
+#endif
+
+/**
+ * A field element, sum of v[i] * 2^(51 i). Limbs may exceed 51 bits
+ * between reductions.
+ */
+struct fe {
+    uint64_t v[5];
+};
+
+inline uint64_t load64_le(const uint8_t* p) {
+    uint64_t r = 0;
+    for (int i = 7; i >= 0; --i) {
+        r = r << 8 | p[i];
+    }
+    return r;
+}
+
+inline void fe_frombytes(fe& h, const uint8_t s[32]) {
+    // the top bit of a u-coordinate is ignored (RFC 7748, section 5)
+    h.v[0] = load64_le(s) & FE_MASK51;
+    h.v[1] = (load64_le(s + 6) >> 3) & FE_MASK51;
+    h.v[2] = (load64_le(s + 12) >> 6) & FE_MASK51;
+    h.v[3] = (load64_le(s + 19) >> 1) & FE_MASK51;
+    h.v[4] = (load64_le(s + 24) >> 12) & FE_MASK51;
+}
+
+inline void fe_carry(uint64_t t[5]) {
+    t[1] += t[0] >> 51; t[0] &= FE_MASK51;
+    t[2] += t[1] >> 51; t[1] &= FE_MASK51;
+    t[3] += t[2] >> 51; t[2] &= FE_MASK51;
+    t[4] += t[3] >> 51; t[3] &= FE_MASK51;
+    t[0] += 19 * (t[4] >> 51); t[4] &= FE_MASK51;
+}
+
+/**
+ * Write the fully reduced value, 0 <= h < p, as 32 little-endian bytes.
+ */
+inline void fe_tobytes(uint8_t s[32], const fe& h) {
+    uint64_t t[5];
+    memcpy(t, h.v, sizeof(t));
+    fe_carry(t);
+    fe_carry(t);
+
+    // t < 2^255 now; add 19 and see whether that carries past 2^255,
+    // i.e. whether t >= p, without branching
+    t[0] += 19;
+    fe_carry(t);
+    t[0] += (uint64_t(1) << 51) - 19;
+    t[1] += (uint64_t(1) << 51) - 1;
+    t[2] += (uint64_t(1) << 51) - 1;
+    t[3] += (uint64_t(1) << 51) - 1;
+    t[4] += (uint64_t(1) << 51) - 1;
+    t[1] += t[0] >> 51; t[0] &= FE_MASK51;
+    t[2] += t[1] >> 51; t[1] &= FE_MASK51;
+    t[3] += t[2] >> 51; t[2] &= FE_MASK51;
+    t[4] += t[3] >> 51; t[3] &= FE_MASK51;
+    t[4] &= FE_MASK51;
+
+    uint64_t words[4] = {
+        t[0] | t[1] << 51,
+        t[1] >> 13 | t[2] << 38,
+        t[2] >> 26 | t[3] << 25,
+        t[3] >> 39 | t[4] << 12
+    };
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            s[8 * i + j] = static_cast<uint8_t>(words[i] >> (8 * j));
+        }
+    }
+}
+
+inline void fe_add(fe& h, const fe& f, const fe& g) {
+    for (int i = 0; i < 5; ++i) {
+        h.v[i] = f.v[i] + g.v[i];
+    }
+}
+
+/**
+ * h = f - g, adding 4p first so no limb goes negative. Inputs must have
+ * limbs below 2^53.
+ */
+inline void fe_sub(fe& h, const fe& f, const fe& g) {
+    h.v[0] = f.v[0] + 0x1fffffffffffb4 - g.v[0];
+    h.v[1] = f.v[1] + 0x1ffffffffffffc - g.v[1];
+    h.v[2] = f.v[2] + 0x1ffffffffffffc - g.v[2];
+    h.v[3] = f.v[3] + 0x1ffffffffffffc - g.v[3];
+    h.v[4] = f.v[4] + 0x1ffffffffffffc - g.v[4];
+    fe_carry(h.v);
+}
+
+/**
+ * Reduce five 128-bit column sums to limbs just over 51 bits.
+ */
+inline void fe_reduce(fe& h, u128 r0, u128 r1, u128 r2, u128 r3, u128 r4) {
+    r1 += shr51(r0);
+    uint64_t h0 = lo64(r0) & FE_MASK51;
+    r2 += shr51(r1);
+    uint64_t h1 = lo64(r1) & FE_MASK51;
+    r3 += shr51(r2);
+    uint64_t h2 = lo64(r2) & FE_MASK51;
+    r4 += shr51(r3);
+    uint64_t h3 = lo64(r3) & FE_MASK51;
+    uint64_t carry = shr51(r4);
+    uint64_t h4 = lo64(r4) & FE_MASK51;
+
+    h0 += carry * 19;
+    h1 += h0 >> 51;
+    h0 &= FE_MASK51;
+
+    h.v[0] = h0;
+    h.v[1] = h1;
+    h.v[2] = h2;
+    h.v[3] = h3;
+    h.v[4] = h4;
+}
+
+inline void fe_mul(fe& h, const fe& f, const fe& g) {
+    const uint64_t* a = f.v;
+    const uint64_t* b = g.v;
+    uint64_t b1_19 = 19 * b[1];
+    uint64_t b2_19 = 19 * b[2];
+    uint64_t b3_19 = 19 * b[3];
+    uint64_t b4_19 = 19 * b[4];
+
+    u128 r0 = mul64(a[0], b[0]);
+    r0 += mul64(a[1], b4_19);
+    r0 += mul64(a[2], b3_19);
+    r0 += mul64(a[3], b2_19);
+    r0 += mul64(a[4], b1_19);
+
+    u128 r1 = mul64(a[0], b[1]);
+    r1 += mul64(a[1], b[0]);
+    r1 += mul64(a[2], b4_19);
+    r1 += mul64(a[3], b3_19);
+    r1 += mul64(a[4], b2_19);
+
+    u128 r2 = mul64(a[0], b[2]);
+    r2 += mul64(a[1], b[1]);
+    r2 += mul64(a[2], b[0]);
+    r2 += mul64(a[3], b4_19);
+    r2 += mul64(a[4], b3_19);
+
+    u128 r3 = mul64(a[0], b[3]);
+    r3 += mul64(a[1], b[2]);
+    r3 += mul64(a[2], b[1]);
+    r3 += mul64(a[3], b[0]);
+    r3 += mul64(a[4], b4_19);
+
+    u128 r4 = mul64(a[0], b[4]);
+    r4 += mul64(a[1], b[3]);
+    r4 += mul64(a[2], b[2]);
+    r4 += mul64(a[3], b[1]);
+    r4 += mul64(a[4], b[0]);
+
+    fe_reduce(h, r0, r1, r2, r3, r4);
+}
+
+inline void fe_sq(fe& h, const fe& f) {
+    const uint64_t* a = f.v;
+    uint64_t a0_2 = 2 * a[0];
+    uint64_t a1_2 = 2 * a[1];
+    uint64_t a1_38 = 38 * a[1];
+    uint64_t a2_38 = 38 * a[2];
+    uint64_t a3_38 = 38 * a[3];
+    uint64_t a3_19 = 19 * a[3];
+    uint64_t a4_19 = 19 * a[4];
+
+    u128 r0 = mul64(a[0], a[0]);
+    r0 += mul64(a1_38, a[4]);
+    r0 += mul64(a2_38, a[3]);
+
+    u128 r1 = mul64(a0_2, a[1]);
+    r1 += mul64(a2_38, a[4]);
+    r1 += mul64(a3_19, a[3]);
+
+    u128 r2 = mul64(a0_2, a[2]);
+    r2 += mul64(a[1], a[1]);
+    r2 += mul64(a3_38, a[4]);
+
+    u128 r3 = mul64(a0_2, a[3]);
+    r3 += mul64(a1_2, a[2]);
+    r3 += mul64(a4_19, a[4]);
+
+    u128 r4 = mul64(a0_2, a[4]);
+    r4 += mul64(a1_2, a[3]);
+    r4 += mul64(a[2], a[2]);
+
+    fe_reduce(h, r0, r1, r2, r3, r4);
+}
+
+inline void fe_mul_small(fe& h, const fe& f, uint64_t c) {
+    fe_reduce(h, mul64(f.v[0], c), mul64(f.v[1], c), mul64(f.v[2], c), mul64(f.v[3], c), mul64(f.v[4], c));
+}
+
+/**
+ * h = f^(2^n): n squarings.
+ */
+inline void fe_sq_n(fe& h, const fe& f, int n) {
+    fe_sq(h, f);
+    for (int i = 1; i < n; ++i) {
+        fe_sq(h, h);
+    }
+}
+
+/**
+ * The common start of the inversion and square root chains: z11 = f^11
+ * and h = f^(2^250 - 1).
+ */
+inline void fe_pow_2_250_1(fe& h, fe& z11, const fe& f) {
+    fe z2, z9, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+
+    fe_sq(z2, f);                       // 2
+    fe_sq_n(t, z2, 2);                  // 8
+    fe_mul(z9, t, f);                   // 9
+    fe_mul(z11, z9, z2);                // 11
+    fe_sq(t, z11);                      // 22
+    fe_mul(z2_5_0, t, z9);              // 2^5 - 1
+    fe_sq_n(t, z2_5_0, 5);
+    fe_mul(z2_10_0, t, z2_5_0);         // 2^10 - 1
+    fe_sq_n(t, z2_10_0, 10);
+    fe_mul(z2_20_0, t, z2_10_0);        // 2^20 - 1
+    fe_sq_n(t, z2_20_0, 20);
+    fe_mul(t, t, z2_20_0);              // 2^40 - 1
+    fe_sq_n(t, t, 10);
+    fe_mul(z2_50_0, t, z2_10_0);        // 2^50 - 1
+    fe_sq_n(t, z2_50_0, 50);
+    fe_mul(z2_100_0, t, z2_50_0);       // 2^100 - 1
+    fe_sq_n(t, z2_100_0, 100);
+    fe_mul(t, t, z2_100_0);             // 2^200 - 1
+    fe_sq_n(t, t, 50);
+    fe_mul(h, t, z2_50_0);              // 2^250 - 1
+}
+
+/**
+ * h = f^(p - 2) = 1 / f.
+ */
+inline void fe_invert(fe& h, const fe& f) {
+    fe t, z11;
+    fe_pow_2_250_1(t, z11, f);
+    fe_sq_n(t, t, 5);                   // 2^255 - 32
+    fe_mul(h, t, z11);                  // 2^255 - 21
+}
+
+/**
+ * h = f^((p - 5) / 8) = f^(2^252 - 3), for square roots.
+ */
+inline void fe_pow22523(fe& h, const fe& f) {
+    fe t, z11;
+    fe_pow_2_250_1(t, z11, f);
+    fe_sq_n(t, t, 2);                   // 2^252 - 4
+    fe_mul(h, t, f);                    // 2^252 - 3
+}
+
+/**
+ * Swap f and g if swap is 1, leave them if it is 0, in constant time.
+ */
+inline void fe_cswap(fe& f, fe& g, uint64_t swap) {
+    uint64_t mask = 0 - swap;
+    for (int i = 0; i < 5; ++i) {
+        uint64_t x = mask & (f.v[i] ^ g.v[i]);
+        f.v[i] ^= x;
+        g.v[i] ^= x;
+    }
+}
+
+inline void fe_zero(fe& h) {
+    memset(&h, 0, sizeof(h));
+}
+
+inline void fe_one(fe& h) {
+    fe_zero(h);
+    h.v[0] = 1;
+}
+
+inline void fe_neg(fe& h, const fe& f) {
+    fe zero;
+    fe_zero(zero);
+    fe_sub(h, zero, f);
+}
+
+/**
+ * Set f to g if move is 1, leave it if it is 0, in constant time.
+ */
+inline void fe_cmov(fe& f, const fe& g, uint64_t move) {
+    uint64_t mask = 0 - move;
+    for (int i = 0; i < 5; ++i) {
+        f.v[i] ^= mask & (f.v[i] ^ g.v[i]);
+    }
+}
+
+/**
+ * @return 1 if the reduced value is odd, the "negative" field elements of
+ *         RFC 8032
+ */
+inline int fe_isnegative(const fe& f) {
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    return s[0] & 1;
+}
+
+inline bool fe_iszero(const fe& f) {
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    uint8_t any = 0;
+    for (uint8_t byte : s) {
+        any |= byte;
+    }
+    return any == 0;
+}
+
+inline bool fe_equal(const fe& f, const fe& g) {
+    fe d;
+    fe_sub(d, f, g);
+    return fe_iszero(d);
+}
+
+} // namespace ec
+
+#endif
@@ -0,0 +1,64 @@
+// main.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+#include "EC.h"
+#include <iostream>
+
+using namespace std;
+using namespace ec;
+
+int main()
+{
+    ec_curve curve;
+    curve.a = 0;
+    curve.b = 7;
+    curve.p = 17;
+
+    cout << "Elliptic Curve: " << endl;
+    cout << "y^2 = x^3 + " << curve.a << "x + " << curve.b << " (mod " << curve.p << ")" << endl;
+
+    ec_point point;
+    point.x = 8;
+    point.y = 3;
+
+    cout << "Point of Reference: " << endl;
+    cout << "(" << point.x << ", " << point.y << ")" << endl;
+
+
+    keys k = generate_keys(curve, point);
+    cout << "Public Key: " << endl;
+    cout << "Q = (" << k.pub_k.Q.x << ", " << k.pub_k.Q.y << ")" << endl;
+
+    cout << "Private Key:" << endl;
+    cout << "d = " << k.pr_k.d << endl;
+
+
+
+    ec_point message;
+    message.x = 1;
+    message.y = 12;
+
+    cout << "Message Point:" << endl;
+    cout << "(" << message.x << ", " << message.y << ")" << endl;
+
+    encrypted e_mes = encryption(curve, point, k.pub_k.Q, message);
+
+    cout << "Encrypted Points:" << endl;
+    cout << "C1: (" << e_mes.C1.x << ", " << e_mes.C1.y << ")" << endl;
+    cout << "C2: (" << e_mes.C2.x << ", " << e_mes.C2.y << ")" << endl;
+
+    ec_point decrypted = decryption(curve, e_mes.C1, e_mes.C2, k.pr_k.d);
+    cout << "Decrypted Point:" << endl;
+    cout << "(" << decrypted.x << ", " << decrypted.y << ")" << endl;
+
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started: 
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
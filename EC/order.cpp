@@ -0,0 +1,324 @@
+// order.cpp : Group orders of curves and orders of points.
+//
+// Uses the 64-bit arithmetic of point64.h, so orders come out right for any
+// prime p that fits ec_curve.
+#include "EC.h"
+#include "point64.h"
+#include "point_table.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+namespace ec {
+
+// Below this p the group order is counted directly from Legendre symbols;
+// above it, by baby-step giant-step over the Hasse interval.
+const int64_t DIRECT_COUNT_LIMIT = 1024;
+
+// Random points tried before baby-step giant-step gives up and counts
+// directly
+const int MAX_ORDER_POINTS = 64;
+
+/**
+ * The cached result for one curve: its order and the primes dividing it.
+ */
+struct curve_group {
+    int64_t order;
+    vector<int64_t> factors;
+};
+
+/**
+ * @return: 1 if a is a non-zero square mod p, -1 if it is not a square and
+ *          0 if a = 0 mod p.
+ */
+int legendre(int64_t a, int64_t p) {
+    a = mod_positive(a, p);
+    if (a == 0) {
+        return 0;
+    }
+    return pow_mod(a, (p - 1) / 2, p) == 1 ? 1 : -1;
+}
+
+/**
+ * Square root mod an odd prime by Tonelli-Shanks.
+ *
+ * @param a: A square mod p.
+ * @param p: The prime.
+ * @return: A root r with r^2 = a (mod p).
+ */
+int64_t sqrt_mod(int64_t a, int64_t p) {
+    a = mod_positive(a, p);
+    if (a == 0) {
+        return 0;
+    }
+
+    int64_t q = p - 1;
+    int s = 0;
+    while (q % 2 == 0) {
+        q /= 2;
+        ++s;
+    }
+    int64_t z = 2;
+    while (legendre(z, p) != -1) {
+        ++z;
+    }
+
+    int64_t m = s;
+    int64_t c = pow_mod(z, q, p);
+    int64_t t = pow_mod(a, q, p);
+    int64_t r = pow_mod(a, (q + 1) / 2, p);
+    while (t != 1) {
+        int64_t i = 0;
+        int64_t t2 = t;
+        while (t2 != 1) {
+            t2 = t2 * t2 % p;
+            ++i;
+        }
+        int64_t b = c;
+        for (int64_t j = 0; j < m - i - 1; ++j) {
+            b = b * b % p;
+        }
+        m = i;
+        c = b * b % p;
+        t = t * c % p;
+        r = r * b % p;
+    }
+    return r;
+}
+
+bool is_prime(int64_t n) {
+    if (n < 2) {
+        return false;
+    }
+    for (int64_t f = 2; f * f <= n; ++f) {
+        if (n % f == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+point64 random_point(const curve64& c, rng::chacha20_drbg& random) {
+    while (true) {
+        int64_t x = random.uniform(static_cast<uint32_t>(c.p));
+        int64_t rhs = (x * x % c.p * x + c.a * x + c.b) % c.p;
+        if (legendre(rhs, c.p) < 0) {
+            continue;
+        }
+        int64_t y = sqrt_mod(rhs, c.p);
+        if (random() & 1) {
+            y = mod_positive(-y, c.p);
+        }
+        return { x, y, false };
+    }
+}
+
+/**
+ * Baby-step giant-step search for an m in [lo, hi] with mP = infinity,
+ * in about 2 sqrt(hi - lo) additions.
+ *
+ * @return: Such an m, or 0 if there is none.
+ */
+int64_t bsgs_multiple(const point64& P, int64_t lo, int64_t hi, const curve64& c) {
+    int64_t steps = 1;
+    while (steps * steps < hi - lo + 1) {
+        ++steps;
+    }
+
+    // baby steps jP, j = 1..steps
+    point_table baby(static_cast<size_t>(steps));
+    point64 jP = P;
+    uint64_t unused;
+    for (int64_t j = 1; j <= steps; ++j) {
+        if (jP.infinity) {
+            return j;
+        }
+        baby.insert(point_key(jP.x, jP.y), static_cast<uint64_t>(j), unused);
+        jP = add64(jP, P, c);
+    }
+
+    // giant steps (lo + i steps) P; a match with +-jP gives m = lo + i steps -+ j
+    point64 giant_step = mult64(P, steps, c);
+    point64 R = mult64(P, lo, c);
+    for (int64_t base = lo; base <= hi + steps; base += steps) {
+        if (R.infinity) {
+            return base;
+        }
+        uint64_t j;
+        if (baby.find(point_key(R.x, R.y), j)) {
+            return base - static_cast<int64_t>(j);
+        }
+        if (baby.find(point_key(R.x, R.y) ^ 1, j)) {
+            return base + static_cast<int64_t>(j);
+        }
+        R = add64(R, giant_step, c);
+    }
+    return 0;
+}
+
+/**
+ * #E = p + 1 + sum over x of the Legendre symbol of x^3 + ax + b.
+ */
+int64_t count_points_direct(const curve64& c) {
+    int64_t count = c.p + 1;
+    for (int64_t x = 0; x < c.p; ++x) {
+        count += legendre(x * x % c.p * x + c.a * x + c.b, c.p);
+    }
+    return count;
+}
+
+/**
+ * Mestre's method: the orders of random points on the curve and on its
+ * quadratic twist narrow #E down to one value of the Hasse interval
+ * [p + 1 - 2 sqrt(p), p + 1 + 2 sqrt(p)], using #E + #E' = 2p + 2.
+ */
+int64_t count_points_bsgs(const curve64& c) {
+    int64_t width = 0;
+    while ((width + 1) * (width + 1) <= 4 * c.p) {
+        ++width;
+    }
+    int64_t lo = c.p + 1 - width;
+    int64_t hi = c.p + 1 + width;
+
+    int64_t g = 2;
+    while (legendre(g, c.p) != -1) {
+        ++g;
+    }
+    curve64 twist = { c.a * g % c.p * g % c.p, c.b * g % c.p * g % c.p * g % c.p, c.p };
+
+    // the same curve always takes the same path
+    uint32_t seed[8] = { static_cast<uint32_t>(c.a), static_cast<uint32_t>(c.b), static_cast<uint32_t>(c.p),
+                         0x6f726465, 0, 0, 0, 0 };
+    rng::chacha20_drbg random(seed);
+
+    int64_t lcm = 1;
+    int64_t twist_lcm = 1;
+    for (int i = 0; i < MAX_ORDER_POINTS; ++i) {
+        bool on_twist = i % 2 == 1;
+        const curve64& e = on_twist ? twist : c;
+        point64 P = random_point(e, random);
+        int64_t m = bsgs_multiple(P, lo, hi, e);
+        if (m <= 0) {
+            continue;
+        }
+        int64_t order = order_from_multiple(P, m, prime_factors(m), e);
+        int64_t& target = on_twist ? twist_lcm : lcm;
+        target = target / gcd64(target, order) * order;
+
+        int64_t found = 0;
+        int candidates = 0;
+        for (int64_t n = (lo + lcm - 1) / lcm * lcm; n <= hi && candidates < 2; n += lcm) {
+            if ((2 * c.p + 2 - n) % twist_lcm == 0) {
+                found = n;
+                ++candidates;
+            }
+        }
+        if (candidates == 1) {
+            return found;
+        }
+    }
+
+    return count_points_direct(c);
+}
+
+/**
+ * Looks up or computes the group of a curve, once per curve.
+ *
+ * @return: The group, with order 0 if the curve is not usable.
+ */
+const curve_group& get_curve_group(ec_curve curve) {
+    static mutex guard;
+    static map<tuple<int64_t, int64_t, int64_t>, curve_group> cache;
+
+    int64_t p = curve.p;
+    int64_t a = p > 0 ? mod_positive(curve.a, p) : 0;
+    int64_t b = p > 0 ? mod_positive(curve.b, p) : 0;
+    auto key = make_tuple(a, b, p);
+    {
+        lock_guard<mutex> lock(guard);
+        auto hit = cache.find(key);
+        if (hit != cache.end()) {
+            return hit->second;
+        }
+    }
+
+    curve_group group;
+    group.order = 0;
+    bool singular = p > 0 && (4 * (a * a % p * a % p) + 27 * (b * b % p)) % p == 0;
+    if (p > 3 && is_prime(p) && !singular) {
+        curve64 c = { a, b, p };
+        group.order = p < DIRECT_COUNT_LIMIT ? count_points_direct(c) : count_points_bsgs(c);
+        group.factors = prime_factors(group.order);
+    }
+
+    lock_guard<mutex> lock(guard);
+    return cache.emplace(key, group).first->second;
+}
+
+/**
+ * Computes the number of points of a curve, the point at infinity
+ * included. Results are cached per curve.
+ *
+ * @param curve: Parameters of the elliptic curve, p an odd prime above 3.
+ * @return: #E(F_p), or 0 if p is not such a prime or the curve is singular.
+ */
+int curve_order(ec_curve curve) {
+    return static_cast<int>(get_curve_group(curve).order);
+}
+
+/**
+ * Finds the order of a point. The order divides #E, so it is #E with every
+ * prime factor removed that P does not need; a few scalar multiplications
+ * instead of a walk over the whole group.
+ *
+ * @param P: A point of the curve.
+ * @param curve: Parameters of the elliptic curve
+ * @return: The smallest n > 0 with nP = infinity, or 0 if P is not on the curve.
+ */
+int point_order(ec_point P, ec_curve curve) {
+    if (!on_curve(P, curve)) {
+        return 0;
+    }
+
+    const curve_group& group = get_curve_group(curve);
+    if (group.order == 0) {
+        // no group law to lean on; walk the multiples instead
+        int order = 1;
+        ec_point R = P;
+        while (!is_infinity(R)) {
+            R = point_sum(R, P, curve);
+            ++order;
+        }
+        return order;
+    }
+
+    curve64 c = { mod_positive(curve.a, curve.p), mod_positive(curve.b, curve.p), curve.p };
+    point64 P64 = { P.x, P.y, false };
+    return static_cast<int>(order_from_multiple(P64, group.order, group.factors, c));
+}
+
+/**
+ * The number of fixed-base table entries P needs: multipliers are reduced
+ * mod the order n of P, so bit_length(n - 1) doublings cover them.
+ *
+ * @param P: The base point.
+ * @param curve: Parameters of the elliptic curve
+ * @return: The table size, at least 1, or 0 if P is not on the curve.
+ */
+int fixed_base_table_size(ec_point P, ec_curve curve) {
+    int order = point_order(P, curve);
+    if (order == 0) {
+        return 0;
+    }
+
+    int bits = 1;
+    while (bits < 31 && ((order - 1) >> bits) != 0) {
+        ++bits;
+    }
+    return bits;
+}
+
+} // namespace ec
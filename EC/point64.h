@@ -0,0 +1,146 @@
+#ifndef POINT64_H
+#define POINT64_H
+// 64-bit affine point arithmetic for the curve analysis code (group
+// orders, discrete logs). Coordinates are below p < 2^31, so every product
+// fits an int64_t and nothing overflows.
+#include <cstdint>
+#include <vector>
+
+namespace ec {
+
+struct point64 {
+    int64_t x;
+    int64_t y;
+    bool infinity;
+};
+
+struct curve64 {
+    int64_t a;
+    int64_t b;
+    int64_t p;
+};
+
+inline int64_t mod_positive(int64_t v, int64_t p) {
+    v %= p;
+    return v < 0 ? v + p : v;
+}
+
+inline int64_t pow_mod(int64_t base, int64_t e, int64_t p) {
+    int64_t result = 1;
+    base = mod_positive(base, p);
+    while (e > 0) {
+        if (e & 1) {
+            result = result * base % p;
+        }
+        base = base * base % p;
+        e >>= 1;
+    }
+    return result;
+}
+
+/**
+ * Inverse mod p by the extended Euclidean algorithm; a must be non-zero.
+ */
+inline int64_t inverse64(int64_t a, int64_t p) {
+    int64_t r0 = p, r1 = mod_positive(a, p);
+    int64_t t0 = 0, t1 = 1;
+    while (r1 != 0) {
+        int64_t q = r0 / r1;
+        int64_t r = r0 - q * r1;
+        r0 = r1;
+        r1 = r;
+        int64_t t = t0 - q * t1;
+        t0 = t1;
+        t1 = t;
+    }
+    return t0 < 0 ? t0 + p : t0;
+}
+
+inline point64 neg64(const point64& P, const curve64& c) {
+    return { P.x, P.infinity ? 0 : mod_positive(-P.y, c.p), P.infinity };
+}
+
+inline bool equal64(const point64& P, const point64& Q) {
+    return P.infinity == Q.infinity && (P.infinity || (P.x == Q.x && P.y == Q.y));
+}
+
+inline point64 add64(const point64& P, const point64& Q, const curve64& c) {
+    if (P.infinity) {
+        return Q;
+    }
+    if (Q.infinity) {
+        return P;
+    }
+
+    int64_t lambda;
+    if (P.x == Q.x) {
+        if ((P.y + Q.y) % c.p == 0) {
+            return { 0, 0, true };
+        }
+        int64_t num = (3 * (P.x * P.x % c.p) + c.a) % c.p;
+        lambda = num * inverse64(2 * P.y, c.p) % c.p;
+    }
+    else {
+        lambda = mod_positive(Q.y - P.y, c.p) * inverse64(Q.x - P.x, c.p) % c.p;
+    }
+
+    int64_t x = mod_positive(lambda * lambda % c.p - P.x - Q.x, c.p);
+    int64_t y = mod_positive(lambda * mod_positive(P.x - x, c.p) % c.p - P.y, c.p);
+    return { x, y, false };
+}
+
+inline point64 mult64(point64 P, int64_t k, const curve64& c) {
+    point64 R = { 0, 0, true };
+    while (k > 0) {
+        if (k & 1) {
+            R = add64(R, P, c);
+        }
+        P = add64(P, P, c);
+        k >>= 1;
+    }
+    return R;
+}
+
+inline std::vector<int64_t> prime_factors(int64_t n) {
+    std::vector<int64_t> factors;
+    for (int64_t f = 2; f * f <= n; ++f) {
+        if (n % f == 0) {
+            factors.push_back(f);
+            while (n % f == 0) {
+                n /= f;
+            }
+        }
+    }
+    if (n > 1) {
+        factors.push_back(n);
+    }
+    return factors;
+}
+
+inline int64_t gcd64(int64_t a, int64_t b) {
+    while (b != 0) {
+        int64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * The exact order of P, given any multiple m with mP = infinity: divide out
+ * each prime of m while the quotient still kills P.
+ */
+inline int64_t order_from_multiple(const point64& P, int64_t m, const std::vector<int64_t>& factors,
+                                   const curve64& c) {
+    int64_t order = m;
+    for (int64_t q : factors) {
+        while (order % q == 0 && mult64(P, order / q, c).infinity) {
+            order /= q;
+        }
+    }
+    return order;
+}
+
+} // namespace ec
+
+#endif
@@ -0,0 +1,156 @@
+// point_table.cpp : The lock-free point hash table and its memory.
+//
+#include "point_table.h"
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0
+#endif
+#endif
+
+using namespace std;
+
+namespace ec {
+
+// Tables at least this large go on huge pages
+const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+/**
+ * Allocates a table with room for the expected number of entries at a load
+ * of at most one half, so probe runs stay short. The memory starts zeroed,
+ * which is every slot free.
+ *
+ * @param expected_entries: How many keys will be inserted.
+ */
+point_table::point_table(size_t expected_entries) {
+    slot_count = 16;
+    while (slot_count < 2 * expected_entries) {
+        slot_count <<= 1;
+    }
+    length = slot_count * sizeof(slot);
+
+#ifdef _WIN32
+    // large pages need a privilege most accounts lack
+    void* memory = _aligned_malloc(length, 64);
+    if (!memory) {
+        throw bad_alloc();
+    }
+    memset(memory, 0, length);
+#else
+    void* memory = MAP_FAILED;
+    if (length >= HUGE_PAGE_SIZE) {
+        length = (length + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        if (MAP_HUGETLB != 0) {
+            // reserved huge pages, if the administrator set any aside
+            memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            on_huge_pages = memory != MAP_FAILED;
+        }
+    }
+    if (memory == MAP_FAILED) {
+        memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw bad_alloc();
+        }
+#ifdef MADV_HUGEPAGE
+        // otherwise transparent huge pages, where the kernel has them
+        if (length >= HUGE_PAGE_SIZE) {
+            on_huge_pages = madvise(memory, length, MADV_HUGEPAGE) == 0;
+        }
+#endif
+    }
+#endif
+
+    // zeroed memory is a valid array of free slots: atomic<uint64_t> is
+    // trivially default-constructible
+    slots = static_cast<slot*>(memory);
+}
+
+point_table::~point_table() {
+#ifdef _WIN32
+    _aligned_free(slots);
+#else
+    munmap(slots, length);
+#endif
+}
+
+/**
+ * The first slot to probe for a key; the multiply spreads the consecutive
+ * x values a walk produces over the whole table.
+ */
+size_t point_table::home(uint64_t stored_key) const {
+    return static_cast<size_t>((stored_key * 0x9e3779b97f4a7c15ULL) >> 32) & (slot_count - 1);
+}
+
+/**
+ * A slot's key is claimed before its value is written; waits out the gap.
+ */
+uint64_t point_table::wait_for_value(const slot& s) const {
+    uint64_t value;
+    while ((value = s.value.load(memory_order_acquire)) == 0) {
+        this_thread::yield();
+    }
+    return value & ~PUBLISHED;
+}
+
+/**
+ * Stores a value under a key unless the key is already present. Safe to
+ * call from any number of threads at once; of several threads inserting
+ * the same key, exactly one gets POINT_TABLE_INSERTED.
+ *
+ * @param key: A point key, below 2^64 - 1.
+ * @param value: The value, below 2^63.
+ * @param existing: Set to the stored value if the key was present.
+ * @return: Whether the value was stored, found or did not fit.
+ */
+point_table_result point_table::insert(uint64_t key, uint64_t value, uint64_t& existing) {
+    uint64_t stored_key = key + 1;
+    size_t mask = slot_count - 1;
+    size_t i = home(stored_key);
+    for (size_t probes = 0; probes < slot_count; ++probes, i = (i + 1) & mask) {
+        uint64_t current = slots[i].key.load(memory_order_acquire);
+        if (current == 0) {
+            if (slots[i].key.compare_exchange_strong(current, stored_key, memory_order_acq_rel)) {
+                slots[i].value.store(value | PUBLISHED, memory_order_release);
+                return POINT_TABLE_INSERTED;
+            }
+            // lost the slot; current now holds the winner's key
+        }
+        if (current == stored_key) {
+            existing = wait_for_value(slots[i]);
+            return POINT_TABLE_FOUND;
+        }
+    }
+    return POINT_TABLE_FULL;
+}
+
+/**
+ * Looks up a key.
+ *
+ * @param key: A point key.
+ * @param value: Set to the stored value if the key is present.
+ * @return: True if the key is present.
+ */
+bool point_table::find(uint64_t key, uint64_t& value) const {
+    uint64_t stored_key = key + 1;
+    size_t mask = slot_count - 1;
+    size_t i = home(stored_key);
+    for (size_t probes = 0; probes < slot_count; ++probes, i = (i + 1) & mask) {
+        uint64_t current = slots[i].key.load(memory_order_acquire);
+        if (current == 0) {
+            return false;
+        }
+        if (current == stored_key) {
+            value = wait_for_value(slots[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace ec
@@ -0,0 +1,66 @@
+#ifndef POINT_TABLE_H
+#define POINT_TABLE_H
+// A fixed-capacity hash table from compressed curve points to 63-bit
+// values, shared by any number of threads without locks: open addressing
+// with linear probing over 16-byte slots, and a slot is claimed by a
+// compare-and-swap on its key. Entries are never removed. Large tables are
+// backed by huge pages where the OS allows it, since the probes land on
+// random pages and would otherwise miss the TLB almost every time.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "EC.h"
+
+namespace ec {
+
+/**
+ * Compresses a point to x and the parity of y; P and -P differ only in the
+ * low bit.
+ */
+inline uint64_t point_key(int64_t x, int64_t y) {
+    return static_cast<uint64_t>(x) << 1 | static_cast<uint64_t>(y & 1);
+}
+
+inline uint64_t point_key(ec_point P) {
+    return point_key(P.x, P.y);
+}
+
+enum point_table_result {
+    POINT_TABLE_INSERTED,   // the key was new and now holds the value
+    POINT_TABLE_FOUND,      // the key was there; its value is returned
+    POINT_TABLE_FULL        // every slot is taken by other keys
+};
+
+class point_table {
+public:
+    explicit point_table(size_t expected_entries);
+    ~point_table();
+    point_table(const point_table&) = delete;
+    point_table& operator=(const point_table&) = delete;
+
+    point_table_result insert(uint64_t key, uint64_t value, uint64_t& existing);
+    bool find(uint64_t key, uint64_t& value) const;
+
+    size_t capacity() const { return slot_count; }
+    bool huge_pages() const { return on_huge_pages; }
+
+private:
+    struct slot {
+        std::atomic<uint64_t> key;      // point key + 1, 0 while free
+        std::atomic<uint64_t> value;    // value | PUBLISHED, 0 until written
+    };
+
+    static const uint64_t PUBLISHED = uint64_t(1) << 63;
+
+    size_t home(uint64_t stored_key) const;
+    uint64_t wait_for_value(const slot& s) const;
+
+    slot* slots = nullptr;
+    size_t slot_count = 0;
+    size_t length = 0;
+    bool on_huge_pages = false;
+};
+
+} // namespace ec
+
+#endif
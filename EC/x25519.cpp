@@ -0,0 +1,122 @@
+// x25519.cpp : The X25519 Montgomery ladder.
+//
+#include "x25519.h"
+#include "fe25519.h"
+#include <cstring>
+
+namespace ec {
+
+/**
+ * The X25519 function: the u-coordinate of scalar * u, with the scalar
+ * clamped as in RFC 7748.
+ *
+ * @param out: Receives the resulting u-coordinate.
+ * @param scalar: The 32-byte scalar.
+ * @param u: The 32-byte input u-coordinate.
+ */
+void x25519(uint8_t out[X25519_SIZE], const uint8_t scalar[X25519_SIZE], const uint8_t u[X25519_SIZE]) {
+    uint8_t k[X25519_SIZE];
+    memcpy(k, scalar, sizeof(k));
+    k[0] &= 248;
+    k[31] &= 127;
+    k[31] |= 64;
+
+    fe x1, x2, z2, x3, z3;
+    fe_frombytes(x1, u);
+    fe_one(x2);
+    fe_zero(z2);
+    x3 = x1;
+    fe_one(z3);
+
+    fe A, AA, B, BB, E, C, D, DA, CB, t;
+    uint64_t swap = 0;
+    for (int pos = 254; pos >= 0; --pos) {
+        uint64_t bit = (k[pos >> 3] >> (pos & 7)) & 1;
+        swap ^= bit;
+        fe_cswap(x2, x3, swap);
+        fe_cswap(z2, z3, swap);
+        swap = bit;
+
+        fe_add(A, x2, z2);
+        fe_sq(AA, A);
+        fe_sub(B, x2, z2);
+        fe_sq(BB, B);
+        fe_sub(E, AA, BB);
+        fe_add(C, x3, z3);
+        fe_sub(D, x3, z3);
+        fe_mul(DA, D, A);
+        fe_mul(CB, C, B);
+
+        fe_add(t, DA, CB);
+        fe_sq(x3, t);
+        fe_sub(t, DA, CB);
+        fe_sq(t, t);
+        fe_mul(z3, x1, t);
+
+        fe_mul(x2, AA, BB);
+        fe_mul_small(t, E, 121665);
+        fe_add(t, AA, t);
+        fe_mul(z2, E, t);
+    }
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+
+    fe_invert(z2, z2);
+    fe_mul(x2, x2, z2);
+    fe_tobytes(out, x2);
+}
+
+/**
+ * X25519 with the base point u = 9, giving the public key of a scalar.
+ *
+ * @param out: Receives the public key.
+ * @param scalar: The 32-byte private key.
+ */
+void x25519_base(uint8_t out[X25519_SIZE], const uint8_t scalar[X25519_SIZE]) {
+    uint8_t base[X25519_SIZE] = { 9 };
+    x25519(out, scalar, base);
+}
+
+/**
+ * Generates an X25519 key pair from the thread's random generator.
+ *
+ * @return: The key pair.
+ */
+x25519_keys x25519_generate_keys() {
+    return x25519_generate_keys(rng::thread_rng());
+}
+
+/**
+ * Generates an X25519 key pair.
+ *
+ * @param random: The random generator to draw the private key from.
+ * @return: The key pair.
+ */
+x25519_keys x25519_generate_keys(rng::chacha20_drbg& random) {
+    x25519_keys keys;
+    random.fill(keys.private_key, sizeof(keys.private_key));
+    x25519_base(keys.public_key, keys.private_key);
+    return keys;
+}
+
+/**
+ * Computes the X25519 shared secret with a peer.
+ *
+ * @param out: Receives the 32-byte shared secret.
+ * @param private_key: Our private key.
+ * @param peer_public: The peer's public key.
+ * @return: False if the result is all zero, i.e. the peer sent a point of
+ *         small order.
+ */
+bool x25519_shared_secret(uint8_t out[X25519_SIZE], const uint8_t private_key[X25519_SIZE],
+                          const uint8_t peer_public[X25519_SIZE]) {
+    x25519(out, private_key, peer_public);
+
+    uint8_t any = 0;
+    for (int i = 0; i < X25519_SIZE; ++i) {
+        any |= out[i];
+    }
+    return any != 0;
+}
+
+} // namespace ec
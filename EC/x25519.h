@@ -0,0 +1,31 @@
+#ifndef X25519_H
+#define X25519_H
+// X25519 key agreement (RFC 7748) on the Montgomery curve
+// y^2 = x^3 + 486662 x^2 + x over GF(2^255 - 19).
+//
+// Field elements are five 51-bit limbs; the scalar multiplication is the
+// x-only Montgomery ladder with constant-time swaps, so its timing does not
+// depend on the private key. Keys and points are 32-byte little-endian
+// strings as in the RFC.
+#include <cstdint>
+#include "../common/chacha20.h"
+
+namespace ec {
+
+const int X25519_SIZE = 32;
+
+struct x25519_keys {
+    uint8_t public_key[X25519_SIZE];
+    uint8_t private_key[X25519_SIZE];
+};
+
+void x25519(uint8_t out[X25519_SIZE], const uint8_t scalar[X25519_SIZE], const uint8_t u[X25519_SIZE]);
+void x25519_base(uint8_t out[X25519_SIZE], const uint8_t scalar[X25519_SIZE]);
+x25519_keys x25519_generate_keys();
+x25519_keys x25519_generate_keys(rng::chacha20_drbg& random);
+bool x25519_shared_secret(uint8_t out[X25519_SIZE], const uint8_t private_key[X25519_SIZE],
+                          const uint8_t peer_public[X25519_SIZE]);
+
+} // namespace ec
+
+#endif
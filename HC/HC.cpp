@@ -1,16 +1,21 @@
+// HC.cpp : Hill cipher encryption, decryption and key analysis.
+//
+#include "HC.h"
+#include "../common/op_counters.h"
+#include "../common/parallel.h"
 #include <iostream>
 #include <string>
-#include <armadillo>
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <vector>
 
 using namespace std;
 using namespace arma;
 
-struct eea {
-    int r;
-    int s;
-    int t;
-};
+namespace hc {
 
 /**
  * @brief Computes the Extended Euclidean Algorithm (EEA) to find the greatest common divisor
@@ -27,6 +32,7 @@ eea compute_eea(int r0, int r1) {
     int t1 = 1;
 
     while (r1 > 0) {
+        MATH241_COUNT(OP_EEA_ITERATION);
         int q = r0 / r1;
         int r2 = r0 - q * r1;
         int s2 = s0 - q * s1;
@@ -59,6 +65,7 @@ eea compute_eea(int r0, int r1) {
  * @throws std::runtime_error if no inverse exists.
  */
 int get_inverse(int a, int modular) {
+    MATH241_COUNT(OP_INVERSION);
     eea a_eea = compute_eea(modular, a);
 
     if (a_eea.r != 1) {
@@ -86,8 +93,12 @@ int get_inverse(int a, int modular) {
  */
 Mat<int> invert_ley_matrix(double key_det, mat key) {
     // first need to invert determinant of key matrix
-    int int_det = int(key_det);
+    // det() works in floating point, so round rather than truncate
+    int int_det = int(lround(key_det));
     int_det %= 26;
+    if (int_det < 0) {
+        int_det += 26;
+    }
     int inverse_det = get_inverse(int_det, 26);
 
     if (inverse_det == -1) {
@@ -120,7 +131,7 @@ Mat<int> invert_ley_matrix(double key_det, mat key) {
             }
 
 
-            int int_d = int(determinant);
+            int int_d = int(lround(determinant));
 
             int_d %= 26;
 
@@ -166,6 +177,7 @@ vector<Mat<int>> encrypt_hill_cipher(vector<Mat<int>> message, Mat<int> key) {
     
 
     // Iterate through each matrix in the message vector
+    MATH241_COUNT_N(OP_HILL_BLOCK, message.size());
     for (const auto& matrix : message) {
         Mat<int> encrypted_matrix = key * matrix;
 
@@ -249,6 +261,7 @@ vector<Mat<int>> decrypt_hill_cipher(vector<Mat<int>> encrypted, Mat<int> invers
 
 
     // Iterate through each matrix in the message vector
+    MATH241_COUNT_N(OP_HILL_BLOCK, encrypted.size());
     for (const auto& matrix : encrypted) {
         Mat<int> decrypted_matrix = inverse_key * matrix;
 
@@ -266,149 +279,699 @@ vector<Mat<int>> decrypt_hill_cipher(vector<Mat<int>> encrypted, Mat<int> invers
 }
 
 
-int main() {
-    cout << "Enter your message: ";
-    string message;
-    getline(cin, message);
-    // transform message into uppercase for simplicity
-    transform(message.begin(), message.end(), message.begin(), toupper);
+// Blocks handed to each worker are a multiple of this count so that chunk
+// boundaries stay block aligned and, for flat int buffers, fall on the same
+// 4 KiB pages (1024 blocks * 3 ints * 4 bytes = 3 pages).
+const size_t HILL_CHUNK_BLOCKS = 1024;
+
+/**
+ * Multiply every 3x1 block of a flat message by the key matrix mod 26.
+ * Gives the same values as encrypt_hill_cipher on the matching Mat blocks.
+ *
+ * @param in the message as consecutive groups of three values 0-25
+ * @param out where the result is written, may not overlap in
+ * @param begin the first block to process
+ * @param end one past the last block to process
+ * @param key the 3x3 key (or inverse key) matrix
+*/
+void apply_hill_blocks(const int* in, int* out, size_t begin, size_t end, const Mat<int>& key) {
+    MATH241_COUNT_N(OP_HILL_BLOCK, end - begin);
+    int k[3][3];
+    for (uword i = 0; i < 3; ++i) {
+        for (uword j = 0; j < 3; ++j) {
+            k[i][j] = key(i, j);
+        }
+    }
+
+    for (size_t b = begin; b < end; ++b) {
+        const int* m = in + 3 * b;
+        int* c = out + 3 * b;
+        for (int i = 0; i < 3; ++i) {
+            c[i] = (k[i][0] * m[0] + k[i][1] * m[1] + k[i][2] * m[2]) % 26;
+        }
+    }
+}
+
+/**
+ * Encrypt a flat message with the Hill Cipher across several threads.
+ *
+ * The output buffer should be freshly allocated and not yet written to
+ * (e.g. new int[len]): every worker writes only its own chunk, so the pages
+ * of that chunk are first touched, and therefore placed, on the NUMA node of
+ * the thread that will use them.
+ *
+ * @param message the message values, length a multiple of 3
+ * @param encrypted the output buffer, same length as message
+ * @param len the number of values in message
+ * @param key the key matrix
+ * @param num_threads the number of workers to use, 0 for one per core
+*/
+void encrypt_hill_cipher_parallel(const int* message, int* encrypted, size_t len,
+                                  const Mat<int>& key, unsigned int num_threads) {
+    parallel::for_ranges(len / 3, num_threads, HILL_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        apply_hill_blocks(message, encrypted, begin, end, key);
+    });
+}
+
+/**
+ * Decrypt a flat message with the Hill Cipher across several threads.
+ * See encrypt_hill_cipher_parallel for the buffer requirements.
+ *
+ * @param encrypted the encrypted values, length a multiple of 3
+ * @param decrypted the output buffer, same length as encrypted
+ * @param len the number of values in encrypted
+ * @param inverse_key the inverse of the key matrix
+ * @param num_threads the number of workers to use, 0 for one per core
+*/
+void decrypt_hill_cipher_parallel(const int* encrypted, int* decrypted, size_t len,
+                                  const Mat<int>& inverse_key, unsigned int num_threads) {
+    parallel::for_ranges(len / 3, num_threads, HILL_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        apply_hill_blocks(encrypted, decrypted, begin, end, inverse_key);
+    });
+}
+
+/**
+ * Parallel version of encrypt_hill_cipher. Each worker fills its own range
+ * of the result, so the output is identical to the serial version.
+ *
+ * @param message a vector of 3x1 matrices of the message
+ * @param key the key matrix
+ * @param num_threads the number of workers to use, 0 for one per core
+ *
+ * @return the encrypted message
+*/
+vector<Mat<int>> encrypt_hill_cipher_parallel(const vector<Mat<int>>& message, const Mat<int>& key,
+                                              unsigned int num_threads) {
+    vector<Mat<int>> encrypted(message.size());
+
+    parallel::for_ranges(message.size(), num_threads, HILL_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        MATH241_COUNT_N(OP_HILL_BLOCK, end - begin);
+        for (size_t b = begin; b < end; ++b) {
+            Mat<int> encrypted_matrix = key * message[b];
+
+            for (uword i = 0; i < encrypted_matrix.n_rows; ++i) {
+                for (uword j = 0; j < encrypted_matrix.n_cols; ++j) {
+                    encrypted_matrix(i, j) %= 26;
+                }
+            }
+
+            encrypted[b] = encrypted_matrix;
+        }
+    });
+
+    return encrypted;
+}
+
+/**
+ * Parallel version of decrypt_hill_cipher.
+ *
+ * @param encrypted a vector of 3x1 matrices of the encrypted message
+ * @param inverse_key the inverse of the key matrix
+ * @param num_threads the number of workers to use, 0 for one per core
+ *
+ * @return the decrypted message
+*/
+vector<Mat<int>> decrypt_hill_cipher_parallel(const vector<Mat<int>>& encrypted, const Mat<int>& inverse_key,
+                                              unsigned int num_threads) {
+    return encrypt_hill_cipher_parallel(encrypted, inverse_key, num_threads);
+}
+
+
+/**
+ * Build the column product tables for a key matrix.
+ *
+ * @param key the key (or inverse key) matrix with entries 0-25
+ * @return the lookup tables for key
+*/
+hill_table build_hill_table(const Mat<int>& key) {
+    hill_table table;
+
+    for (int j = 0; j < 3; ++j) {
+        for (int m = 0; m < 26; ++m) {
+            for (int i = 0; i < 3; ++i) {
+                table.col[j][m][i] = static_cast<unsigned char>((key(i, j) * m) % 26);
+            }
+            table.col[j][m][3] = 0;
+        }
+    }
+
+    return table;
+}
+
+/**
+ * Apply a key to a range of flat message blocks using its lookup tables.
+ * Message values must already be in 0-25.
+ *
+ * @param table the tables built from the key
+ * @param in the message as consecutive groups of three values
+ * @param out where the result is written
+ * @param begin the first block to process
+ * @param end one past the last block to process
+*/
+void apply_hill_table(const hill_table& table, const int* in, int* out, size_t begin, size_t end) {
+    MATH241_COUNT_N(OP_HILL_BLOCK, end - begin);
+    for (size_t b = begin; b < end; ++b) {
+        const unsigned char* c0 = table.col[0][in[3 * b]];
+        const unsigned char* c1 = table.col[1][in[3 * b + 1]];
+        const unsigned char* c2 = table.col[2][in[3 * b + 2]];
+
+        for (int i = 0; i < 3; ++i) {
+            int sum = c0[i] + c1[i];
+            if (sum >= 26) {
+                sum -= 26;
+            }
+            sum += c2[i];
+            if (sum >= 26) {
+                sum -= 26;
+            }
+            out[3 * b + i] = sum;
+        }
+    }
+}
+
+/**
+ * Encrypt the message using the Hill Cipher with the chosen engine.
+ * Both engines give the same result for message values 0-25.
+ *
+ * @param message a vector of 3x1 matrices of the message
+ * @param key the key matrix
+ * @param engine which engine to use
+ *
+ * @return the encrypted message
+*/
+vector<Mat<int>> encrypt_hill_cipher(const vector<Mat<int>>& message, const Mat<int>& key, hill_engine engine) {
+    if (engine == HILL_ENGINE_MATRIX) {
+        return encrypt_hill_cipher(message, key);
+    }
 
-    message.erase(remove_if(message.begin(), message.end(), ::isspace), message.end());
+    hill_table table = build_hill_table(key);
+    vector<Mat<int>> encrypted;
+    encrypted.reserve(message.size());
 
+    for (const auto& matrix : message) {
+        int in[3] = { matrix(0), matrix(1), matrix(2) };
+        int out[3];
+        apply_hill_table(table, in, out, 0, 1);
 
-    int message_len = message.length();
-    int rem = message_len % 3;
-    // pad message with As if message not divisible by 3
-    if (rem != 0) {
-        int to_add = 3 - rem;
-        for (int i = 0; i < to_add; i++) {
-            message.push_back('A');
+        Mat<int> encrypted_matrix(3, 1);
+        for (uword i = 0; i < 3; ++i) {
+            encrypted_matrix(i) = out[i];
         }
+        encrypted.push_back(encrypted_matrix);
     }
-    message_len = message.length();
 
-    char* message_ints = new char[message_len];
-    for (int i = 0; i < message_len; ++i) {
-        message_ints[i] = (message[i] - 'A') % 26;
+    return encrypted;
+}
+
+/**
+ * Decrypt the message using the Hill Cipher with the chosen engine.
+ *
+ * @param encrypted a vector of 3x1 matrices of the encrypted message
+ * @param inverse_key the inverse of the key matrix
+ * @param engine which engine to use
+ *
+ * @return the decrypted message
+*/
+vector<Mat<int>> decrypt_hill_cipher(const vector<Mat<int>>& encrypted, const Mat<int>& inverse_key, hill_engine engine) {
+    if (engine == HILL_ENGINE_MATRIX) {
+        return decrypt_hill_cipher(encrypted, inverse_key);
     }
 
-    cout << "ASCII values of characters in the message:" << endl;
-    for (int i = 0; i < message_len; ++i) {
-        cout << static_cast<int>(message_ints[i]) << " ";
+    return encrypt_hill_cipher(encrypted, inverse_key, engine);
+}
+
+/**
+ * Encrypt a flat message across several threads with the chosen engine.
+ * See encrypt_hill_cipher_parallel for the buffer requirements.
+ *
+ * @param message the message values 0-25, length a multiple of 3
+ * @param encrypted the output buffer, same length as message
+ * @param len the number of values in message
+ * @param key the key matrix
+ * @param engine which engine to use
+ * @param num_threads the number of workers to use, 0 for one per core
+*/
+void encrypt_hill_cipher_parallel(const int* message, int* encrypted, size_t len, const Mat<int>& key,
+                                  hill_engine engine, unsigned int num_threads) {
+    if (engine == HILL_ENGINE_MATRIX) {
+        encrypt_hill_cipher_parallel(message, encrypted, len, key, num_threads);
+        return;
+    }
+
+    hill_table table = build_hill_table(key);
+    parallel::for_ranges(len / 3, num_threads, HILL_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        apply_hill_table(table, message, encrypted, begin, end);
+    });
+}
+
+
+/**
+ * Split a string of letters into 3x1 message blocks, dropping anything that
+ * is not a letter and padding the end with As.
+ *
+ * @param text the text to split
+ * @return the blocks with values 0-25
+*/
+vector<Mat<int>> text_to_blocks(const string& text) {
+    vector<int> values;
+    for (char c : text) {
+        if (isalpha(static_cast<unsigned char>(c))) {
+            values.push_back(toupper(static_cast<unsigned char>(c)) - 'A');
+        }
+    }
+    while (values.size() % 3 != 0) {
+        values.push_back(0);
     }
-    cout << endl;
 
-    vector<Mat<int>> message_matrices;
-    for (int i = 0; i < message_len; i += 3) {
+    vector<Mat<int>> blocks;
+    for (size_t i = 0; i < values.size(); i += 3) {
         Mat<int> next(3, 1);
+        for (uword j = 0; j < 3; ++j) {
+            next(j) = values[i + j];
+        }
+        blocks.push_back(next);
+    }
+
+    return blocks;
+}
+
+/**
+ * Solve K * p_b = c_b for the 3x3 matrix K modulo a prime q using Gaussian
+ * elimination over every block pair.
+ *
+ * @param plain the known plaintext blocks
+ * @param cipher the matching ciphertext blocks
+ * @param q the prime modulus
+ * @param out where K mod q is written
+ * @return True if the pairs determine K mod q, False otherwise
+*/
+bool solve_key_mod_prime(const vector<Mat<int>>& plain, const vector<Mat<int>>& cipher, int q, int out[3][3]) {
+    // each row is [p0 p1 p2 | c0 c1 c2], the unknowns are the rows of K
+    size_t n = plain.size();
+    vector<array<int, 6>> rows(n);
+    for (size_t b = 0; b < n; ++b) {
         for (int j = 0; j < 3; ++j) {
-            next(j) = message_ints[i + j];
+            rows[b][j] = ((plain[b](j) % q) + q) % q;
+            rows[b][3 + j] = ((cipher[b](j) % q) + q) % q;
         }
-        message_matrices.push_back(next);
     }
 
-    for (size_t i = 0; i < message_matrices.size(); ++i) {
-        cout << "Matrix of Message Portion " << i + 1 << ":" << endl;
-        cout << message_matrices[i] << endl;
+    size_t pivot_row = 0;
+    for (int col = 0; col < 3; ++col) {
+        size_t found = pivot_row;
+        while (found < n && rows[found][col] == 0) {
+            ++found;
+        }
+        if (found == n) {
+            return false;
+        }
+        swap(rows[pivot_row], rows[found]);
+
+        int inv = get_inverse(rows[pivot_row][col], q);
+        for (int k = 0; k < 6; ++k) {
+            rows[pivot_row][k] = rows[pivot_row][k] * inv % q;
+        }
+
+        for (size_t r = 0; r < n; ++r) {
+            if (r == pivot_row || rows[r][col] == 0) {
+                continue;
+            }
+            int factor = rows[r][col];
+            for (int k = 0; k < 6; ++k) {
+                rows[r][k] = ((rows[r][k] - factor * rows[pivot_row][k]) % q + q) % q;
+            }
+        }
+        ++pivot_row;
     }
 
-    
+    // rows 0-2 now read [I | K^T]
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            out[i][j] = rows[j][3 + i];
+        }
+    }
 
-    mat key(3, 3);
-    Mat<int> key_int(3, 3);
-    Mat<int> key_inv_int(3, 3);
-    key.zeros();
-    key_int.zeros();
-    char* key_arr = new char[9 + 1];
-    int key_ints[9 + 1];
-    bool inverse = false;
-    do {
-        string init_key = "";
-        cout << "Enter 9 Letters to be the Key (no spaces): ";
-        cin >> init_key;
-
-        int key_len = init_key.length();
-        if (key_len != 9) {
-            cout << "Key does not have a length of 9!" << endl;
-            continue;
+    return true;
+}
+
+/**
+ * Recover the key matrix from known plaintext/ciphertext block pairs.
+ *
+ * First looks for three plaintext blocks that form an invertible matrix P,
+ * in which case K = C * P^-1 using invert_ley_matrix. If no such triple
+ * exists the system is solved separately mod 2 and mod 13 over all pairs and
+ * the results are combined with the Chinese Remainder Theorem.
+ *
+ * @param plain the known plaintext blocks
+ * @param cipher the matching ciphertext blocks
+ * @return the key matrix, or an empty matrix if the pairs do not determine it
+*/
+Mat<int> recover_key_known_plaintext(const vector<Mat<int>>& plain, const vector<Mat<int>>& cipher) {
+    size_t n = min(plain.size(), cipher.size());
+
+    for (size_t a = 0; a < n; ++a) {
+        for (size_t b = a + 1; b < n; ++b) {
+            for (size_t c = b + 1; c < n; ++c) {
+                mat p(3, 3);
+                Mat<int> cm(3, 3);
+                size_t picked[3] = { a, b, c };
+                for (uword j = 0; j < 3; ++j) {
+                    for (uword i = 0; i < 3; ++i) {
+                        p(i, j) = plain[picked[j]](i);
+                        cm(i, j) = cipher[picked[j]](i);
+                    }
+                }
+
+                Mat<int> p_inv = invert_ley_matrix(det(p), p);
+                if (p_inv.is_empty()) {
+                    continue;
+                }
+
+                Mat<int> key = cm * p_inv;
+                for (uword i = 0; i < 3; ++i) {
+                    for (uword j = 0; j < 3; ++j) {
+                        key(i, j) %= 26;
+                    }
+                }
+                return key;
+            }
         }
-        // transform to uppercase for simplicity
-        transform(init_key.begin(), init_key.end(), init_key.begin(), toupper);
+    }
 
-        for (int i = 0; i < 9; ++i) {
-            key_arr[i] = init_key[i];
+    vector<Mat<int>> used_plain(plain.begin(), plain.begin() + n);
+    vector<Mat<int>> used_cipher(cipher.begin(), cipher.begin() + n);
+    int k2[3][3];
+    int k13[3][3];
+    if (!solve_key_mod_prime(used_plain, used_cipher, 2, k2) ||
+        !solve_key_mod_prime(used_plain, used_cipher, 13, k13)) {
+        Mat<int> key;
+        return key;
+    }
+
+    Mat<int> key(3, 3);
+    for (uword i = 0; i < 3; ++i) {
+        for (uword j = 0; j < 3; ++j) {
+            key(i, j) = (13 * k2[i][j] + 14 * k13[i][j]) % 26;
         }
-        key_arr[9] = '\0';
+    }
 
+    return key;
+}
 
+// English letter frequencies in percent, A-Z
+const double ENGLISH_FREQ[26] = {
+    8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966, 0.153, 0.772, 4.025, 2.406,
+    6.749, 7.507, 1.929, 0.095, 5.987, 6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074
+};
 
-        // Convert each character to its ASCII value modulo 26
-        for (int i = 0; i < 9; ++i) {
-            // Convert character to ASCII value
-            int ascii_value = key_arr[i];
-            // Apply modulo 26
-            int mod_value = (ascii_value - 'A') % 26;
-            key_ints[i] = mod_value;
+// Most common English bigrams, used to put the recovered rows in order
+const char* const ENGLISH_BIGRAMS[] = {
+    "TH", "HE", "IN", "ER", "AN", "RE", "ON", "AT", "EN", "ND",
+    "TI", "ES", "OR", "TE", "OF", "ED", "IS", "IT", "AL", "AR"
+};
+
+/**
+ * Score every possible row of the inverse key against the ciphertext.
+ *
+ * Row i of the inverse key alone decides plaintext letter i of every block,
+ * so the 26^9 key space splits into three independent searches over 26^3
+ * rows. Rows whose entries share a factor with 26 can never be part of an
+ * invertible matrix and are pruned. The candidates are split across worker
+ * threads; the ciphertext is kept as separate byte columns so the per-row
+ * decryption loop is branch-free and vectorizes.
+ *
+ * @param encrypted the ciphertext blocks
+ * @param keep how many of the best rows to return
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @return the best rows, best first
+*/
+vector<hill_row_candidate> search_inverse_rows(const vector<Mat<int>>& encrypted, size_t keep,
+                                               unsigned int num_threads) {
+    size_t n = encrypted.size();
+    vector<unsigned char> c0(n), c1(n), c2(n);
+    for (size_t b = 0; b < n; ++b) {
+        c0[b] = static_cast<unsigned char>(encrypted[b](0));
+        c1[b] = static_cast<unsigned char>(encrypted[b](1));
+        c2[b] = static_cast<unsigned char>(encrypted[b](2));
+    }
+
+    // mult[x][y] = x * y % 26
+    unsigned char mult[26][26];
+    for (int x = 0; x < 26; ++x) {
+        for (int y = 0; y < 26; ++y) {
+            mult[x][y] = static_cast<unsigned char>(x * y % 26);
         }
+    }
 
-        // Convert key_ints to the key matrix
-        int index = 0;
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 0; j < 3; ++j) {
-                key.at(i, j) = key_ints[index++];
+    const size_t total = 26 * 26 * 26;
+    vector<hill_row_candidate> all(total);
+    vector<char> valid(total, 0);
+
+    parallel::for_ranges(total, num_threads, HILL_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        vector<unsigned char> partial(n);
+        vector<unsigned char> letters(n);
+        int last_ab = -1;
+
+        for (size_t cand = begin; cand < end; ++cand) {
+            int a = static_cast<int>(cand / 676);
+            int b = static_cast<int>(cand / 26 % 26);
+            int c = static_cast<int>(cand % 26);
+
+            if ((a % 2 == 0 && b % 2 == 0 && c % 2 == 0) || (a % 13 == 0 && b % 13 == 0 && c % 13 == 0)) {
+                continue;
+            }
+
+            // a*c0 + b*c1 is shared by the 26 candidates with the same a, b
+            if (a * 26 + b != last_ab) {
+                const unsigned char* ma = mult[a];
+                const unsigned char* mb = mult[b];
+                for (size_t k = 0; k < n; ++k) {
+                    unsigned char s = ma[c0[k]] + mb[c1[k]];
+                    partial[k] = s >= 26 ? s - 26 : s;
+                }
+                last_ab = a * 26 + b;
+            }
+
+            const unsigned char* mc = mult[c];
+            for (size_t k = 0; k < n; ++k) {
+                unsigned char s = partial[k] + mc[c2[k]];
+                letters[k] = s >= 26 ? s - 26 : s;
+            }
+
+            size_t counts[26] = { 0 };
+            for (size_t k = 0; k < n; ++k) {
+                ++counts[letters[k]];
             }
+
+            double chi = 0;
+            for (int l = 0; l < 26; ++l) {
+                double expected = ENGLISH_FREQ[l] * n / 100.0;
+                double diff = counts[l] - expected;
+                chi += diff * diff / expected;
+            }
+
+            all[cand] = { { a, b, c }, chi };
+            valid[cand] = 1;
         }
+    });
+
+    vector<hill_row_candidate> candidates;
+    for (size_t cand = 0; cand < total; ++cand) {
+        if (valid[cand]) {
+            candidates.push_back(all[cand]);
+        }
+    }
 
+    keep = min(keep, candidates.size());
+    partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+        [](const hill_row_candidate& x, const hill_row_candidate& y) { return x.score < y.score; });
+    candidates.resize(keep);
 
-        // check for inverse
-        double detA = det(key);
-        if (detA == 0) {
-            cout << "This key does not have an inverse!" << endl;
-            continue;
+    return candidates;
+}
+
+/**
+ * Recover the key matrix from ciphertext alone.
+ *
+ * Takes the best scoring inverse key rows from search_inverse_rows, tries
+ * every ordered choice of three of them that forms an invertible matrix,
+ * and keeps the one whose decryption contains the most common English
+ * bigrams. Needs a few hundred letters of ordinary English to be reliable.
+ *
+ * @param encrypted the ciphertext blocks
+ * @param inverse_key where the recovered inverse key is written
+ * @param keep how many candidate rows to combine
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @return the key matrix, or an empty matrix if nothing invertible was found
+*/
+Mat<int> recover_key_ciphertext_only(const vector<Mat<int>>& encrypted, Mat<int>& inverse_key,
+                                     size_t keep, unsigned int num_threads) {
+    vector<hill_row_candidate> rows = search_inverse_rows(encrypted, keep, num_threads);
+
+    Mat<int> best_key;
+    int best_hits = -1;
+
+    for (size_t r0 = 0; r0 < rows.size(); ++r0) {
+        for (size_t r1 = 0; r1 < rows.size(); ++r1) {
+            for (size_t r2 = 0; r2 < rows.size(); ++r2) {
+                if (r0 == r1 || r0 == r2 || r1 == r2) {
+                    continue;
+                }
+
+                mat candidate(3, 3);
+                size_t picked[3] = { r0, r1, r2 };
+                for (uword i = 0; i < 3; ++i) {
+                    for (uword j = 0; j < 3; ++j) {
+                        candidate(i, j) = rows[picked[i]].row[j];
+                    }
+                }
+
+                // the inverse of the inverse key is the key
+                Mat<int> key = invert_ley_matrix(det(candidate), candidate);
+                if (key.is_empty()) {
+                    continue;
+                }
+
+                Mat<int> candidate_int = conv_to<Mat<int>>::from(candidate);
+                string text;
+                for (const auto& block : decrypt_hill_cipher(encrypted, candidate_int, HILL_ENGINE_TABLE)) {
+                    for (uword j = 0; j < 3; ++j) {
+                        text.push_back(static_cast<char>(block(j) + 'A'));
+                    }
+                }
+
+                int hits = 0;
+                for (size_t k = 0; k + 1 < text.size(); ++k) {
+                    for (const char* bigram : ENGLISH_BIGRAMS) {
+                        if (text[k] == bigram[0] && text[k + 1] == bigram[1]) {
+                            ++hits;
+                        }
+                    }
+                }
+
+                if (hits > best_hits) {
+                    best_hits = hits;
+                    best_key = key;
+                    inverse_key = candidate_int;
+                }
+            }
         }
+    }
+
+    return best_key;
+}
 
-        key_int = conv_to<Mat<int>>::from(key);
 
-        cout << "Key Matrix " << endl;
-        cout << key_int << endl;
+/**
+ * Validate a 9 letter key and precompute its inverse and lookup tables.
+ *
+ * @param key_string the key, 9 letters in any case
+ * @param schedule where the schedule is written
+ * @return True if the key is valid and invertible mod 26, False otherwise
+*/
+bool build_key_schedule(const string& key_string, hill_key_schedule& schedule) {
+    if (key_string.length() != 9) {
+        return false;
+    }
 
-        key_inv_int = invert_ley_matrix(detA, key);
-        if (key_inv_int.is_empty()) {
-            cout << "This key does not have an inverse!" << endl;
-            continue;
+    mat key(3, 3);
+    schedule.key_string = key_string;
+    for (int i = 0; i < 9; ++i) {
+        unsigned char c = static_cast<unsigned char>(key_string[i]);
+        if (!isalpha(c)) {
+            return false;
         }
-        inverse = true;
+        schedule.key_string[i] = static_cast<char>(toupper(c));
+        key.at(i / 3, i % 3) = schedule.key_string[i] - 'A';
+    }
 
-    } while (!inverse);
+    schedule.inverse_key = invert_ley_matrix(det(key), key);
+    if (schedule.inverse_key.is_empty()) {
+        return false;
+    }
 
-    cout << "Key Matrix " << endl;
-    cout << key_int << endl;
-    cout << "Key Inverse Matrix " << endl;
-    cout << key_inv_int << endl;
+    schedule.key = conv_to<Mat<int>>::from(key);
+    schedule.encrypt_table = build_hill_table(schedule.key);
+    schedule.decrypt_table = build_hill_table(schedule.inverse_key);
 
+    return true;
+}
 
-    vector<Mat<int>> encrypted = encrypt_hill_cipher(message_matrices, key_int);
+/**
+ * Look up the schedule for a key, building it on a miss.
+ *
+ * @param key_string the key, 9 letters in any case
+ * @return the schedule, or nullptr if the key is not invertible
+*/
+shared_ptr<const hill_key_schedule> hill_key_cache::get(const string& key_string) {
+    string normalized = key_string;
+    for (auto& c : normalized) {
+        c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
 
-    print_encrypted(encrypted);
+    lock_guard<mutex> lock(guard);
 
-    vector<Mat<int>> decrypted = decrypt_hill_cipher(encrypted, key_inv_int);
+    auto found = index.find(normalized);
+    if (found != index.end()) {
+        // move to the front, the most recently used end
+        entries.splice(entries.begin(), entries, found->second);
+        return found->second->second;
+    }
 
+    shared_ptr<hill_key_schedule> schedule = make_shared<hill_key_schedule>();
+    if (!build_key_schedule(normalized, *schedule)) {
+        schedule.reset();
+    }
 
-    print_decrypted(decrypted);
+    entries.emplace_front(normalized, schedule);
+    index[normalized] = entries.begin();
 
-    delete[] key_arr;
+    if (entries.size() > capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
 
-    return 0;
+    return schedule;
+}
+
+/**
+ * @return the number of keys currently cached, valid or not
+*/
+size_t hill_key_cache::size() const {
+    lock_guard<mutex> lock(guard);
+    return entries.size();
+}
 
+/**
+ * Encrypt a flat message with a cached key schedule using its tables.
+ *
+ * @param schedule the key schedule
+ * @param message the message values 0-25, length a multiple of 3
+ * @param encrypted the output buffer, same length as message
+ * @param len the number of values in message
+ * @param num_threads the number of workers to use, 0 for one per core
+*/
+void encrypt_hill_cipher(const hill_key_schedule& schedule, const int* message, int* encrypted, size_t len,
+                         unsigned int num_threads) {
+    parallel::for_ranges(len / 3, num_threads, HILL_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        apply_hill_table(schedule.encrypt_table, message, encrypted, begin, end);
+    });
 }
 
-// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
-// Debug program: F5 or Debug > Start Debugging menu
+/**
+ * Decrypt a flat message with a cached key schedule using its tables.
+ *
+ * @param schedule the key schedule
+ * @param encrypted the encrypted values 0-25, length a multiple of 3
+ * @param decrypted the output buffer, same length as encrypted
+ * @param len the number of values in encrypted
+ * @param num_threads the number of workers to use, 0 for one per core
+*/
+void decrypt_hill_cipher(const hill_key_schedule& schedule, const int* encrypted, int* decrypted, size_t len,
+                         unsigned int num_threads) {
+    parallel::for_ranges(len / 3, num_threads, HILL_CHUNK_BLOCKS, [&](size_t begin, size_t end) {
+        apply_hill_table(schedule.decrypt_table, encrypted, decrypted, begin, end);
+    });
+}
 
-// Tips for Getting Started: 
-//   1. Use the Solution Explorer window to add/manage files
-//   2. Use the Team Explorer window to connect to source control
-//   3. Use the Output window to see build output and other messages
-//   4. Use the Error List window to view errors
-//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
-//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
\ No newline at end of file
+} // namespace hc
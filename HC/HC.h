@@ -0,0 +1,127 @@
+#ifndef HC_H
+#define HC_H
+#include <armadillo>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hc {
+
+struct eea {
+    int r;
+    int s;
+    int t;
+};
+
+/**
+ * Engines that can be used to apply a key matrix to message blocks
+ */
+enum hill_engine {
+    HILL_ENGINE_MATRIX,     // Armadillo matrix product, then mod 26
+    HILL_ENGINE_TABLE       // precomputed column products, no multiplies
+};
+
+/**
+ * Lookup tables for one 3x3 key matrix. col[j][m] holds column j of the key
+ * multiplied by m and reduced mod 26, so a block (m0, m1, m2) becomes
+ * col[0][m0] + col[1][m1] + col[2][m2]. Rows are padded to 4 bytes, the
+ * whole table is 312 bytes and stays in L1.
+ */
+struct hill_table {
+    unsigned char col[3][26][4];
+};
+
+/**
+ * A candidate row of the inverse key and its chi-squared score against
+ * English letter frequencies (lower is better).
+ */
+struct hill_row_candidate {
+    int row[3];
+    double score;
+};
+
+/**
+ * Everything needed to encrypt and decrypt with one key, computed once when
+ * the key is first seen
+ */
+struct hill_key_schedule {
+    std::string key_string;
+    arma::Mat<int> key;
+    arma::Mat<int> inverse_key;
+    hill_table encrypt_table;
+    hill_table decrypt_table;
+};
+
+/**
+ * Bounded least-recently-used cache of key schedules keyed by the 9 letter
+ * key. Rejected keys are remembered too, so asking again for a bad key is
+ * also just a lookup. Safe to share between threads.
+ */
+class hill_key_cache {
+public:
+    explicit hill_key_cache(size_t capacity = 64) : capacity(capacity > 0 ? capacity : 1) {}
+
+    std::shared_ptr<const hill_key_schedule> get(const std::string& key_string);
+    size_t size() const;
+
+private:
+    typedef std::pair<std::string, std::shared_ptr<const hill_key_schedule>> entry;
+
+    size_t capacity;
+    std::list<entry> entries;
+    std::unordered_map<std::string, std::list<entry>::iterator> index;
+    mutable std::mutex guard;
+};
+
+eea compute_eea(int r0, int r1);
+int get_inverse(int a, int modular);
+arma::Mat<int> invert_ley_matrix(double key_det, arma::mat key);
+
+std::vector<arma::Mat<int>> encrypt_hill_cipher(std::vector<arma::Mat<int>> message, arma::Mat<int> key);
+std::vector<arma::Mat<int>> decrypt_hill_cipher(std::vector<arma::Mat<int>> encrypted, arma::Mat<int> inverse_key);
+void print_encrypted(std::vector<arma::Mat<int>> encrypted);
+void print_decrypted(std::vector<arma::Mat<int>> decrypted);
+
+void apply_hill_blocks(const int* in, int* out, size_t begin, size_t end, const arma::Mat<int>& key);
+void encrypt_hill_cipher_parallel(const int* message, int* encrypted, size_t len,
+                                  const arma::Mat<int>& key, unsigned int num_threads = 0);
+void decrypt_hill_cipher_parallel(const int* encrypted, int* decrypted, size_t len,
+                                  const arma::Mat<int>& inverse_key, unsigned int num_threads = 0);
+std::vector<arma::Mat<int>> encrypt_hill_cipher_parallel(const std::vector<arma::Mat<int>>& message,
+                                                         const arma::Mat<int>& key, unsigned int num_threads = 0);
+std::vector<arma::Mat<int>> decrypt_hill_cipher_parallel(const std::vector<arma::Mat<int>>& encrypted,
+                                                         const arma::Mat<int>& inverse_key, unsigned int num_threads = 0);
+
+hill_table build_hill_table(const arma::Mat<int>& key);
+void apply_hill_table(const hill_table& table, const int* in, int* out, size_t begin, size_t end);
+std::vector<arma::Mat<int>> encrypt_hill_cipher(const std::vector<arma::Mat<int>>& message,
+                                                const arma::Mat<int>& key, hill_engine engine);
+std::vector<arma::Mat<int>> decrypt_hill_cipher(const std::vector<arma::Mat<int>>& encrypted,
+                                                const arma::Mat<int>& inverse_key, hill_engine engine);
+void encrypt_hill_cipher_parallel(const int* message, int* encrypted, size_t len, const arma::Mat<int>& key,
+                                  hill_engine engine, unsigned int num_threads = 0);
+
+std::vector<arma::Mat<int>> text_to_blocks(const std::string& text);
+bool solve_key_mod_prime(const std::vector<arma::Mat<int>>& plain, const std::vector<arma::Mat<int>>& cipher,
+                         int q, int out[3][3]);
+arma::Mat<int> recover_key_known_plaintext(const std::vector<arma::Mat<int>>& plain,
+                                           const std::vector<arma::Mat<int>>& cipher);
+std::vector<hill_row_candidate> search_inverse_rows(const std::vector<arma::Mat<int>>& encrypted, size_t keep,
+                                                    unsigned int num_threads = 0);
+arma::Mat<int> recover_key_ciphertext_only(const std::vector<arma::Mat<int>>& encrypted, arma::Mat<int>& inverse_key,
+                                           size_t keep = 10, unsigned int num_threads = 0);
+
+bool build_key_schedule(const std::string& key_string, hill_key_schedule& schedule);
+void encrypt_hill_cipher(const hill_key_schedule& schedule, const int* message, int* encrypted, size_t len,
+                         unsigned int num_threads = 1);
+void decrypt_hill_cipher(const hill_key_schedule& schedule, const int* encrypted, int* decrypted, size_t len,
+                         unsigned int num_threads = 1);
+
+} // namespace hc
+
+#endif
@@ -0,0 +1,147 @@
+// main.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+#include "HC.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+using namespace arma;
+using namespace hc;
+
+int main(int argc, char* argv[]) {
+    if (argc > 3 && strcmp(argv[1], "--known") == 0) {
+        Mat<int> key = recover_key_known_plaintext(text_to_blocks(argv[2]), text_to_blocks(argv[3]));
+        if (key.is_empty()) {
+            cout << "The given pairs do not determine the key." << endl;
+            return 1;
+        }
+        cout << "Recovered Key Matrix " << endl;
+        cout << key << endl;
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--crack") == 0) {
+        string ciphertext;
+        string line;
+        while (getline(cin, line)) {
+            ciphertext += line;
+        }
+
+        Mat<int> inverse_key;
+        Mat<int> key = recover_key_ciphertext_only(text_to_blocks(ciphertext), inverse_key);
+        if (key.is_empty()) {
+            cout << "No invertible key found." << endl;
+            return 1;
+        }
+        cout << "Recovered Key Matrix " << endl;
+        cout << key << endl;
+        cout << "Key Inverse Matrix " << endl;
+        cout << inverse_key << endl;
+        print_decrypted(decrypt_hill_cipher(text_to_blocks(ciphertext), inverse_key));
+        return 0;
+    }
+
+    cout << "Enter your message: ";
+    string message;
+    getline(cin, message);
+    // transform message into uppercase for simplicity
+    transform(message.begin(), message.end(), message.begin(), ::toupper);
+
+    message.erase(remove_if(message.begin(), message.end(), ::isspace), message.end());
+
+
+    int message_len = message.length();
+    int rem = message_len % 3;
+    // pad message with As if message not divisible by 3
+    if (rem != 0) {
+        int to_add = 3 - rem;
+        for (int i = 0; i < to_add; i++) {
+            message.push_back('A');
+        }
+    }
+    message_len = message.length();
+
+    char* message_ints = new char[message_len];
+    for (int i = 0; i < message_len; ++i) {
+        message_ints[i] = (message[i] - 'A') % 26;
+    }
+
+    cout << "ASCII values of characters in the message:" << endl;
+    for (int i = 0; i < message_len; ++i) {
+        cout << static_cast<int>(message_ints[i]) << " ";
+    }
+    cout << endl;
+
+    vector<Mat<int>> message_matrices;
+    for (int i = 0; i < message_len; i += 3) {
+        Mat<int> next(3, 1);
+        for (int j = 0; j < 3; ++j) {
+            next(j) = message_ints[i + j];
+        }
+        message_matrices.push_back(next);
+    }
+
+    for (size_t i = 0; i < message_matrices.size(); ++i) {
+        cout << "Matrix of Message Portion " << i + 1 << ":" << endl;
+        cout << message_matrices[i] << endl;
+    }
+
+    
+
+    hill_key_cache key_cache;
+    shared_ptr<const hill_key_schedule> schedule;
+    Mat<int> key_int;
+    Mat<int> key_inv_int;
+    do {
+        string init_key = "";
+        cout << "Enter 9 Letters to be the Key (no spaces): ";
+        cin >> init_key;
+
+        int key_len = init_key.length();
+        if (key_len != 9) {
+            cout << "Key does not have a length of 9!" << endl;
+            continue;
+        }
+
+        schedule = key_cache.get(init_key);
+        if (!schedule) {
+            cout << "This key does not have an inverse!" << endl;
+            continue;
+        }
+
+    } while (!schedule);
+
+    key_int = schedule->key;
+    key_inv_int = schedule->inverse_key;
+
+    cout << "Key Matrix " << endl;
+    cout << key_int << endl;
+    cout << "Key Inverse Matrix " << endl;
+    cout << key_inv_int << endl;
+
+
+    vector<Mat<int>> encrypted = encrypt_hill_cipher(message_matrices, key_int);
+
+    print_encrypted(encrypted);
+
+    vector<Mat<int>> decrypted = decrypt_hill_cipher(encrypted, key_inv_int);
+
+
+    print_decrypted(decrypted);
+
+    return 0;
+
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started: 
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
\ No newline at end of file
@@ -1,28 +1,20 @@
-// RSA.cpp : This file contains the 'main' function. Program execution begins and ends there.
+// RSA.cpp : RSA key generation, encryption and decryption.
 //
 
+#include "RSA.h"
+#include "../../common/op_counters.h"
+#include "../../common/parallel.h"
+#include "../../common/sha256.h"
 #include <iostream>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <numeric>
 #include <algorithm>
-#include <list>
 #include <vector>
-#include <random>
-#include <chrono>
+#include <stdexcept>
 using namespace std;
 
-struct keys {
-    tuple <int, int> public_key;
-    int private_key;
-};
-
-struct eea {
-    int r;
-    int s;
-    int t;
-};
-
+namespace rsa {
 
 // List of all two digits primes to use as example
 list<int> primes{ 11,13,17,19,23,29,31,37,41,43,47,53,59,61,67,71,73,
@@ -43,6 +35,7 @@ eea compute_eea(int r0, int r1) {
     int t1 = 1;
 
     while (r1 > 0) {
+        MATH241_COUNT(OP_EEA_ITERATION);
         int q = r0 / r1;
         int r2 = r0 - q * r1;
         int s2 = s0 - q * s1;
@@ -101,6 +94,7 @@ bool has_inverse(int a, int modular) {
  * @throws std::runtime_error if no inverse exists.
  */
 int get_inverse(int a, int modular) {
+    MATH241_COUNT(OP_INVERSION);
     if (!has_inverse(a, modular)) {
         throw std::runtime_error("No inverse exists");
     }
@@ -123,6 +117,19 @@ int get_inverse(int a, int modular) {
  * @return A struct containing the generated public and private keys.
  */
 keys generate_keys(int p, int q) {
+    return generate_keys(p, q, rng::thread_rng());
+}
+
+/**
+ * @brief Generates RSA keys, drawing the public exponent from the given
+ * generator.
+ *
+ * @param p The first prime number.
+ * @param q The second prime number.
+ * @param random The random generator to draw from.
+ * @return A struct containing the generated public and private keys.
+ */
+keys generate_keys(int p, int q, rng::chacha20_drbg& random) {
     tuple <int, int> public_key;
     int private_key;
 
@@ -130,30 +137,22 @@ keys generate_keys(int p, int q) {
     int n = p * q;
     int phi_n = (p - 1) * (q - 1);
 
-    // populate public exponenet list
-    vector<int> e;
-    for (int i = 2; i < phi_n; i++) {
-        e.push_back(i);
-    }
-
-    // copy e values into vector and shuffle it
-    unsigned int seed = std::chrono::system_clock::now().time_since_epoch().count();
-    vector<int> randomize_e_list(e.begin(), e.end());
-    std::shuffle(randomize_e_list.begin(), randomize_e_list.end(),
-        std::default_random_engine(seed));
-
-
-    int public_e = randomize_e_list.front();
-    for (auto it = randomize_e_list.begin(); it != randomize_e_list.end(); ++it) {
-        public_e = *it;
-        if (gcd(public_e, phi_n) == 1) {
-            break;
-        }
-
+    // draw e uniformly from [2, phi_n) until it is coprime to phi_n, which
+    // picks the same distribution as shuffling the whole range
+    if (phi_n < 4) {
+        throw std::runtime_error("No public exponent exists");
     }
+    int public_e;
+    do {
+        public_e = static_cast<int>(random.uniform(phi_n - 2)) + 2;
+    } while (gcd(public_e, phi_n) != 1);
 
     public_key = make_tuple(n, public_e);
     private_key = get_inverse(public_e, phi_n);
+    // get_inverse can return a negative representative
+    if (private_key < 0) {
+        private_key += phi_n;
+    }
 
     keys result = { public_key, private_key };
 
@@ -177,8 +176,10 @@ int rsa_encryption(int n, int e, int x) {
     // Perform modular exponentiation
     while (exponent > 0) {
         if (exponent % 2 == 1) {
+            MATH241_COUNT(OP_MOD_MUL);
             result = (result * base) % n;
         }
+        MATH241_COUNT(OP_MOD_SQUARE);
         base = (base * base) % n;
         exponent /= 2;           
     }
@@ -204,8 +205,10 @@ int rsa_decryption(int d, int n, int y) {
     // Perform modular exponentiation
     while (exponent > 0) {
         if (exponent % 2 == 1) {
+            MATH241_COUNT(OP_MOD_MUL);
             result = (result * base) % n; // Update result modulo n at each step
         }
+        MATH241_COUNT(OP_MOD_SQUARE);
         base = (base * base) % n; // Square base and update modulo n
         exponent /= 2;            // Divide exponent by 2 for each iteration
     }
@@ -213,46 +216,193 @@ int rsa_decryption(int d, int n, int y) {
     return static_cast<int>(result);
 }
 
+/**
+ * @brief Precomputes the Montgomery constants for a modulus.
+ *
+ * @param n The modulus, odd and below 2^31.
+ * @return The Montgomery context for n.
+ */
+mont_ctx mont_init(int n) {
+    mont_ctx ctx;
+    ctx.n = static_cast<uint32_t>(n);
+
+    // Newton iteration doubles the correct low bits of n^-1 each step
+    uint32_t inv = ctx.n;
+    for (int i = 0; i < 5; ++i) {
+        inv *= 2 - ctx.n * inv;
+    }
+    ctx.n_prime = 0 - inv;
 
-int main()
-{
-    keys user_keys;
+    uint64_t r = (uint64_t(1) << 32) % ctx.n;
+    ctx.r2 = static_cast<uint32_t>(r * r % ctx.n);
 
-    int p = 3;
-    int q = 11;
-    int e = 3;
-    int d = 7;
-    int n = p * q;
+    return ctx;
+}
 
+/**
+ * @brief Montgomery product a * b * R^-1 mod n.
+ *
+ * @param ctx The Montgomery context.
+ * @param a The first factor, below n.
+ * @param b The second factor, below n.
+ * @return The reduced product, below n.
+ */
+uint32_t mont_mul(const mont_ctx& ctx, uint32_t a, uint32_t b) {
+    MATH241_COUNT(OP_MOD_MUL);
+    uint64_t t = uint64_t(a) * b;
+    uint32_t m = static_cast<uint32_t>(t) * ctx.n_prime;
+    uint64_t u = (t + uint64_t(m) * ctx.n) >> 32;
 
-    cout << "Enter your message to encrypt:\n";
-    int plaintext;
-    cin >> plaintext;
+    return static_cast<uint32_t>(u >= ctx.n ? u - ctx.n : u);
+}
 
-    int ciphertext;
+/**
+ * @brief Modular exponentiation with Montgomery multiplication, so no
+ * step needs a division.
+ *
+ * @param ctx The Montgomery context of the modulus.
+ * @param base The base, 0 <= base < n.
+ * @param exponent The exponent, >= 0.
+ * @return base^exponent mod n.
+ */
+int mont_modexp(const mont_ctx& ctx, int base, int exponent) {
+    uint32_t result = mont_mul(ctx, 1, ctx.r2);      // 1 in Montgomery form
+    uint32_t b = mont_mul(ctx, static_cast<uint32_t>(base), ctx.r2);
 
+    while (exponent > 0) {
+        if (exponent % 2 == 1) {
+            result = mont_mul(ctx, result, b);
+        }
+        b = mont_mul(ctx, b, b);
+        exponent /= 2;
+    }
 
-    ciphertext = rsa_encryption(n, e, plaintext);
+    return static_cast<int>(mont_mul(ctx, result, 1));
+}
 
-    cout << "Ciphertext: " << ciphertext << endl;
+/**
+ * @brief Splits a private exponent into the CRT parameters.
+ *
+ * @param p The first prime.
+ * @param q The second prime.
+ * @param d The private exponent.
+ * @return The CRT parameters.
+ */
+crt_params make_crt_params(int p, int q, int d) {
+    crt_params crt;
+    crt.p = p;
+    crt.q = q;
+    crt.dP = d % (p - 1);
+    crt.dQ = d % (q - 1);
+    crt.qInv = get_inverse(q % p, p);
+    if (crt.qInv < 0) {
+        crt.qInv += p;
+    }
+
+    return crt;
+}
 
-    plaintext = rsa_decryption(d, n, ciphertext);
+/**
+ * @brief Decrypts a ciphertext with two half-size exponentiations mod p
+ * and q, recombined with Garner's formula.
+ *
+ * @param crt The CRT parameters of the private key.
+ * @param y The ciphertext to decrypt.
+ * @return The decrypted plaintext.
+ */
+int rsa_decryption_crt(const crt_params& crt, int y) {
+    long long m1 = rsa_decryption(crt.dP, crt.p, y % crt.p);
+    long long m2 = rsa_decryption(crt.dQ, crt.q, y % crt.q);
+
+    long long h = (crt.qInv * ((m1 - m2) % crt.p + crt.p)) % crt.p;
+
+    return static_cast<int>(m2 + h * crt.q);
+}
+
+// Signatures verified per worker at a time; smaller batches run serially.
+const size_t VERIFY_CHUNK = 256;
+
+/**
+ * @brief Hashes a message with SHA-256 and reduces the digest mod n.
+ *
+ * The modulus here is far too small for PKCS#1 v1.5 or PSS padding, which
+ * need at least the digest size plus the padding, so the whole digest is
+ * read as one big-endian integer and reduced mod n, as in a full-domain
+ * hash.
+ *
+ * @param message The message to hash.
+ * @param n The modulus.
+ * @return The message representative, below n.
+ */
+int hash_message(const std::string& message, int n) {
+    unsigned char digest_bytes[digest::SHA256_SIZE];
+    digest::sha256_digest(message.data(), message.size(), digest_bytes);
 
-    cout << "Plaintext: " << plaintext << endl;
+    uint64_t h = 0;
+    for (unsigned char byte : digest_bytes) {
+        h = (h * 256 + byte) % static_cast<uint64_t>(n);
+    }
 
+    return static_cast<int>(h);
+}
 
+/**
+ * @brief Signs a message: the hash of the message raised to d mod n, using
+ * the CRT form of the private key.
+ *
+ * @param crt The CRT parameters of the private key.
+ * @param message The message to sign.
+ * @return The signature.
+ */
+int rsa_sign(const crt_params& crt, const std::string& message) {
+    return rsa_decryption_crt(crt, hash_message(message, crt.p * crt.q));
+}
 
+/**
+ * @brief Checks a signature: signature^e mod n must equal the hash of the
+ * message.
+ *
+ * @param ctx The Montgomery context of the public modulus.
+ * @param e The public exponent.
+ * @param message The signed message.
+ * @param signature The signature to check.
+ * @return True if the signature is valid.
+ */
+bool rsa_verify(const mont_ctx& ctx, int e, const std::string& message, int signature) {
+    int n = static_cast<int>(ctx.n);
+    if (signature < 0 || signature >= n) {
+        return false;
+    }
 
-    return 0;
+    return mont_modexp(ctx, signature, e) == hash_message(message, n);
 }
 
-// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
-// Debug program: F5 or Debug > Start Debugging menu
+/**
+ * @brief Checks many signatures under one public key. Every worker shares
+ * the same Montgomery context; the work is split into chunks of
+ * VERIFY_CHUNK signatures, one worker thread per share.
+ *
+ * @param ctx The Montgomery context of the public modulus.
+ * @param e The public exponent.
+ * @param messages The signed messages.
+ * @param signatures The signature of each message.
+ * @param num_threads The number of workers to use, 0 for one per core.
+ * @return 1 for each valid signature and 0 for each invalid one.
+ */
+std::vector<uint8_t> rsa_verify_batch(const mont_ctx& ctx, int e, const std::vector<std::string>& messages,
+                                      const std::vector<int>& signatures, unsigned int num_threads) {
+    size_t count = min(messages.size(), signatures.size());
+    vector<uint8_t> valid(count);
+
+    auto verify_range = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            valid[i] = rsa_verify(ctx, e, messages[i], signatures[i]) ? 1 : 0;
+        }
+    };
+
+    // whole chunks per worker so no two threads write the same cache line
+    parallel::for_ranges(count, num_threads, VERIFY_CHUNK, verify_range);
+    return valid;
+}
 
-// Tips for Getting Started: 
-//   1. Use the Solution Explorer window to add/manage files
-//   2. Use the Team Explorer window to connect to source control
-//   3. Use the Output window to see build output and other messages
-//   4. Use the Error List window to view errors
-//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
-//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
+} // namespace rsa
@@ -0,0 +1,67 @@
+#ifndef RSA_H
+#define RSA_H
+#include <cstdint>
+#include <list>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "../../common/chacha20.h"
+
+namespace rsa {
+
+struct keys {
+    std::tuple <int, int> public_key;
+    int private_key;
+};
+
+struct eea {
+    int r;
+    int s;
+    int t;
+};
+
+/**
+ * Constants for Montgomery multiplication mod an odd n < 2^31 with R = 2^32
+ */
+struct mont_ctx {
+    uint32_t n;
+    uint32_t n_prime;   // -n^-1 mod 2^32
+    uint32_t r2;        // R^2 mod n
+};
+
+/**
+ * Private key split for decryption with the Chinese Remainder Theorem
+ */
+struct crt_params {
+    int p;
+    int q;
+    int dP;     // d mod (p - 1)
+    int dQ;     // d mod (q - 1)
+    int qInv;   // q^-1 mod p
+};
+
+// List of all two digits primes to use as example
+extern std::list<int> primes;
+
+eea compute_eea(int r0, int r1);
+int get_random_prime(int index);
+bool has_inverse(int a, int modular);
+int get_inverse(int a, int modular);
+keys generate_keys(int p, int q);
+keys generate_keys(int p, int q, rng::chacha20_drbg& random);
+int rsa_encryption(int n, int e, int x);
+int rsa_decryption(int d, int n, int y);
+mont_ctx mont_init(int n);
+uint32_t mont_mul(const mont_ctx& ctx, uint32_t a, uint32_t b);
+int mont_modexp(const mont_ctx& ctx, int base, int exponent);
+crt_params make_crt_params(int p, int q, int d);
+int rsa_decryption_crt(const crt_params& crt, int y);
+int hash_message(const std::string& message, int n);
+int rsa_sign(const crt_params& crt, const std::string& message);
+bool rsa_verify(const mont_ctx& ctx, int e, const std::string& message, int signature);
+std::vector<uint8_t> rsa_verify_batch(const mont_ctx& ctx, int e, const std::vector<std::string>& messages,
+                                      const std::vector<int>& signatures, unsigned int num_threads = 0);
+
+} // namespace rsa
+
+#endif
@@ -0,0 +1,50 @@
+// main.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include "RSA.h"
+#include <iostream>
+using namespace std;
+using namespace rsa;
+
+int main()
+{
+    keys user_keys;
+
+    int p = 3;
+    int q = 11;
+    int e = 3;
+    int d = 7;
+    int n = p * q;
+
+
+    cout << "Enter your message to encrypt:\n";
+    int plaintext;
+    cin >> plaintext;
+
+    int ciphertext;
+
+
+    ciphertext = rsa_encryption(n, e, plaintext);
+
+    cout << "Ciphertext: " << ciphertext << endl;
+
+    plaintext = rsa_decryption(d, n, ciphertext);
+
+    cout << "Plaintext: " << plaintext << endl;
+
+
+
+
+    return 0;
+}
+
+// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
+// Debug program: F5 or Debug > Start Debugging menu
+
+// Tips for Getting Started: 
+//   1. Use the Solution Explorer window to add/manage files
+//   2. Use the Team Explorer window to connect to source control
+//   3. Use the Output window to see build output and other messages
+//   4. Use the Error List window to view errors
+//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
+//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
@@ -0,0 +1,350 @@
+// audit.cpp : Factoring weak RSA moduli up to 64 bits.
+//
+#include "audit.h"
+#include "../common/chacha20.h"
+#include "../common/parallel.h"
+#include "../mp/limb.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+using namespace std;
+
+namespace audit {
+
+// Brent's rho takes this many steps between gcds
+const uint64_t RHO_BATCH = 128;
+
+/**
+ * @brief Multiplies mod n without overflow, through a 128-bit product.
+ *
+ * @param a A value below n.
+ * @param b A value below n.
+ * @param n The modulus.
+ * @return a * b mod n.
+ */
+uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t n) {
+    mp::limb hi;
+    mp::limb lo = mp::mul_wide(a, b, hi);
+    mp::limb rem;
+    mp::div_wide(hi, lo, n, rem);
+    return rem;
+}
+
+uint64_t add_mod(uint64_t a, uint64_t b, uint64_t n) {
+    uint64_t sum = a + b;
+    return (sum < a || sum >= n) ? sum - n : sum;
+}
+
+/**
+ * @brief Raises base to e mod n by square-and-multiply.
+ */
+uint64_t pow_mod(uint64_t base, uint64_t e, uint64_t n) {
+    uint64_t result = 1 % n;
+    base %= n;
+    while (e > 0) {
+        if (e & 1) {
+            result = mul_mod(result, base, n);
+        }
+        base = mul_mod(base, base, n);
+        e >>= 1;
+    }
+    return result;
+}
+
+/**
+ * @brief Tests primality with Miller-Rabin on the first twelve prime bases,
+ * which is exact for every n below 2^64.
+ *
+ * @param n The number to test.
+ * @return True if n is prime.
+ */
+bool is_prime(uint64_t n) {
+    const uint64_t bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    if (n < 2) {
+        return false;
+    }
+    for (uint64_t b : bases) {
+        if (n % b == 0) {
+            return n == b;
+        }
+    }
+
+    uint64_t d = n - 1;
+    int s = 0;
+    while (d % 2 == 0) {
+        d /= 2;
+        ++s;
+    }
+    for (uint64_t b : bases) {
+        uint64_t x = pow_mod(b, d, n);
+        if (x == 1 || x == n - 1) {
+            continue;
+        }
+        bool composite = true;
+        for (int i = 1; i < s && composite; ++i) {
+            x = mul_mod(x, x, n);
+            composite = x != n - 1;
+        }
+        if (composite) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @return floor(sqrt(n))
+ */
+uint64_t isqrt(uint64_t n) {
+    uint64_t r = static_cast<uint64_t>(sqrt(static_cast<double>(n)));
+    while (r > 0 && r > n / r) {
+        --r;
+    }
+    while (r + 1 <= n / (r + 1)) {
+        ++r;
+    }
+    return r;
+}
+
+/**
+ * @brief Tries every divisor up to a limit. With the two-digit primes of
+ * RSA.cpp, this alone factors every key the RSA program makes.
+ *
+ * @param n The modulus.
+ * @param limit The largest divisor to try.
+ * @return The smallest factor of n up to limit, or 0.
+ */
+uint64_t trial_division(uint64_t n, uint64_t limit) {
+    for (uint64_t d = 2; d <= limit && d <= n / d; ++d) {
+        if (n % d == 0) {
+            return d;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Fermat's method: looks for n = a^2 - b^2 = (a - b)(a + b) with a
+ * just above sqrt(n). Finds p and q in one step when they are close, as
+ * they are when both are picked near the same size.
+ *
+ * @param n The modulus.
+ * @param max_steps How many values of a to try.
+ * @return A non-trivial factor of n, or 0.
+ */
+uint64_t fermat(uint64_t n, uint64_t max_steps) {
+    if (n % 2 == 0) {
+        return n > 2 ? 2 : 0;
+    }
+
+    uint64_t a = isqrt(n);
+    if (a * a == n) {
+        return a > 1 ? a : 0;
+    }
+    ++a;
+
+    // a^2 - n is small, so the low 64 bits of a^2 give it exactly
+    mp::limb hi;
+    uint64_t b2 = mp::mul_wide(a, a, hi) - n;
+    for (uint64_t step = 0; step < max_steps; ++step) {
+        uint64_t b = isqrt(b2);
+        if (b * b == b2) {
+            uint64_t p = a - b;
+            return p > 1 ? p : 0;
+        }
+        b2 += 2 * a + 1;
+        ++a;
+    }
+    return 0;
+}
+
+/**
+ * @brief Pollard's p-1 (stage 1): a^M - 1 shares the factor p with n when
+ * every prime power in p - 1 is at most the bound, M being the product of
+ * all such prime powers.
+ *
+ * @param n The modulus.
+ * @param bound The smoothness bound.
+ * @return A non-trivial factor of n, or 0.
+ */
+uint64_t pollard_pm1(uint64_t n, uint64_t bound) {
+    if (n % 2 == 0) {
+        return n > 2 ? 2 : 0;
+    }
+
+    vector<bool> composite(bound + 1, false);
+    uint64_t a = 2;
+    uint64_t primes_since_gcd = 0;
+    for (uint64_t q = 2; q <= bound; ++q) {
+        if (composite[q]) {
+            continue;
+        }
+        for (uint64_t m = q * q; m <= bound; m += q) {
+            composite[m] = true;
+        }
+
+        uint64_t power = q;
+        while (power <= bound / q) {
+            power *= q;
+        }
+        a = pow_mod(a, power, n);
+
+        if (++primes_since_gcd == 64) {
+            primes_since_gcd = 0;
+            uint64_t g = gcd(a == 0 ? n : a - 1, n);
+            if (g == n) {
+                return 0;
+            }
+            if (g > 1) {
+                return g;
+            }
+        }
+    }
+    uint64_t g = gcd(a == 0 ? n : a - 1, n);
+    return g > 1 && g < n ? g : 0;
+}
+
+/**
+ * @brief One run of Brent's rho with x -> x^2 + c: the cycle is found by
+ * comparing with a saved point at powers of two, and the differences are
+ * multiplied together so only every RHO_BATCH-th step pays for a gcd.
+ *
+ * @return A non-trivial factor, or 0 if this c failed or the run was cut off.
+ */
+uint64_t brent(uint64_t n, uint64_t c, uint64_t y, uint64_t max_steps, const atomic<bool>& done) {
+    auto f = [&](uint64_t v) { return add_mod(mul_mod(v, v, n), c, n); };
+
+    uint64_t g = 1;
+    uint64_t q = 1;
+    uint64_t x = y;
+    uint64_t ys = y;
+    uint64_t steps = 0;
+    for (uint64_t r = 1; g == 1; r *= 2) {
+        x = y;
+        for (uint64_t i = 0; i < r; ++i) {
+            y = f(y);
+        }
+        steps += r;
+        for (uint64_t k = 0; k < r && g == 1; k += RHO_BATCH) {
+            ys = y;
+            uint64_t batch = min(RHO_BATCH, r - k);
+            for (uint64_t i = 0; i < batch; ++i) {
+                y = f(y);
+                q = mul_mod(q, x > y ? x - y : y - x, n);
+            }
+            g = gcd(q, n);
+            steps += batch;
+            if (g == 1 && (steps > max_steps || done.load(memory_order_relaxed))) {
+                return 0;
+            }
+        }
+    }
+
+    if (g == n) {
+        // the batch ran past the collision; redo it one step at a time
+        do {
+            ys = f(ys);
+            g = gcd(x > ys ? x - ys : ys - x, n);
+        } while (g == 1);
+    }
+    return g == n ? 0 : g;
+}
+
+/**
+ * @brief Pollard rho on all cores: every worker runs Brent's rho with its
+ * own random polynomial, and the first factor found stops the rest.
+ *
+ * @param n The modulus, composite.
+ * @param num_threads The number of workers to use, 0 for one per core.
+ * @param max_steps The step budget of each worker.
+ * @return A non-trivial factor of n, or 0.
+ */
+uint64_t pollard_rho(uint64_t n, unsigned int num_threads, uint64_t max_steps) {
+    if (n % 2 == 0) {
+        return n > 2 ? 2 : 0;
+    }
+    if (n < 4 || is_prime(n)) {
+        return 0;
+    }
+    atomic<bool> done{ false };
+    atomic<uint64_t> found{ 0 };
+    auto worker = [&]() {
+        rng::chacha20_drbg& random = rng::thread_rng();
+        uint64_t budget = max_steps;
+        while (!done.load(memory_order_relaxed) && budget > 0) {
+            uint64_t c = random.next_u64() % (n - 1) + 1;
+            uint64_t y = random.next_u64() % n;
+            uint64_t g = brent(n, c, y, budget, done);
+            if (g != 0) {
+                uint64_t none = 0;
+                found.compare_exchange_strong(none, g);
+                done.store(true);
+            }
+            // a failed c costs about as much as the steps it was allowed
+            budget /= 2;
+        }
+    };
+
+    parallel::run_workers(num_threads, worker);
+    return found.load();
+}
+
+/**
+ * @brief Runs the single-modulus attacks from cheapest to most expensive.
+ *
+ * @param n The modulus.
+ * @param num_threads The number of workers for Pollard rho, 0 for one per core.
+ * @return The factorization and the method that found it.
+ */
+factor_result factor_modulus(uint64_t n, unsigned int num_threads) {
+    factor_result result = { 0, 0, FACTOR_NONE };
+    if (n < 2) {
+        return result;
+    }
+    if (is_prime(n)) {
+        result = { n, 1, FACTOR_PRIME };
+        return result;
+    }
+
+    uint64_t p;
+    if ((p = trial_division(n)) != 0) {
+        result.method = FACTOR_TRIAL;
+    }
+    else if ((p = fermat(n)) != 0) {
+        result.method = FACTOR_FERMAT;
+    }
+    else if ((p = pollard_pm1(n)) != 0) {
+        result.method = FACTOR_PM1;
+    }
+    else if ((p = pollard_rho(n, num_threads)) != 0) {
+        result.method = FACTOR_RHO;
+    }
+
+    if (p != 0) {
+        result.p = min(p, n / p);
+        result.q = n / result.p;
+    }
+    return result;
+}
+
+const char* method_name(factor_method method) {
+    switch (method) {
+    case FACTOR_PRIME:
+        return "prime modulus";
+    case FACTOR_TRIAL:
+        return "trial division";
+    case FACTOR_FERMAT:
+        return "Fermat";
+    case FACTOR_PM1:
+        return "Pollard p-1";
+    case FACTOR_RHO:
+        return "Pollard rho";
+    default:
+        return "not factored";
+    }
+}
+
+} // namespace audit
@@ -0,0 +1,46 @@
+#ifndef AUDIT_H
+#define AUDIT_H
+// Finding weak RSA moduli. Single moduli up to 64 bits are attacked
+// directly: trial division (the two-digit primes of RSA.cpp), Fermat's
+// method for p and q close together, Pollard p-1 for p - 1 smooth and
+// Brent's variant of Pollard rho on all cores for the rest. A whole corpus
+// of moduli of any size is checked for shared primes at once by batch GCD,
+// in batch_gcd.h.
+#include <cstdint>
+
+namespace audit {
+
+// Bounds of the single-modulus attacks
+const uint64_t TRIAL_LIMIT = 1000;
+const uint64_t FERMAT_STEPS = uint64_t(1) << 16;
+const uint64_t PM1_BOUND = 100000;
+const uint64_t RHO_STEPS = uint64_t(1) << 28;
+
+enum factor_method {
+    FACTOR_NONE,        // not factored within the bounds
+    FACTOR_PRIME,       // n itself is prime
+    FACTOR_TRIAL,
+    FACTOR_FERMAT,
+    FACTOR_PM1,
+    FACTOR_RHO
+};
+
+struct factor_result {
+    uint64_t p;     // a non-trivial factor, or n if it is prime, or 0
+    uint64_t q;     // n / p
+    factor_method method;
+};
+
+uint64_t mul_mod(uint64_t a, uint64_t b, uint64_t n);
+uint64_t pow_mod(uint64_t base, uint64_t e, uint64_t n);
+bool is_prime(uint64_t n);
+uint64_t trial_division(uint64_t n, uint64_t limit = TRIAL_LIMIT);
+uint64_t fermat(uint64_t n, uint64_t max_steps = FERMAT_STEPS);
+uint64_t pollard_pm1(uint64_t n, uint64_t bound = PM1_BOUND);
+uint64_t pollard_rho(uint64_t n, unsigned int num_threads = 0, uint64_t max_steps = RHO_STEPS);
+factor_result factor_modulus(uint64_t n, unsigned int num_threads = 0);
+const char* method_name(factor_method method);
+
+} // namespace audit
+
+#endif
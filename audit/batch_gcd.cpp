@@ -0,0 +1,287 @@
+// batch_gcd.cpp : Batch GCD over product and remainder trees, spilling
+// levels to disk when they outgrow memory.
+//
+#include "batch_gcd.h"
+#include "../common/chacha20.h"
+#include "../common/parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace audit {
+
+/**
+ * @brief One level of the product tree, in memory or in a spill file.
+ */
+struct tree_level {
+    vector<mp::bigint> nodes;   // empty while spilled
+    string path;                // the spill file, "" while in memory
+    uint64_t bytes;
+};
+
+/**
+ * @brief Removes the spill files left when the trees are done or abandoned
+ * by an exception.
+ */
+struct spill_files {
+    vector<string> paths;
+
+    ~spill_files() {
+        for (const string& path : paths) {
+            remove(path.c_str());
+        }
+    }
+};
+
+/**
+ * @return Half the physical memory where it can be read, else no limit.
+ */
+size_t default_memory_limit() {
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGE_SIZE)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages > 0 && page_size > 0) {
+        return static_cast<size_t>(pages) / 2 * static_cast<size_t>(page_size);
+    }
+#endif
+    return SIZE_MAX;
+}
+
+/**
+ * @return The memory held by the nodes of a level.
+ */
+uint64_t level_bytes(const vector<mp::bigint>& nodes) {
+    uint64_t bytes = nodes.size() * sizeof(mp::bigint);
+    for (const mp::bigint& node : nodes) {
+        bytes += node.limbs.size() * sizeof(mp::limb);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Writes a level as its node count, then each node's limb count and
+ * limbs, all in native byte order; the file never outlives the process.
+ */
+void write_level(const string& path, const vector<mp::bigint>& nodes) {
+    ofstream out(path, ios::binary | ios::trunc);
+    uint64_t count = nodes.size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const mp::bigint& node : nodes) {
+        uint64_t length = node.limbs.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(reinterpret_cast<const char*>(node.limbs.data()), length * sizeof(mp::limb));
+    }
+    if (!out) {
+        throw runtime_error("cannot write " + path);
+    }
+}
+
+/**
+ * @brief Reads back a level written by write_level.
+ */
+vector<mp::bigint> read_level(const string& path) {
+    ifstream in(path, ios::binary);
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    vector<mp::bigint> nodes(in ? count : 0);
+    for (mp::bigint& node : nodes) {
+        uint64_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!in) {
+            break;
+        }
+        node.limbs.resize(length);
+        in.read(reinterpret_cast<char*>(node.limbs.data()), length * sizeof(mp::limb));
+    }
+    if (!in) {
+        throw runtime_error("cannot read " + path);
+    }
+    return nodes;
+}
+
+/**
+ * @brief Runs fn(i, threads) for every node of a level. Wide levels give
+ * each worker whole nodes; the narrow levels near the root have fewer nodes
+ * than workers, so the spare threads go into the products themselves.
+ */
+template <typename Fn>
+void for_each_node(size_t count, unsigned int num_threads, Fn fn) {
+    if (count >= num_threads) {
+        parallel::for_each(count, num_threads, [&](size_t i) { fn(i, 1u); });
+    }
+    else {
+        unsigned int share = num_threads / static_cast<unsigned int>(count);
+        parallel::for_each(count, static_cast<unsigned int>(count), [&](size_t i) { fn(i, share); });
+    }
+}
+
+/**
+ * @return Batch GCD options for all cores, half the RAM and the temp
+ *         directory.
+ */
+batch_gcd_options default_batch_gcd_options() {
+    batch_gcd_options options;
+    options.num_threads = 0;
+    options.memory_limit = 0;
+    options.spill_dir = "";
+    return options;
+}
+
+/**
+ * @brief Batch GCD (Bernstein; Heninger et al.): gcd(n_i, product of all
+ * other n_j) for every i, without comparing keys pair by pair.
+ *
+ * A product tree multiplies the moduli in pairs up to P = n_1 ... n_k; a
+ * remainder tree then reduces P down the same tree mod the squares of the
+ * nodes, so leaf i holds P mod n_i^2 and (P mod n_i^2) / n_i is the product
+ * of the others mod n_i. Every level is split across the workers.
+ *
+ * The tree above the moduli is held to options.memory_limit bytes: once
+ * the levels built so far pass it, the lowest ones, which the remainder
+ * tree needs last, are written out to options.spill_dir. The level being
+ * built on is always kept. On the way down each spilled level is read back
+ * and its file removed as soon as the remainders reach it.
+ *
+ * @param moduli The moduli, each above 1.
+ * @param options Threads, memory limit and spill directory.
+ * @param stats If not null, receives the shape of the tree and its peak
+ *        memory.
+ * @return For each modulus, its gcd with the product of all the others;
+ *         anything but 1 is a prime shared with another key.
+ */
+vector<mp::bigint> batch_gcd(const vector<mp::bigint>& moduli, const batch_gcd_options& options,
+                             batch_gcd_stats* stats) {
+    unsigned int num_threads = parallel::thread_count(options.num_threads);
+    uint64_t memory_limit = options.memory_limit != 0 ? options.memory_limit : default_memory_limit();
+    string spill_dir = options.spill_dir.empty() ? filesystem::temp_directory_path().string() : options.spill_dir;
+
+    vector<mp::bigint> result(moduli.size(), mp::from_u64(1));
+    if (stats != nullptr) {
+        stats->levels = 1;
+        stats->spilled_levels = 0;
+        stats->peak_bytes = 0;
+    }
+    if (moduli.size() < 2) {
+        return result;
+    }
+
+    // levels[0] stands for the moduli themselves, which are never copied
+    vector<tree_level> levels(1);
+    spill_files spilled;
+    uint64_t tag = rng::thread_rng().next_u64();
+    uint64_t resident = 0;
+    uint64_t peak = 0;
+    size_t spill_count = 0;
+    size_t lowest_resident = 1;
+
+    auto spill = [&](size_t index) {
+        tree_level& level = levels[index];
+        char name[64];
+        snprintf(name, sizeof(name), "batch_gcd-%016llx-%zu.level", static_cast<unsigned long long>(tag), index);
+        level.path = (filesystem::path(spill_dir) / name).string();
+        spilled.paths.push_back(level.path);
+        write_level(level.path, level.nodes);
+        vector<mp::bigint>().swap(level.nodes);
+        resident -= level.bytes;
+        ++spill_count;
+    };
+
+    // product tree, bottom up
+    size_t width = moduli.size();
+    while (width > 1) {
+        const vector<mp::bigint>& below = levels.size() == 1 ? moduli : levels.back().nodes;
+        tree_level level;
+        level.nodes.resize((width + 1) / 2);
+        for_each_node(level.nodes.size(), num_threads, [&](size_t i, unsigned int threads) {
+            level.nodes[i] = 2 * i + 1 < width ? mp::mul(below[2 * i], below[2 * i + 1], threads) : below[2 * i];
+        });
+        level.bytes = level_bytes(level.nodes);
+        resident += level.bytes;
+        peak = max(peak, resident);
+        width = level.nodes.size();
+        levels.push_back(move(level));
+
+        while (resident > memory_limit && lowest_resident + 1 < levels.size()) {
+            spill(lowest_resident++);
+        }
+    }
+
+    // remainder tree, top down: rem_i = rem_parent mod node_i^2
+    vector<mp::bigint> remainders = move(levels.back().nodes);
+    for (size_t index = levels.size() - 1; index-- > 0;) {
+        tree_level& level = levels[index];
+        if (index > 0 && !level.path.empty()) {
+            level.nodes = read_level(level.path);
+            remove(level.path.c_str());
+            resident += level.bytes;
+            peak = max(peak, resident + level_bytes(remainders));
+        }
+        const vector<mp::bigint>& nodes = index == 0 ? moduli : level.nodes;
+
+        vector<mp::bigint> next(nodes.size());
+        for_each_node(nodes.size(), num_threads, [&](size_t i, unsigned int threads) {
+            next[i] = mp::mod(remainders[i / 2], mp::sqr(nodes[i], threads), threads);
+        });
+        remainders = move(next);
+
+        if (index > 0) {
+            vector<mp::bigint>().swap(level.nodes);
+            resident -= level.bytes;
+        }
+    }
+
+    parallel::for_each(moduli.size(), num_threads, [&](size_t i) {
+        result[i] = mp::gcd(mp::div(remainders[i], moduli[i]), moduli[i]);
+    });
+
+    if (stats != nullptr) {
+        stats->levels = levels.size();
+        stats->spilled_levels = spill_count;
+        stats->peak_bytes = peak;
+    }
+    return result;
+}
+
+/**
+ * @brief Batch GCD with the default memory limit and spill directory.
+ *
+ * @param moduli The moduli, each above 1.
+ * @param num_threads The number of workers to use, 0 for one per core.
+ * @return For each modulus, its gcd with the product of all the others.
+ */
+vector<mp::bigint> batch_gcd(const vector<mp::bigint>& moduli, unsigned int num_threads) {
+    batch_gcd_options options = default_batch_gcd_options();
+    options.num_threads = num_threads;
+    return batch_gcd(moduli, options);
+}
+
+/**
+ * @brief Batch GCD over the public moduli of a set of RSA keys.
+ *
+ * @param keys The keys, as made by rsa::generate_keys.
+ * @param options Threads, memory limit and spill directory.
+ * @param stats If not null, receives the shape of the tree and its peak
+ *        memory.
+ * @return For each key, the gcd of its modulus with the product of all the
+ *         other moduli.
+ */
+vector<mp::bigint> batch_gcd(const vector<rsa::keys>& keys, const batch_gcd_options& options,
+                             batch_gcd_stats* stats) {
+    vector<mp::bigint> moduli;
+    moduli.reserve(keys.size());
+    for (const rsa::keys& key : keys) {
+        moduli.push_back(mp::from_u64(static_cast<uint64_t>(get<0>(key.public_key))));
+    }
+    return batch_gcd(moduli, options, stats);
+}
+
+} // namespace audit
@@ -0,0 +1,43 @@
+#ifndef BATCH_GCD_H
+#define BATCH_GCD_H
+// Batch GCD (Bernstein; Heninger et al.) over a whole corpus of moduli: for
+// every n_i, gcd(n_i, product of all the others), which is 1 unless n_i
+// shares a prime with some other key. A product tree multiplies the moduli
+// in pairs up to their product and a remainder tree reduces it back down;
+// both are O(M(N) log k) for k moduli of N bits in total, with the
+// subquadratic multiplication and division of mp.
+//
+// Every level of both trees is split across the workers, and a product
+// tree too large for memory is spilled to disk a level at a time and read
+// back, top first, while the remainders come down.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../mp/bigint.h"
+#include "RSA.h"
+
+namespace audit {
+
+struct batch_gcd_options {
+    unsigned int num_threads;   // 0 for one per core
+    size_t memory_limit;        // bytes of tree levels kept in memory, 0 for half the RAM
+    std::string spill_dir;      // where levels over the limit go, "" for the temp directory
+};
+
+struct batch_gcd_stats {
+    size_t levels;              // levels of the product tree, the moduli included
+    size_t spilled_levels;      // of those, how many went to disk
+    uint64_t peak_bytes;        // most tree bytes held in memory at once
+};
+
+batch_gcd_options default_batch_gcd_options();
+std::vector<mp::bigint> batch_gcd(const std::vector<mp::bigint>& moduli, const batch_gcd_options& options,
+                                  batch_gcd_stats* stats = nullptr);
+std::vector<mp::bigint> batch_gcd(const std::vector<mp::bigint>& moduli, unsigned int num_threads = 0);
+std::vector<mp::bigint> batch_gcd(const std::vector<rsa::keys>& keys, const batch_gcd_options& options,
+                                  batch_gcd_stats* stats = nullptr);
+
+} // namespace audit
+
+#endif
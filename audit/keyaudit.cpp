@@ -0,0 +1,176 @@
+// keyaudit.cpp : Looks for weak RSA keys in a list of moduli.
+//
+//   keyaudit FILE [--threads N] [--memory MB] [--spill-dir DIR]
+//
+// FILE holds one key per line, "n" or "n e" in decimal; '#' starts a
+// comment. Every modulus is checked against all the others for shared
+// primes, and moduli up to 64 bits are also factored on their own. For a
+// factored key with e given, the private exponent is printed as well.
+// The batch GCD trees are held to --memory megabytes (half the RAM by
+// default) and the rest is spilled to --spill-dir (the temp directory).
+//
+#include "audit.h"
+#include "batch_gcd.h"
+#include "RSA.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct key_line {
+    int line;
+    mp::bigint n;
+    long long e;    // 0 if not given
+};
+
+void usage() {
+    cerr << "usage: keyaudit FILE [--threads N] [--memory MB] [--spill-dir DIR]" << endl;
+}
+
+/**
+ * Prints d = e^-1 mod (p - 1)(q - 1) when the key is small enough for the
+ * int arithmetic of RSA.cpp.
+ */
+void print_private_exponent(uint64_t p, uint64_t q, long long e) {
+    if (e <= 0 || !audit::is_prime(p) || !audit::is_prime(q)) {
+        return;
+    }
+    uint64_t phi = (p - 1) * (q - 1);
+    if (p > 0xffffffffULL || q > 0xffffffffULL || phi > 0x7fffffffULL || e >= static_cast<long long>(phi) ||
+        gcd(static_cast<uint64_t>(e), phi) != 1) {
+        return;
+    }
+    int d = rsa::get_inverse(static_cast<int>(e), static_cast<int>(phi));
+    if (d < 0) {
+        d += static_cast<int>(phi);
+    }
+    cout << ", d = " << d;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    string path = argv[1];
+    audit::batch_gcd_options options = audit::default_batch_gcd_options();
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.num_threads = static_cast<unsigned int>(atoi(argv[++i]));
+        }
+        else if (arg == "--memory" && i + 1 < argc) {
+            options.memory_limit = static_cast<size_t>(strtoull(argv[++i], nullptr, 10)) << 20;
+        }
+        else if (arg == "--spill-dir" && i + 1 < argc) {
+            options.spill_dir = argv[++i];
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    ifstream in(path);
+    if (!in) {
+        cerr << "cannot open " << path << endl;
+        return 1;
+    }
+
+    vector<key_line> keys;
+    string text;
+    for (int line = 1; getline(in, text); ++line) {
+        size_t comment = text.find('#');
+        if (comment != string::npos) {
+            text.erase(comment);
+        }
+        istringstream fields(text);
+        string n_text;
+        if (!(fields >> n_text)) {
+            continue;
+        }
+
+        key_line key;
+        key.line = line;
+        key.e = 0;
+        fields >> key.e;
+        if (!mp::from_decimal(n_text, key.n) || mp::compare(key.n, mp::from_u64(1)) <= 0) {
+            cerr << path << ":" << line << ": not a modulus: " << n_text << endl;
+            continue;
+        }
+        keys.push_back(key);
+    }
+
+    vector<mp::bigint> moduli;
+    for (const key_line& key : keys) {
+        moduli.push_back(key.n);
+    }
+    vector<mp::bigint> shared;
+    try {
+        shared = audit::batch_gcd(moduli, options);
+    }
+    catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    size_t weak = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const key_line& key = keys[i];
+        string n_text = mp::to_decimal(key.n);
+        mp::bigint g = shared[i];
+
+        if (mp::compare(g, mp::from_u64(1)) != 0) {
+            // every prime of a duplicated key is shared; split it by the
+            // first other key it has a factor in common with
+            for (size_t j = 0; j < keys.size() && mp::compare(g, key.n) == 0; ++j) {
+                mp::bigint pair = mp::gcd(key.n, keys[j].n);
+                if (j != i && mp::compare(pair, mp::from_u64(1)) != 0 && mp::compare(pair, key.n) != 0) {
+                    g = pair;
+                }
+            }
+
+            ++weak;
+            cout << "line " << key.line << ": n = " << n_text;
+            if (mp::compare(g, key.n) == 0) {
+                cout << " is duplicated in the list" << endl;
+                continue;
+            }
+            mp::bigint q = mp::div(key.n, g);
+            cout << " = " << mp::to_decimal(g) << " * " << mp::to_decimal(q) << " (shared prime)";
+            if (mp::fits_u64(g) && mp::fits_u64(q)) {
+                print_private_exponent(mp::to_u64(g), mp::to_u64(q), key.e);
+            }
+            cout << endl;
+            continue;
+        }
+
+        if (!mp::fits_u64(key.n)) {
+            continue;
+        }
+        audit::factor_result f = audit::factor_modulus(mp::to_u64(key.n), options.num_threads);
+        if (f.method == audit::FACTOR_NONE) {
+            continue;
+        }
+
+        ++weak;
+        cout << "line " << key.line << ": n = " << n_text;
+        if (f.method == audit::FACTOR_PRIME) {
+            cout << " is prime" << endl;
+            continue;
+        }
+        cout << " = " << f.p << " * " << f.q << " (" << audit::method_name(f.method) << ")";
+        print_private_exponent(f.p, f.q, key.e);
+        cout << endl;
+    }
+
+    cout << keys.size() << " keys, " << weak << " weak" << endl;
+    return weak == 0 ? 0 : 2;
+}
@@ -0,0 +1,224 @@
+#ifndef BENCH_H
+#define BENCH_H
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/chacha20.h"
+#include "../common/op_counters.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace bench {
+
+struct result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double cycles_per_op;       // 0 where no cycle counter is available
+    double bytes_per_second;    // 0 unless the benchmark set bytes per op
+};
+
+/**
+ * Command line options and the results collected so far. Shared by every
+ * benchmark in one executable.
+ */
+struct options {
+    std::string filter;
+    std::string json_path;      // "-" for stdout
+    double min_seconds = 0.2;
+    uint64_t seed = 1;
+    std::vector<result> results;
+};
+
+inline options& settings() {
+    static options opts;
+    return opts;
+}
+
+/**
+ * Read the time stamp counter. On x86 this ticks at the nominal clock rate,
+ * so cycles/op matches core cycles only when turbo and frequency scaling are
+ * off.
+ */
+inline uint64_t read_cycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Keep the compiler from optimizing away a value that is only computed for
+ * the benchmark.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * Parse the benchmark options:
+ *   --filter=TEXT     only run benchmarks whose name contains TEXT
+ *   --min-time=SEC    shortest batch that is trusted (default 0.2)
+ *   --json[=FILE]     also write the results as JSON, to stdout if no FILE
+ *   --seed=N          seed for every random draw (default 1), so keys and
+ *                     nonces are the same from run to run
+ */
+inline void init(int argc, char* argv[]) {
+    options& opts = settings();
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--filter=", 9) == 0) {
+            opts.filter = argv[i] + 9;
+        }
+        else if (strncmp(argv[i], "--min-time=", 11) == 0) {
+            opts.min_seconds = atof(argv[i] + 11);
+        }
+        else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            opts.seed = strtoull(argv[i] + 7, nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--json") == 0) {
+            opts.json_path = "-";
+        }
+        else if (strncmp(argv[i], "--json=", 7) == 0) {
+            opts.json_path = argv[i] + 7;
+        }
+        else {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            exit(2);
+        }
+    }
+    rng::set_seed(opts.seed);
+}
+
+/**
+ * Time fn, doubling the number of calls until a batch takes at least the
+ * minimum time, and print the cost of one call.
+ *
+ * @param name the name printed for this benchmark, "op/arg:value" for sweeps
+ * @param fn the operation to time, called with no arguments
+ * @param bytes_per_op bytes processed by one call, 0 if not meaningful
+ * @return the measured result, with iterations 0 if filtered out
+ */
+template <typename Fn>
+result run(const std::string& name, Fn&& fn, uint64_t bytes_per_op = 0) {
+    using clock = std::chrono::steady_clock;
+    options& opts = settings();
+
+    if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos) {
+        return result{ name, 0, 0, 0, 0 };
+    }
+
+    uint64_t iterations = 1;
+    double elapsed_ns = 0;
+    uint64_t cycles = 0;
+#ifdef MATH241_INSTRUMENT
+    counters::snapshot before = {};
+#endif
+    while (true) {
+#ifdef MATH241_INSTRUMENT
+        before = counters::take_snapshot();
+#endif
+        auto start = clock::now();
+        uint64_t start_cycles = read_cycles();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            fn();
+        }
+        cycles = read_cycles() - start_cycles;
+        elapsed_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        if (elapsed_ns >= opts.min_seconds * 1e9 || iterations >= (uint64_t(1) << 40)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    result r;
+    r.name = name;
+    r.iterations = iterations;
+    r.ns_per_op = elapsed_ns / iterations;
+    r.cycles_per_op = static_cast<double>(cycles) / iterations;
+    r.bytes_per_second = bytes_per_op ? bytes_per_op * 1e9 / r.ns_per_op : 0;
+    opts.results.push_back(r);
+
+    // keep stdout clean when it carries the JSON
+    std::ostream& log = opts.json_path == "-" ? std::cerr : std::cout;
+    log << r.name << ": " << r.ns_per_op << " ns/op, " << r.cycles_per_op << " cycles/op";
+    if (bytes_per_op) {
+        log << ", " << r.bytes_per_second / 1e6 << " MB/s";
+    }
+    log << " (" << r.iterations << " iterations)" << std::endl;
+
+#ifdef MATH241_INSTRUMENT
+    // operation counts of the final batch, per call
+    counters::snapshot after = counters::take_snapshot();
+    for (int i = 0; i < counters::OP_COUNTER_COUNT; ++i) {
+        uint64_t delta = after.counts[i] - before.counts[i];
+        if (delta) {
+            log << "    " << counters::counter_name(static_cast<counters::op_counter>(i)) << ": "
+                << static_cast<double>(delta) / iterations << "/op" << std::endl;
+        }
+    }
+#endif
+
+    return r;
+}
+
+/**
+ * Write the collected results as JSON if --json was given. The layout
+ * follows Google Benchmark's so the same tooling can compare runs.
+ *
+ * @return 0, for use as the exit code of main
+ */
+inline int finish() {
+    options& opts = settings();
+    if (opts.json_path.empty()) {
+        return 0;
+    }
+
+    std::ofstream file;
+    if (opts.json_path != "-") {
+        file.open(opts.json_path);
+    }
+    std::ostream& out = opts.json_path == "-" ? std::cout : file;
+
+    out << "{\n  \"context\": {\n";
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "    \"min_time\": " << opts.min_seconds << ",\n";
+    out << "    \"seed\": " << opts.seed << "\n  },\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < opts.results.size(); ++i) {
+        const result& r = opts.results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"real_time\": " << r.ns_per_op << ", \"time_unit\": \"ns\""
+            << ", \"cycles_per_op\": " << r.cycles_per_op
+            << ", \"bytes_per_second\": " << r.bytes_per_second << "}"
+            << (i + 1 < opts.results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+
+    return 0;
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,114 @@
+// bench_audit.cpp : Timings for the multiprecision layer and the key audit.
+//
+#include "audit.h"
+#include "batch_gcd.h"
+#include "bench.h"
+#include "../common/chacha20.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Draws a random odd number of the given size with the top bit set.
+ *
+ * @param limbs The size in 64-bit limbs.
+ * @param random The generator to draw from.
+ * @return The number.
+ */
+mp::bigint random_odd(size_t limbs, rng::chacha20_drbg& random) {
+    mp::bigint r;
+    for (size_t i = 0; i < limbs; ++i) {
+        r.limbs.push_back(random.next_u64());
+    }
+    r.limbs[0] |= 1;
+    r.limbs.back() |= uint64_t(1) << 63;
+    return r;
+}
+
+int main(int argc, char* argv[])
+{
+    bench::init(argc, argv);
+    rng::chacha20_drbg& random = rng::thread_rng();
+
+    for (size_t bits : { 256, 1024, 2048, 4096 }) {
+        string size = "/bits:" + to_string(bits);
+        mp::bigint a = random_odd(bits / 64, random);
+        mp::bigint b = random_odd(bits / 64, random);
+        mp::bigint wide = mp::mul(a, b);
+        bench::run("mp_mul" + size, [&] { bench::do_not_optimize(mp::mul(a, b)); });
+        bench::run("mp_sqr" + size, [&] { bench::do_not_optimize(mp::sqr(a)); });
+        bench::run("mp_mod" + size, [&] { bench::do_not_optimize(mp::mod(wide, a)); });
+        bench::run("mp_gcd" + size, [&] { bench::do_not_optimize(mp::gcd(a, b)); });
+    }
+
+    // the sizes near the root of a product tree, where Karatsuba and the
+    // Newton division take over
+    for (size_t bits : { 65536, 262144 }) {
+        string size = "/bits:" + to_string(bits);
+        mp::bigint a = random_odd(bits / 64, random);
+        mp::bigint b = random_odd(bits / 64, random);
+        mp::bigint wide = mp::mul(a, b);
+        bench::run("mp_mul" + size + "/threads:1", [&] { bench::do_not_optimize(mp::mul(a, b)); });
+        bench::run("mp_mul" + size + "/threads:all", [&] { bench::do_not_optimize(mp::mul(a, b, 0)); });
+        bench::run("mp_sqr" + size + "/threads:1", [&] { bench::do_not_optimize(mp::sqr(a)); });
+
+        // the same product with Toom-3 switched off
+        mp::mul_thresholds tuned = mp::get_mul_thresholds();
+        mp::mul_thresholds karatsuba_only = tuned;
+        karatsuba_only.toom3 = SIZE_MAX;
+        mp::set_mul_thresholds(karatsuba_only);
+        bench::run("mp_mul" + size + "/threads:1/karatsuba", [&] { bench::do_not_optimize(mp::mul(a, b)); });
+        mp::set_mul_thresholds(tuned);
+        bench::run("mp_mod" + size + "/threads:1", [&] { bench::do_not_optimize(mp::mod(wide, a)); });
+    }
+
+    // the fixed-size kernels against their portable fallbacks
+    for (bool adx : { true, false }) {
+        if (mp::use_adx_kernels(adx) != adx) {
+            continue;
+        }
+        string kernel = string("/kernel:") + mp::limb_kernels();
+        for (size_t bits : { 256, 1024, 2048 }) {
+            string size = "/bits:" + to_string(bits);
+            mp::bigint a = random_odd(bits / 64, random);
+            mp::bigint b = random_odd(bits / 64, random);
+            mp::bigint n = random_odd(bits / 64, random);
+            mp::mont_ctx ctx = mp::mont_init(n);
+            mp::bigint x = mp::mod(a, n);
+            mp::bigint y = mp::mod(b, n);
+            bench::run("mp_mul" + size + kernel, [&] { bench::do_not_optimize(mp::mul(a, b)); });
+            bench::run("mont_mul" + size + kernel, [&] { bench::do_not_optimize(mp::mont_mul(ctx, x, y)); });
+            if (bits >= 1024) {
+                bench::run("mont_modexp" + size + kernel, [&] { bench::do_not_optimize(mp::mont_modexp(ctx, x, a)); });
+            }
+        }
+    }
+    mp::use_adx_kernels(true);
+
+    // moduli of two 32-bit primes: the single-key attacks
+    uint64_t p = 4294967291ULL;
+    uint64_t q = 4294967279ULL;
+    uint64_t far = 3221225473ULL;
+    bench::run("fermat/close", [&] { bench::do_not_optimize(audit::fermat(p * q)); });
+    bench::run("pollard_rho/threads:1", [&] { bench::do_not_optimize(audit::pollard_rho(far * q, 1)); });
+
+    // batch GCD over 1024-bit moduli
+    for (size_t count : { 64, 256, 1024 }) {
+        vector<mp::bigint> moduli;
+        for (size_t i = 0; i < count; ++i) {
+            moduli.push_back(mp::mul(random_odd(8, random), random_odd(8, random)));
+        }
+        string name = "batch_gcd/moduli:" + to_string(count);
+        bench::run(name + "/threads:1", [&] { bench::do_not_optimize(audit::batch_gcd(moduli, 1)); });
+        bench::run(name + "/threads:all", [&] { bench::do_not_optimize(audit::batch_gcd(moduli, 0)); });
+
+        // a one-byte budget sends every level but the newest to disk
+        audit::batch_gcd_options spill = audit::default_batch_gcd_options();
+        spill.memory_limit = 1;
+        bench::run(name + "/spill", [&] { bench::do_not_optimize(audit::batch_gcd(moduli, spill)); });
+    }
+
+    return bench::finish();
+}
@@ -0,0 +1,224 @@
+// bench_ec.cpp : Timings for the elliptic curve primitives across curve sizes.
+//
+#include "EC.h"
+#include "x25519.h"
+#include "ed25519.h"
+#include "ecdlp.h"
+#include "point64.h"
+#include "point_table.h"
+#include "bench.h"
+#include "../common/chacha20.h"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace ec;
+
+/**
+ * Finds the first point on a curve with a non-zero y coordinate.
+ *
+ * @param curve: Parameters of the elliptic curve
+ * @return: A point on the curve, or (-1, -1) if none was found.
+ */
+ec_point first_point(ec_curve curve) {
+    ec_point P;
+    P.x = -1;
+    P.y = -1;
+
+    for (int x = 0; x < curve.p; ++x) {
+        long long right = ((long long)x * x % curve.p * x + (long long)curve.a * x + curve.b) % curve.p;
+        for (int y = 1; y < curve.p; ++y) {
+            if ((long long)y * y % curve.p == right) {
+                P.x = x;
+                P.y = y;
+                return P;
+            }
+        }
+    }
+
+    return P;
+}
+
+int main(int argc, char* argv[])
+{
+    bench::init(argc, argv);
+
+    for (int p : { 17, 101, 257, 509 }) {
+        ec_curve curve;
+        curve.a = 2;
+        curve.b = 3;
+        curve.p = p;
+
+        ec_point P = first_point(curve);
+        ec_point Q = point_doubling(P, curve);
+        string size = "/p:" + to_string(p);
+
+        bench::run("point_addition" + size, [&] { bench::do_not_optimize(point_addition(P, Q, curve)); });
+        bench::run("point_doubling" + size, [&] { bench::do_not_optimize(point_doubling(P, curve)); });
+        bench::run("get_inverse" + size, [&] { bench::do_not_optimize(get_inverse(P.y, curve.p)); });
+        bench::run("compute_eea" + size, [&] { bench::do_not_optimize(compute_eea(curve.p, P.y)); });
+
+        // int_mult_point is a loop of additions, so cost grows with the scalar
+        for (int k : { 4, 16, 64 }) {
+            bench::run("int_mult_point" + size + "/k:" + to_string(k), [&] {
+                bench::do_not_optimize(int_mult_point(P, k, curve));
+            });
+        }
+
+        // the group order is counted on the first call and cached
+        bench::run("point_order" + size, [&] { bench::do_not_optimize(point_order(P, curve)); });
+
+        keys k = generate_keys(curve, P);
+        bench::run("generate_keys" + size, [&] { bench::do_not_optimize(generate_keys(curve, P)); });
+        bench::run("encryption" + size, [&] { bench::do_not_optimize(encryption(curve, P, k.pub_k.Q, Q)); });
+
+        // per call is 1024 messages; compare with 1024 x encryption
+        vector<ec_point> messages(1024, Q);
+        vector<encrypted> ciphertexts(messages.size());
+        bench::run("encryption_batch" + size + "/count:1024", [&] {
+            encryption_batch(curve, P, k.pub_k.Q, messages.data(), ciphertexts.data(), messages.size());
+            bench::do_not_optimize(ciphertexts[0]);
+        });
+    }
+
+    // ECDH and ECDSA on curves whose base point has prime order n
+    struct signing_curve {
+        ec_curve curve;
+        ec_point P;
+        int n;
+    };
+    for (signing_curve sc : { signing_curve{ { 2, 10, 509 }, { 3, 68 }, 479 },
+                              signing_curve{ { 2, 11, 691 }, { 5, 84 }, 659 } }) {
+        string size = "/p:" + to_string(sc.curve.p);
+        int d = sc.n / 3;
+        int k = sc.n - 5;
+        ec_point Q = scalar_mult(sc.P, d, sc.curve);
+        unsigned char secret[32];
+        string message = "the quick brown fox jumps over the lazy dog";
+        ecdsa_signature sig = ecdsa_sign(sc.curve, sc.P, sc.n, d, message);
+
+        bench::run("scalar_mult" + size, [&] { bench::do_not_optimize(scalar_mult(sc.P, k, sc.curve)); });
+        bench::run("shamir_mult" + size, [&] {
+            bench::do_not_optimize(shamir_mult(sc.P, k, Q, d, sc.curve));
+        });
+        bench::run("ecdh_shared_secret" + size, [&] {
+            bench::do_not_optimize(ecdh_shared_secret(Q, k, sc.curve, secret));
+        });
+        bench::run("ecdsa_sign" + size, [&] {
+            bench::do_not_optimize(ecdsa_sign(sc.curve, sc.P, sc.n, d, message));
+        });
+        bench::run("ecdsa_verify" + size, [&] {
+            bench::do_not_optimize(ecdsa_verify(sc.curve, sc.P, sc.n, Q, message, sig));
+        });
+    }
+
+    // discrete logs on curves of prime order n; mostly point additions, so
+    // additions per second = 1.25 sqrt(n) / time for rho
+    for (signing_curve sc : { signing_curve{ { 2, 22, 1048583 }, { 0, 615811 }, 1048799 },
+                              signing_curve{ { 2, 41, 268435459 }, { 1, 29835795 }, 268447849 } }) {
+        string size = "/p:" + to_string(sc.curve.p);
+        curve64 c = { sc.curve.a, sc.curve.b, sc.curve.p };
+        point64 kP = mult64({ sc.P.x, sc.P.y, false }, sc.n / 3, c);
+        ec_point Q;
+        Q.x = static_cast<int>(kP.x);
+        Q.y = static_cast<int>(kP.y);
+
+        if (sc.n < (1 << 24)) {
+            bench::run("ecdlp_bsgs" + size, [&] {
+                bench::do_not_optimize(ecdlp_bsgs(sc.curve, sc.P, Q, sc.n));
+            });
+        }
+        bench::run("ecdlp_rho" + size + "/threads:1", [&] {
+            bench::do_not_optimize(ecdlp_rho(sc.curve, sc.P, Q, sc.n, 1));
+        });
+        bench::run("ecdlp_rho" + size + "/threads:all", [&] {
+            bench::do_not_optimize(ecdlp_rho(sc.curve, sc.P, Q, sc.n));
+        });
+    }
+
+    // the shared point table: a parallel fill, then lookups that miss cache
+    const uint64_t table_entries = uint64_t(1) << 20;
+    vector<unsigned int> thread_counts = { 1 };
+    if (thread::hardware_concurrency() > 1) {
+        thread_counts.push_back(thread::hardware_concurrency());
+    }
+    for (unsigned int threads : thread_counts) {
+        bench::run("point_table_fill/entries:1048576/threads:" + to_string(threads), [&] {
+            point_table table(table_entries);
+            auto fill = [&](unsigned int t) {
+                uint64_t existing;
+                for (uint64_t i = t; i < table_entries; i += threads) {
+                    table.insert(point_key(static_cast<int64_t>(i * 7919), 0), i, existing);
+                }
+            };
+            vector<thread> pool;
+            for (unsigned int t = 1; t < threads; ++t) {
+                pool.emplace_back(fill, t);
+            }
+            fill(0);
+            for (auto& worker : pool) {
+                worker.join();
+            }
+            bench::do_not_optimize(table.capacity());
+        });
+    }
+    point_table filled(table_entries);
+    uint64_t existing;
+    for (uint64_t i = 0; i < table_entries; ++i) {
+        filled.insert(point_key(static_cast<int64_t>(i * 7919), 0), i, existing);
+    }
+    uint64_t probe = 0;
+    bench::run("point_table_find/entries:1048576", [&] {
+        probe = (probe + 104729) & (table_entries - 1);
+        bench::do_not_optimize(filled.find(point_key(static_cast<int64_t>(probe * 7919), 0), existing));
+    });
+
+    // the full-size curve, for comparison with the toy curves above
+    x25519_keys alice = x25519_generate_keys();
+    x25519_keys bob = x25519_generate_keys();
+    uint8_t secret[X25519_SIZE];
+    bench::run("x25519_base", [&] {
+        x25519_base(secret, alice.private_key);
+        bench::do_not_optimize(secret[0]);
+    });
+    bench::run("x25519_shared_secret", [&] {
+        bench::do_not_optimize(x25519_shared_secret(secret, alice.private_key, bob.public_key));
+    });
+
+    ed25519_keys signer = ed25519_generate_keys();
+    string log_line = "2026-01-01T00:00:00Z keyd: served 1024 requests";
+    ed25519_signature signature = ed25519_sign(signer, log_line);
+    bench::run("ed25519_sign", [&] { bench::do_not_optimize(ed25519_sign(signer, log_line)); });
+    bench::run("ed25519_verify", [&] {
+        bench::do_not_optimize(ed25519_verify(signer.public_key, log_line, signature));
+    });
+    for (size_t count : { 1, 16, 64, 256 }) {
+        vector<ed25519_public_key> keys(count);
+        vector<string> lines(count);
+        vector<ed25519_signature> signatures(count);
+        for (size_t i = 0; i < count; ++i) {
+            ed25519_keys k = ed25519_generate_keys();
+            copy(k.public_key, k.public_key + ED25519_KEY_SIZE, keys[i].begin());
+            lines[i] = log_line + " #" + to_string(i);
+            signatures[i] = ed25519_sign(k, lines[i]);
+        }
+        bench::run("ed25519_verify_batch/count:" + to_string(count) + "/threads:1", [&] {
+            bench::do_not_optimize(ed25519_verify_batch(keys, lines, signatures, 1));
+        });
+    }
+
+    // scalar and nonce generation
+    rng::chacha20_drbg& random = rng::thread_rng();
+    bench::run("rng_uniform", [&] { bench::do_not_optimize(random.uniform(509)); }, sizeof(uint32_t));
+    for (size_t bytes : { 64, 4096, 65536 }) {
+        vector<unsigned char> buffer(bytes);
+        bench::run("rng_fill/bytes:" + to_string(bytes), [&] {
+            random.fill(buffer.data(), buffer.size());
+            bench::do_not_optimize(buffer[0]);
+        }, bytes);
+    }
+
+    return bench::finish();
+}
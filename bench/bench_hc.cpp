@@ -0,0 +1,70 @@
+// bench_hc.cpp : Timings for the Hill cipher engines across message sizes.
+//
+#include "HC.h"
+#include "bench.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace arma;
+using namespace hc;
+
+int main(int argc, char* argv[])
+{
+    bench::init(argc, argv);
+
+    Mat<int> key(3, 3);
+    int bench_key[9] = { 6, 24, 1, 13, 16, 10, 20, 17, 15 };
+    for (int i = 0; i < 9; ++i) {
+        key(i / 3, i % 3) = bench_key[i];
+    }
+    mat key_d = conv_to<mat>::from(key);
+    double key_det = det(key_d);
+
+    bench::run("invert_ley_matrix", [&] { bench::do_not_optimize(invert_ley_matrix(key_det, key_d)); });
+
+    hill_table table = build_hill_table(key);
+    bench::run("build_hill_table", [&] { bench::do_not_optimize(build_hill_table(key)); });
+
+    for (size_t n_blocks : { size_t(16), size_t(1) << 10, size_t(1) << 16 }) {
+        vector<Mat<int>> message;
+        vector<int> flat(3 * n_blocks);
+        vector<int> out(3 * n_blocks);
+
+        unsigned int state = 12345;
+        for (size_t b = 0; b < n_blocks; ++b) {
+            Mat<int> next(3, 1);
+            for (uword j = 0; j < 3; ++j) {
+                state = state * 1103515245 + 12345;
+                next(j) = (state >> 16) % 26;
+                flat[3 * b + j] = next(j);
+            }
+            message.push_back(next);
+        }
+
+        // one byte per letter of the message
+        uint64_t bytes = 3 * n_blocks;
+        string size = "/blocks:" + to_string(n_blocks);
+
+        bench::run("encrypt_hill_cipher/armadillo" + size, [&] {
+            bench::do_not_optimize(encrypt_hill_cipher(message, key));
+        }, bytes);
+        bench::run("encrypt_hill_cipher/table" + size, [&] {
+            bench::do_not_optimize(encrypt_hill_cipher(message, key, HILL_ENGINE_TABLE));
+        }, bytes);
+        bench::run("apply_hill_blocks" + size, [&] {
+            apply_hill_blocks(flat.data(), out.data(), 0, n_blocks, key);
+            bench::do_not_optimize(out);
+        }, bytes);
+        bench::run("apply_hill_table" + size, [&] {
+            apply_hill_table(table, flat.data(), out.data(), 0, n_blocks);
+            bench::do_not_optimize(out);
+        }, bytes);
+        bench::run("encrypt_hill_cipher_parallel/table" + size, [&] {
+            encrypt_hill_cipher_parallel(flat.data(), out.data(), flat.size(), key, HILL_ENGINE_TABLE);
+            bench::do_not_optimize(out);
+        }, bytes);
+    }
+
+    return bench::finish();
+}
@@ -0,0 +1,55 @@
+// bench_hybrid.cpp : Timings for hybrid encryption, key wrap and payload.
+//
+#include "hybrid.h"
+#include "bench.h"
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    bench::init(argc, argv);
+
+    rsa::keys rsa_keys = rsa::generate_keys(32771, 36871);
+    keystore::rsa_record rsa_key = keystore::make_rsa_record(32771, 36871, get<1>(rsa_keys.public_key),
+                                                             rsa_keys.private_key);
+
+    ec::ec_curve curve;
+    curve.a = 2;
+    curve.b = 3;
+    curve.p = 509;
+    ec::ec_point P;
+    P.x = 3;
+    P.y = 6;    // 3^3 + 2*3 + 3 = 36 = 6^2
+    keystore::ec_record ec_key = keystore::make_ec_record(curve, P, ec::generate_keys(curve, P));
+
+    keystore::x25519_record x25519_key;
+    x25519_key.keys = ec::x25519_generate_keys();
+
+    // the fixed cost per message
+    rng::chacha20_drbg& random = rng::thread_rng();
+    hybrid::hybrid_header header;
+    bench::run("wrap_rsa", [&] { bench::do_not_optimize(hybrid::wrap_rsa(rsa_key, header, random)); });
+    bench::run("wrap_ec", [&] { bench::do_not_optimize(hybrid::wrap_ec(ec_key, header, random)); });
+    uint8_t ephemeral[ec::X25519_SIZE];
+    bench::run("wrap_x25519", [&] {
+        bench::do_not_optimize(hybrid::wrap_x25519(x25519_key, header, ephemeral, random));
+    });
+
+    // the cost per byte
+    for (size_t bytes : { 1024, 65536, 1 << 20, 16 << 20 }) {
+        string payload(bytes, 'x');
+        for (unsigned int threads : { 1u, 0u }) {
+            string name = "encrypt_rsa/bytes:" + to_string(bytes) + "/threads:" + (threads ? "1" : "all");
+            bench::run(name, [&] {
+                istringstream in(payload);
+                ostringstream out;
+                hybrid::encrypt(in, out, rsa_key, threads);
+                bench::do_not_optimize(out);
+            }, bytes);
+        }
+    }
+
+    return bench::finish();
+}
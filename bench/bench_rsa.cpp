@@ -0,0 +1,108 @@
+// bench_rsa.cpp : Timings for the RSA primitives across modulus sizes.
+//
+#include "RSA.h"
+#include "bench.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace rsa;
+
+/**
+ * @brief Finds the smallest prime at or above a number.
+ *
+ * @param n Where to start looking.
+ * @return The first prime >= n.
+ */
+int next_prime(int n) {
+    while (true) {
+        bool prime = n > 1;
+        for (int d = 2; d * d <= n && prime; ++d) {
+            prime = n % d != 0;
+        }
+        if (prime) {
+            return n;
+        }
+        ++n;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    bench::init(argc, argv);
+
+    // modulus sizes; n must stay below 2^31 for the int interface
+    for (int bits : { 8, 12, 16, 20, 24, 30 }) {
+        int p = next_prime(1 << (bits / 2));
+        int q = next_prime(p + 2 + (bits > 8 ? 1 << (bits / 2 - 3) : 0));
+        int n = p * q;
+        int phi_n = (p - 1) * (q - 1);
+
+        // the conventional e = 65537 (or the next odd e coprime to phi_n)
+        // rather than the random e of generate_keys, so rsa_encryption times
+        // the short public exponent real keys use
+        int e = 65537 % phi_n;
+        while (e < 3 || !has_inverse(e, phi_n)) {
+            e = e < 3 ? 3 : e + 2;
+        }
+        int d = get_inverse(e, phi_n);
+        if (d < 0) {
+            d += phi_n;
+        }
+
+        string size = "/bits:" + to_string(bits);
+        int x = 65 % n;
+        bench::run("compute_eea" + size, [&] { bench::do_not_optimize(compute_eea(phi_n, e)); });
+        bench::run("get_inverse" + size, [&] { bench::do_not_optimize(get_inverse(e, phi_n)); });
+        bench::run("rsa_encryption" + size, [&] {
+            x = rsa_encryption(n, e, x) + 1;
+            bench::do_not_optimize(x);
+        }, sizeof(int));
+        bench::run("rsa_decryption" + size, [&] {
+            x = rsa_decryption(d, n, x) + 1;
+            bench::do_not_optimize(x);
+        }, sizeof(int));
+
+        mont_ctx ctx = mont_init(n);
+        crt_params crt = make_crt_params(p, q, d);
+        string message = "the quick brown fox jumps over the lazy dog";
+        int signature = rsa_sign(crt, message);
+        bench::run("rsa_sign" + size, [&] { bench::do_not_optimize(rsa_sign(crt, message)); });
+        bench::run("rsa_verify" + size, [&] { bench::do_not_optimize(rsa_verify(ctx, e, message, signature)); });
+    }
+
+    // batch verification of 64-byte messages under one 30-bit key
+    {
+        int p = next_prime(1 << 15);
+        int q = next_prime(p + 2 + (1 << 12));
+        int phi_n = (p - 1) * (q - 1);
+        int e = 65537;
+        int d = get_inverse(e, phi_n);
+        if (d < 0) {
+            d += phi_n;
+        }
+        mont_ctx ctx = mont_init(p * q);
+        crt_params crt = make_crt_params(p, q, d);
+
+        for (size_t count : { 64, 4096, 65536 }) {
+            vector<string> messages(count);
+            vector<int> signatures(count);
+            for (size_t i = 0; i < count; ++i) {
+                messages[i] = string(64, 'a' + i % 26) + to_string(i);
+                signatures[i] = rsa_sign(crt, messages[i]);
+            }
+            bench::run("rsa_verify_batch/count:" + to_string(count), [&] {
+                bench::do_not_optimize(rsa_verify_batch(ctx, e, messages, signatures));
+            }, count * 64);
+        }
+    }
+
+    // generate_keys draws e until it is coprime to phi(n), a few gcds on
+    // average at any size
+    for (int p : { 11, 61, 251, 4093, 32771 }) {
+        int q = next_prime(p + 2);
+        bench::run("generate_keys/p:" + to_string(p), [&] { bench::do_not_optimize(generate_keys(p, q)); });
+    }
+
+    return bench::finish();
+}
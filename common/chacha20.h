@@ -0,0 +1,321 @@
+#ifndef CHACHA20_H
+#define CHACHA20_H
+// ChaCha20 based random generator for key and nonce generation.
+//
+// Each thread owns a generator seeded once from the operating system
+// (getrandom on Linux, std::random_device elsewhere), so drawing random
+// scalars never contends on shared state the way rand() does. Output is
+// produced four blocks at a time; the first 32 bytes of every refill become
+// the next key, so earlier output cannot be recovered from a later state
+// (fast key erasure).
+//
+// rng::set_seed switches every thread_rng() to a deterministic mode for
+// benchmarks and reproducible runs: every thread reseeds from the fixed
+// seed on its next draw, each on its own stream numbered in the order the
+// threads get there. Functions that take a
+// chacha20_drbg& accept any generator, so callers can also inject their own.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
+
+namespace rng {
+
+/**
+ * Fill a buffer with seed material from the operating system.
+ */
+inline void os_entropy(void* out, size_t len) {
+    unsigned char* bytes = static_cast<unsigned char*>(out);
+#if defined(__linux__)
+    while (len > 0) {
+        ssize_t got = getrandom(bytes, len, 0);
+        if (got <= 0) {
+            break;
+        }
+        bytes += got;
+        len -= static_cast<size_t>(got);
+    }
+#endif
+    // no getrandom, or it failed
+    std::random_device device;
+    while (len > 0) {
+        uint32_t word = device();
+        size_t take = len < sizeof(word) ? len : sizeof(word);
+        memcpy(bytes, &word, take);
+        bytes += take;
+        len -= take;
+    }
+}
+
+inline uint32_t rotl32(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+#define CHACHA20_QUARTER_ROUND(a, b, c, d) \
+    a += b; d = rotl32(d ^ a, 16);         \
+    c += d; b = rotl32(b ^ c, 12);         \
+    a += b; d = rotl32(d ^ a, 8);          \
+    c += d; b = rotl32(b ^ c, 7);
+
+/**
+ * One ChaCha20 block (RFC 8439) with a 64-bit block counter and a 64-bit
+ * nonce.
+ *
+ * @param key the eight key words
+ * @param counter the block counter
+ * @param nonce the nonce
+ * @param out the 16 output words
+ */
+inline void chacha20_block(const uint32_t key[8], uint64_t counter, uint64_t nonce, uint32_t out[16]) {
+    uint32_t input[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+        static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32),
+        static_cast<uint32_t>(nonce), static_cast<uint32_t>(nonce >> 32)
+    };
+
+    uint32_t x[16];
+    memcpy(x, input, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        CHACHA20_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        CHACHA20_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        CHACHA20_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        CHACHA20_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        CHACHA20_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        CHACHA20_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        CHACHA20_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        CHACHA20_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) {
+        out[i] = x[i] + input[i];
+    }
+}
+
+#undef CHACHA20_QUARTER_ROUND
+
+/**
+ * Encrypt or decrypt with the ChaCha20 stream cipher: XOR len bytes with
+ * the keystream starting at block first_block. Independent ranges of one
+ * stream can be processed in parallel by passing their block offsets.
+ *
+ * @param key the eight key words
+ * @param nonce the nonce, never reused with the same key
+ * @param first_block the block counter of in[0]
+ * @param in the input bytes
+ * @param out the output bytes, may equal in
+ * @param len the number of bytes
+ */
+inline void chacha20_xor(const uint32_t key[8], uint64_t nonce, uint64_t first_block, const unsigned char* in,
+                         unsigned char* out, size_t len) {
+    uint32_t block[16];
+    unsigned char stream[64];
+    uint64_t counter = first_block;
+
+    while (len > 0) {
+        chacha20_block(key, counter++, nonce, block);
+        for (int i = 0; i < 16; ++i) {
+            stream[4 * i] = static_cast<unsigned char>(block[i]);
+            stream[4 * i + 1] = static_cast<unsigned char>(block[i] >> 8);
+            stream[4 * i + 2] = static_cast<unsigned char>(block[i] >> 16);
+            stream[4 * i + 3] = static_cast<unsigned char>(block[i] >> 24);
+        }
+        size_t take = len < 64 ? len : 64;
+        for (size_t i = 0; i < take; ++i) {
+            out[i] = in[i] ^ stream[i];
+        }
+        in += take;
+        out += take;
+        len -= take;
+    }
+}
+
+/**
+ * ChaCha20 deterministic random bit generator. Meets the standard
+ * UniformRandomBitGenerator requirements, so it can drive std::shuffle and
+ * the <random> distributions as well.
+ */
+class chacha20_drbg {
+public:
+    typedef uint32_t result_type;
+
+    static const size_t BUFFER_BLOCKS = 4;
+
+    /**
+     * Seed from the operating system.
+     */
+    chacha20_drbg() {
+        uint32_t seed[8];
+        os_entropy(seed, sizeof(seed));
+        reseed(seed);
+    }
+
+    /**
+     * Seed from 32 bytes of caller supplied key material.
+     */
+    explicit chacha20_drbg(const uint32_t seed[8]) {
+        reseed(seed);
+    }
+
+    void reseed(const uint32_t seed[8]) {
+        memcpy(key, seed, sizeof(key));
+        counter = 0;
+        used = BUFFER_WORDS;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        if (used == BUFFER_WORDS) {
+            refill();
+        }
+        return buffer[used++];
+    }
+
+    uint64_t next_u64() {
+        uint64_t low = (*this)();
+        return low | (uint64_t((*this)()) << 32);
+    }
+
+    /**
+     * @return a uniform value in [0, bound), bound > 0, without modulo bias
+     */
+    uint32_t uniform(uint32_t bound) {
+        // Lemire's multiply-shift with rejection of the short interval
+        uint64_t m = uint64_t((*this)()) * bound;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < bound) {
+            uint32_t threshold = (0 - bound) % bound;
+            while (low < threshold) {
+                m = uint64_t((*this)()) * bound;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    /**
+     * Fill a buffer with random bytes. Whole blocks are written straight
+     * into the output, then the key is replaced.
+     */
+    void fill(void* out, size_t len) {
+        unsigned char* bytes = static_cast<unsigned char*>(out);
+
+        // use up whatever is left in the buffer first
+        while (len > 0 && used < BUFFER_WORDS) {
+            size_t take = len < sizeof(uint32_t) ? len : sizeof(uint32_t);
+            uint32_t word = buffer[used++];
+            memcpy(bytes, &word, take);
+            bytes += take;
+            len -= take;
+        }
+
+        uint32_t block[16];
+        while (len >= sizeof(block)) {
+            chacha20_block(key, counter++, 0, block);
+            memcpy(bytes, block, sizeof(block));
+            bytes += sizeof(block);
+            len -= sizeof(block);
+        }
+        if (len > 0) {
+            chacha20_block(key, counter++, 0, block);
+            memcpy(bytes, block, len);
+        }
+
+        chacha20_block(key, counter++, 0, block);
+        rekey(block);
+    }
+
+private:
+    static const unsigned BUFFER_WORDS = 16 * BUFFER_BLOCKS - 8;
+
+    void rekey(const uint32_t block[16]) {
+        memcpy(key, block, sizeof(key));
+        counter = 0;
+    }
+
+    void refill() {
+        uint32_t blocks[16 * BUFFER_BLOCKS];
+        for (size_t i = 0; i < BUFFER_BLOCKS; ++i) {
+            chacha20_block(key, counter++, 0, blocks + 16 * i);
+        }
+        rekey(blocks);
+        memcpy(buffer, blocks + 8, sizeof(buffer));
+        used = 0;
+    }
+
+    uint32_t key[8];
+    uint64_t counter;
+    uint32_t buffer[BUFFER_WORDS];
+    unsigned used;
+};
+
+/**
+ * The fixed seed set by set_seed, if any. generation changes on every call
+ * so thread generators know to reseed.
+ */
+struct seed_state {
+    std::atomic<uint64_t> generation{ 0 };
+    std::atomic<uint64_t> seed{ 0 };
+    std::atomic<uint32_t> next_stream{ 0 };
+};
+
+inline seed_state& get_seed_state() {
+    static seed_state state;
+    return state;
+}
+
+/**
+ * Key for one stream of a fixed seed.
+ */
+inline void derive_seed(uint64_t seed, uint32_t stream, uint32_t key[8]) {
+    const uint32_t words[8] = {
+        static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), stream, 0x6d617468, 0x32343100, 0, 0, 0
+    };
+    uint32_t block[16];
+    chacha20_block(words, 0, 0, block);
+    memcpy(key, block, 8 * sizeof(uint32_t));
+}
+
+/**
+ * Make thread_rng() deterministic from now on. Draws are reproducible as
+ * long as threads make their first draw in the same order on every run.
+ *
+ * @param seed any value, the same seed gives the same output
+ */
+inline void set_seed(uint64_t seed) {
+    seed_state& state = get_seed_state();
+    state.seed.store(seed, std::memory_order_relaxed);
+    state.next_stream.store(0, std::memory_order_relaxed);
+    state.generation.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @return the calling thread's generator, seeded on first use from the
+ *         operating system or, after set_seed, from the fixed seed
+ */
+inline chacha20_drbg& thread_rng() {
+    thread_local chacha20_drbg generator;
+    thread_local uint64_t seen_generation = 0;
+
+    seed_state& state = get_seed_state();
+    uint64_t generation = state.generation.load(std::memory_order_acquire);
+    if (generation != seen_generation) {
+        uint32_t key[8];
+        derive_seed(state.seed.load(std::memory_order_relaxed),
+                    state.next_stream.fetch_add(1, std::memory_order_relaxed), key);
+        generator.reseed(key);
+        seen_generation = generation;
+    }
+    return generator;
+}
+
+} // namespace rng
+
+#endif
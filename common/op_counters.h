@@ -0,0 +1,149 @@
+#ifndef OP_COUNTERS_H
+#define OP_COUNTERS_H
+// Optional operation counters for the hot paths of RSA, EC and HC.
+//
+// Built in only when MATH241_INSTRUMENT is defined (CMake option of the same
+// name); otherwise MATH241_COUNT compiles to nothing. Each thread writes to
+// its own cache-line aligned block, so counting never contends. Totals are
+// printed to stderr at exit.
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace counters {
+
+enum op_counter {
+    OP_MOD_MUL,         // modular multiplications
+    OP_MOD_SQUARE,      // modular squarings
+    OP_INVERSION,       // get_inverse calls
+    OP_EEA_ITERATION,   // loop iterations of compute_eea
+    OP_POINT_ADD,       // point_addition calls
+    OP_POINT_DOUBLE,    // point_doubling calls
+    OP_HILL_BLOCK,      // 3x1 Hill blocks encrypted or decrypted
+    OP_COUNTER_COUNT
+};
+
+inline const char* counter_name(op_counter op) {
+    static const char* const names[OP_COUNTER_COUNT] = {
+        "mod_mul", "mod_square", "inversion", "eea_iteration", "point_add", "point_double", "hill_block"
+    };
+    return names[op];
+}
+
+struct snapshot {
+    uint64_t counts[OP_COUNTER_COUNT];
+};
+
+/**
+ * The counters of one thread, padded to whole cache lines so that two
+ * threads never share a line. Only the owning thread writes; relaxed
+ * atomics let snapshot() read them from any thread.
+ */
+struct alignas(64) thread_counters {
+    std::atomic<uint64_t> counts[OP_COUNTER_COUNT];
+};
+
+/**
+ * Every thread_counters block ever handed out. Blocks outlive their threads
+ * so their counts stay in the totals.
+ */
+struct registry {
+    std::mutex guard;
+    std::vector<std::unique_ptr<thread_counters>> blocks;
+
+    ~registry();
+};
+
+inline registry& get_registry() {
+    static registry instance;
+    return instance;
+}
+
+/**
+ * @return the calling thread's counters, registered on first use
+ */
+inline thread_counters& local() {
+    thread_local thread_counters* mine = nullptr;
+    if (!mine) {
+        std::unique_ptr<thread_counters> block(new thread_counters());
+        for (auto& count : block->counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        registry& reg = get_registry();
+        std::lock_guard<std::mutex> lock(reg.guard);
+        mine = block.get();
+        reg.blocks.push_back(std::move(block));
+    }
+    return *mine;
+}
+
+inline void add(op_counter op, uint64_t n = 1) {
+    std::atomic<uint64_t>& count = local().counts[op];
+    // single writer, so a plain load and store is enough
+    count.store(count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/**
+ * @return the totals over all threads so far
+ */
+inline snapshot take_snapshot() {
+    snapshot total = {};
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.guard);
+    for (const auto& block : reg.blocks) {
+        for (int i = 0; i < OP_COUNTER_COUNT; ++i) {
+            total.counts[i] += block->counts[i].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+/**
+ * Zero every counter. Counts added concurrently may or may not survive.
+ */
+inline void reset() {
+    registry& reg = get_registry();
+    std::lock_guard<std::mutex> lock(reg.guard);
+    for (const auto& block : reg.blocks) {
+        for (auto& count : block->counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Print every non-zero total, one "name: count" per line.
+ */
+inline void dump(std::ostream& out, const snapshot& totals) {
+    for (int i = 0; i < OP_COUNTER_COUNT; ++i) {
+        if (totals.counts[i]) {
+            out << counter_name(static_cast<op_counter>(i)) << ": " << totals.counts[i] << "\n";
+        }
+    }
+}
+
+inline registry::~registry() {
+    snapshot total = {};
+    for (const auto& block : blocks) {
+        for (int i = 0; i < OP_COUNTER_COUNT; ++i) {
+            total.counts[i] += block->counts[i].load(std::memory_order_relaxed);
+        }
+    }
+    std::cerr << "Operation counts:\n";
+    dump(std::cerr, total);
+}
+
+} // namespace counters
+
+#ifdef MATH241_INSTRUMENT
+#define MATH241_COUNT(op) ::counters::add(::counters::op)
+#define MATH241_COUNT_N(op, n) ::counters::add(::counters::op, (n))
+#else
+#define MATH241_COUNT(op) ((void)0)
+#define MATH241_COUNT_N(op, n) ((void)0)
+#endif
+
+#endif
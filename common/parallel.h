@@ -0,0 +1,105 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+// The worker split shared by every batch path. A range [0, count) is cut
+// into one contiguous share per worker, each a whole number of grains so
+// shares never split a block or share a cache line, and the calling thread
+// takes the last share itself. Threads are started per call; batches are
+// large enough that this is noise next to the work.
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+/**
+ * @return num_threads, or one per core if it is 0
+ */
+inline unsigned int thread_count(unsigned int num_threads) {
+    return num_threads != 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Runs fn(begin, end) over [0, count) in one contiguous share per worker.
+ * Ranges of a single grain run on the calling thread alone.
+ *
+ * @param count the number of items
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @param grain every share but the last is a multiple of this many items
+ * @param fn callable taking the half-open range [begin, end)
+ * @param overlap called on the calling thread once the other workers have
+ *        started and before it runs its own share, for work to overlap
+ *        with them
+ */
+template <typename Fn, typename Overlap>
+void for_ranges(size_t count, unsigned int num_threads, size_t grain, Fn fn, Overlap overlap) {
+    size_t grains = (count + grain - 1) / grain;
+    size_t workers = std::min(static_cast<size_t>(thread_count(num_threads)), grains);
+
+    if (workers <= 1) {
+        overlap();
+        fn(size_t(0), count);
+        return;
+    }
+
+    size_t per_worker = (grains + workers - 1) / workers * grain;
+
+    std::vector<std::thread> pool;
+    size_t begin = 0;
+    while (begin + per_worker < count) {
+        pool.emplace_back(fn, begin, begin + per_worker);
+        begin += per_worker;
+    }
+
+    overlap();
+    fn(begin, count);
+
+    for (auto& worker : pool) {
+        worker.join();
+    }
+}
+
+template <typename Fn>
+void for_ranges(size_t count, unsigned int num_threads, size_t grain, Fn fn) {
+    for_ranges(count, num_threads, grain, fn, [] {});
+}
+
+/**
+ * Runs fn(i) for every i below count, one contiguous share per worker.
+ *
+ * @param count the number of iterations
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @param fn the loop body, called once per index
+ */
+template <typename Fn>
+void for_each(size_t count, unsigned int num_threads, Fn fn) {
+    for_ranges(count, num_threads, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            fn(i);
+        }
+    });
+}
+
+/**
+ * Runs fn() on num_threads threads at once, the calling thread being one
+ * of them, for searches where every worker draws its own work.
+ *
+ * @param num_threads the number of workers, 0 for one per core
+ * @param fn the worker body
+ */
+template <typename Fn>
+void run_workers(unsigned int num_threads, Fn fn) {
+    num_threads = thread_count(num_threads);
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < num_threads; ++t) {
+        pool.emplace_back(fn);
+    }
+    fn();
+    for (auto& worker : pool) {
+        worker.join();
+    }
+}
+
+} // namespace parallel
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef SHA256_H
+#define SHA256_H
+// SHA-256 (FIPS 180-4), for hashing messages before they are signed, and
+// HMAC-SHA256 (RFC 2104) for deterministic nonces.
+//
+//   digest::sha256 h;
+//   h.update(data, len);      // any number of times
+//   h.final(out);             // 32 bytes
+//
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace digest {
+
+const size_t SHA256_SIZE = 32;
+
+class sha256 {
+public:
+    sha256() {
+        static const uint32_t initial[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        memcpy(state, initial, sizeof(state));
+    }
+
+    void update(const void* data, size_t len) {
+        if (len == 0) {
+            return;
+        }
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        total += len;
+
+        if (used > 0) {
+            size_t take = len < 64 - used ? len : 64 - used;
+            memcpy(block + used, bytes, take);
+            used += take;
+            bytes += take;
+            len -= take;
+            if (used < 64) {
+                return;
+            }
+            compress(block);
+            used = 0;
+        }
+        while (len >= 64) {
+            compress(bytes);
+            bytes += 64;
+            len -= 64;
+        }
+        memcpy(block, bytes, len);
+        used = len;
+    }
+
+    void update(const std::string& data) {
+        update(data.data(), data.size());
+    }
+
+    /**
+     * Pad, finish and write the 32 byte digest. The object is spent after
+     * this.
+     */
+    void final(unsigned char out[SHA256_SIZE]) {
+        uint64_t bits = total * 8;
+        unsigned char pad[72] = { 0x80 };
+        size_t pad_len = used < 56 ? 56 - used : 120 - used;
+        for (int i = 0; i < 8; ++i) {
+            pad[pad_len + i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        }
+        update(pad, pad_len + 8);
+
+        for (int i = 0; i < 8; ++i) {
+            out[4 * i] = static_cast<unsigned char>(state[i] >> 24);
+            out[4 * i + 1] = static_cast<unsigned char>(state[i] >> 16);
+            out[4 * i + 2] = static_cast<unsigned char>(state[i] >> 8);
+            out[4 * i + 3] = static_cast<unsigned char>(state[i]);
+        }
+    }
+
+private:
+    static uint32_t rotr(uint32_t x, int n) {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    void compress(const unsigned char* chunk) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = uint32_t(chunk[4 * i]) << 24 | uint32_t(chunk[4 * i + 1]) << 16 |
+                   uint32_t(chunk[4 * i + 2]) << 8 | uint32_t(chunk[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+
+    uint32_t state[8];
+    unsigned char block[64];
+    size_t used = 0;
+    uint64_t total = 0;
+};
+
+/**
+ * Hash a whole buffer in one call.
+ */
+inline void sha256_digest(const void* data, size_t len, unsigned char out[SHA256_SIZE]) {
+    sha256 h;
+    h.update(data, len);
+    h.final(out);
+}
+
+/**
+ * HMAC-SHA256 of the concatenation of up to three buffers, so callers can
+ * MAC a prefix, a separator byte and a suffix without copying them
+ * together. Unused parts may be null with length 0.
+ */
+inline void hmac_sha256(const unsigned char* key, size_t key_len, const void* part1, size_t len1,
+                        const void* part2, size_t len2, const void* part3, size_t len3,
+                        unsigned char out[SHA256_SIZE]) {
+    unsigned char block[64] = {};
+    if (key_len > sizeof(block)) {
+        sha256_digest(key, key_len, block);
+    }
+    else {
+        memcpy(block, key, key_len);
+    }
+
+    unsigned char pad[64];
+    for (int i = 0; i < 64; ++i) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    sha256 inner;
+    inner.update(pad, sizeof(pad));
+    inner.update(part1, len1);
+    inner.update(part2, len2);
+    inner.update(part3, len3);
+    unsigned char inner_hash[SHA256_SIZE];
+    inner.final(inner_hash);
+
+    for (int i = 0; i < 64; ++i) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    sha256 outer;
+    outer.update(pad, sizeof(pad));
+    outer.update(inner_hash, sizeof(inner_hash));
+    outer.final(out);
+}
+
+inline void hmac_sha256(const unsigned char* key, size_t key_len, const void* data, size_t len,
+                        unsigned char out[SHA256_SIZE]) {
+    hmac_sha256(key, key_len, data, len, nullptr, 0, nullptr, 0, out);
+}
+
+} // namespace digest
+
+#endif
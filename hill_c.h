@@ -1,5 +1,11 @@
 #ifndef HILL_CIPHER
 #define HILL_CIPHER
+#include <string>
 #include <vector>
+extern int key_determinant(const std::vector<int>& key);
 extern bool has_inverse(std::vector<int> key);
-#endif
\ No newline at end of file
+extern std::vector<int> invert_key(const std::vector<int>& key);
+extern std::vector<std::vector<int>> encrypt_hill_cipher(std::vector<std::vector<int>> message, std::vector<int> key);
+extern std::vector<std::vector<int>> decrypt_hill_cipher(std::vector<std::vector<int>> encrpted, std::vector<int> inverse_key);
+extern std::vector<std::vector<int>> create_message_vector(const std::string& message);
+#endif
@@ -1,11 +1,11 @@
 #include <iostream>
 #include <string>
+#include <cmath>
+#include <cctype>
+#include <numeric>
 #include "hill_c.h"
-#include "C:\Program Files\MATLAB\R2024a\extern\include\matrix.h"
-#include "C:\Program Files\MATLAB\R2024a\extern\include\MatlabEngine.hpp"
 
 using namespace std;
-using namespace matlab::engine;
 
 /**
  * Convert the key matrix into a vector for future use
@@ -13,8 +13,8 @@ using namespace matlab::engine;
  * @param key the key matrix to convert
  * @return a vector version of the key matrix
 */
-vector<int> key_to_vector(float key[][3]) {
-    vector<float> keyVector;
+vector<int> key_to_vector(int key[][3]) {
+    vector<int> keyVector;
     for (int i = 0; i < 3; ++i) {
         for (int j = 0; j < 3; ++j) {
             keyVector.push_back(key[i][j]);
@@ -25,20 +25,97 @@ vector<int> key_to_vector(float key[][3]) {
 }
 
 /**
- * Using matlab, check if the key has an inverse
+ * Reduce a value into the range 0-25
+ *
+ * @param value any integer
+ * @return value mod 26, never negative
+*/
+int mod26(int value) {
+    value %= 26;
+    return value < 0 ? value + 26 : value;
+}
+
+/**
+ * Compute the determinant of the key matrix mod 26 with integer arithmetic
+ *
+ * @param key the vector version of the key matrix, row by row
+ * @return the determinant reduced into 0-25
+*/
+extern int key_determinant(const vector<int>& key) {
+    int det = key[0] * (key[4] * key[8] - key[5] * key[7])
+            - key[1] * (key[3] * key[8] - key[5] * key[6])
+            + key[2] * (key[3] * key[7] - key[4] * key[6]);
+
+    return mod26(det);
+}
+
+/**
+ * Check if the key has an inverse mod 26, which is the case exactly when
+ * its determinant shares no factor with 26
  * 
  * @param key the vector version of the key matrix
  * @return True if the key has a matrix or False otherwise
 */
 extern bool has_inverse(std::vector<int> key){
-    std::unique_ptr<MATLABEngine> matlabPtr = startMATLAB();
+    return gcd(key_determinant(key), 26) == 1;
+}
+
+/**
+ * Compute the inverse of the key matrix mod 26 as the inverse of the
+ * determinant times the adjugate
+ *
+ * @param key the vector version of the key matrix, must have an inverse
+ * @return the vector version of the inverse key matrix
+*/
+extern vector<int> invert_key(const vector<int>& key) {
+    int det = key_determinant(key);
 
-    // Initialize 3x3 matlab data arra
-    matlab::data::ArrayFactory factory;
-    Array key_arr = factory.createArray<float>({3,3},
-    key.cbegin(), key.cend());
+    int det_inv = 1;
+    while ((det * det_inv) % 26 != 1) {
+        ++det_inv;
+    }
+
+    // adjugate: transpose of the cofactor matrix
+    int adj[9] = {
+        key[4] * key[8] - key[5] * key[7],
+        key[2] * key[7] - key[1] * key[8],
+        key[1] * key[5] - key[2] * key[4],
+        key[5] * key[6] - key[3] * key[8],
+        key[0] * key[8] - key[2] * key[6],
+        key[2] * key[3] - key[0] * key[5],
+        key[3] * key[7] - key[4] * key[6],
+        key[1] * key[6] - key[0] * key[7],
+        key[0] * key[4] - key[1] * key[3]
+    };
+
+    vector<int> inverse(9);
+    for (int i = 0; i < 9; ++i) {
+        inverse[i] = mod26(mod26(adj[i]) * det_inv);
+    }
 
-    return true;
+    return inverse;
+}
+
+/**
+ * Multiply every group of three by a 3x3 matrix mod 26
+ *
+ * @param groups the message grouped by three characters together
+ * @param key the vector version of the matrix
+ * @return the transformed groups
+*/
+vector<vector<int>> apply_key(const vector<vector<int>>& groups, const vector<int>& key) {
+    vector<vector<int>> result;
+    result.reserve(groups.size());
+
+    for (const auto& group : groups) {
+        vector<int> next(3);
+        for (int i = 0; i < 3; ++i) {
+            next[i] = mod26(key[3 * i] * group[0] + key[3 * i + 1] * group[1] + key[3 * i + 2] * group[2]);
+        }
+        result.push_back(next);
+    }
+
+    return result;
 }
 
 
@@ -52,8 +129,7 @@ extern bool has_inverse(std::vector<int> key){
  * @return the encrypted message
 */
 vector<vector<int>> encrypt_hill_cipher(vector<vector<int>> message, vector<int> key){
-
-    return NULL;
+    return apply_key(message, key);
 }
 
 /**
@@ -67,11 +143,25 @@ vector<vector<int>> encrypt_hill_cipher(vector<vector<int>> message, vector<int>
  * @return the decrypted messgae in vector form
 */
 vector<vector<int>> decrypt_hill_cipher(vector<vector<int>> encrpted, vector<int> inverse_key) {
-    return NULL;
+    return apply_key(encrpted, inverse_key);
 }
 
 
-
+/**
+ * Print a message held as groups of three values 0-25
+ *
+ * @param label printed before the message
+ * @param groups the message grouped by three characters together
+*/
+void print_groups(const string& label, const vector<vector<int>>& groups) {
+    cout << label << endl;
+    for (const auto& group : groups) {
+        for (int value : group) {
+            cout << static_cast<char>(value + 'A');
+        }
+    }
+    cout << endl;
+}
 
 
 vector<vector<int>> create_message_vector(const string& message){
@@ -80,17 +170,18 @@ vector<vector<int>> create_message_vector(const string& message){
     const int cols_needed = ceil(static_cast<double>(message_l) / 3);
 
     for (int i = 0; i < cols_needed; i++){
+        // short final groups are padded with A
         vector<int> curr_group(3,0);
         for (int j = 0; j < 3; ++j) {
             int index = i * 3 + j;
             if (index < message_l) {
-                curr_group[j] = static_cast<int>(message[index] - 'A') % 26;
+                curr_group[j] = mod26(static_cast<int>(message[index] - 'A'));
             }
             else {
                 break;
             }
         }
-        messageGroups.push_back(group);
+        message_vectors.push_back(curr_group);
     }
 
     return message_vectors;
@@ -101,11 +192,14 @@ int main() {
     cout << "Enter your message: ";
     string message;
     cin >> message;
+    for (auto& c : message) {
+        c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
 
-    vector<vector<int>> message_matrix = create_message_vector(&message);
+    vector<vector<int>> message_matrix = create_message_vector(message);
 
-    float key[3][3];
-    vector<vector<int>> key_vector;
+    int key[3][3];
+    vector<int> key_vector;
     bool inverse = false;
     do{
         cout <<"Enter 3x3 matrix for key (should have inverse):\n";
@@ -116,20 +210,26 @@ int main() {
                 key[i][j] = static_cast<int>(std::fabs(value)) % 26;
             }
         }
+        if (!cin) {
+            return 1;
+        }
         key_vector = key_to_vector(key);
 
         inverse = has_inverse(key_vector);
         if (!inverse) {
-            cout << "Key does not have an inverse. 
-            Please enter a different key.\n";
+            cout << "Key does not have an inverse. "
+                    "Please enter a different key.\n";
         }
     } while(!inverse);
 
+    vector<int> inverse_key = invert_key(key_vector);
 
     vector<vector<int>> encrypted = encrypt_hill_cipher(message_matrix, 
                                                         key_vector);
+    print_groups("Encrypted Message: ", encrypted);
 
-    vector<vector<int>> decrypted = decrypt_hill_cipher(encrypted, inverse);
+    vector<vector<int>> decrypted = decrypt_hill_cipher(encrypted, inverse_key);
+    print_groups("Decrypted Message: ", decrypted);
 
     return 0;
-}
\ No newline at end of file
+}
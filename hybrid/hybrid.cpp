@@ -0,0 +1,411 @@
+// hybrid.cpp : Key wrapping and the chunked ChaCha20 pipeline.
+//
+#include "hybrid.h"
+#include "../common/parallel.h"
+#include "../common/sha256.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace hybrid {
+
+void put_u32(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+uint32_t get_u32(const unsigned char* p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+}
+
+void encode_header(const hybrid_header& header, unsigned char bytes[HYBRID_HEADER_SIZE]) {
+    memcpy(bytes, HYBRID_MAGIC, sizeof(HYBRID_MAGIC));
+    put_u32(bytes + 8, header.scheme);
+    put_u32(bytes + 12, static_cast<uint32_t>(header.wrapped[0]));
+    put_u32(bytes + 16, static_cast<uint32_t>(header.wrapped[1]));
+    put_u32(bytes + 20, static_cast<uint32_t>(header.nonce >> 32));
+    put_u32(bytes + 24, static_cast<uint32_t>(header.nonce));
+}
+
+/**
+ * Derive the stream key from the shared secret and everything in the
+ * header, so a key is never reused under a different nonce or wrap.
+ *
+ * @param header the header that will be sent
+ * @param shared the shared secret bytes
+ * @param len the number of shared bytes
+ * @return the stream key
+ */
+stream_key derive_key(const hybrid_header& header, const unsigned char* shared, size_t len) {
+    unsigned char bytes[HYBRID_HEADER_SIZE];
+    encode_header(header, bytes);
+
+    digest::sha256 h;
+    h.update(bytes, sizeof(bytes));
+    h.update(shared, len);
+
+    unsigned char hash[digest::SHA256_SIZE];
+    h.final(hash);
+
+    stream_key key;
+    for (int i = 0; i < 8; ++i) {
+        key.key[i] = uint32_t(hash[4 * i]) | uint32_t(hash[4 * i + 1]) << 8 |
+                     uint32_t(hash[4 * i + 2]) << 16 | uint32_t(hash[4 * i + 3]) << 24;
+    }
+    key.nonce = header.nonce;
+    return key;
+}
+
+/**
+ * Wrap a fresh stream key with RSA: encrypt a random r < n and derive the
+ * key from r.
+ *
+ * @param rsa the recipient's key
+ * @param header filled in with the wrapped key and nonce
+ * @param random the generator for r and the nonce
+ * @return the stream key
+ */
+stream_key wrap_rsa(const keystore::rsa_record& rsa, hybrid_header& header, rng::chacha20_drbg& random) {
+    int32_t r = static_cast<int32_t>(random.uniform(static_cast<uint32_t>(rsa.n - 2))) + 2;
+
+    header.scheme = WRAP_RSA;
+    header.wrapped[0] = rsa::mont_modexp(rsa.mont, r, rsa.e);
+    header.wrapped[1] = 0;
+    header.nonce = random.next_u64();
+
+    unsigned char shared[4];
+    put_u32(shared, static_cast<uint32_t>(r));
+    return derive_key(header, shared, sizeof(shared));
+}
+
+/**
+ * Recover the stream key of an RSA wrapped message.
+ *
+ * @param rsa the recipient's key
+ * @param header the received header
+ * @param key set to the stream key
+ * @return false if the header does not hold an RSA wrapped key
+ */
+bool unwrap_rsa(const keystore::rsa_record& rsa, const hybrid_header& header, stream_key& key) {
+    if (header.scheme != WRAP_RSA || header.wrapped[0] < 0 || header.wrapped[0] >= rsa.n) {
+        return false;
+    }
+
+    int32_t r = rsa::rsa_decryption_crt(rsa.crt, header.wrapped[0]);
+    unsigned char shared[4];
+    put_u32(shared, static_cast<uint32_t>(r));
+    key = derive_key(header, shared, sizeof(shared));
+    return true;
+}
+
+/**
+ * Wrap a fresh stream key with EC ElGamal: send C1 = kP and derive the key
+ * from the shared point kQ.
+ *
+ * @param ec the recipient's key, with the fixed-base table of P
+ * @param header filled in with C1 and the nonce
+ * @param random the generator for k and the nonce
+ * @return the stream key
+ */
+stream_key wrap_ec(const keystore::ec_record& ec, hybrid_header& header, rng::chacha20_drbg& random) {
+    ec::ec_point q_table[keystore::EC_TABLE_SIZE];
+    int q_size = ec::build_fixed_base_table(ec.keys.pub_k.Q, ec.curve, q_table, keystore::EC_TABLE_SIZE);
+
+    // k below the order of P, which is all the table of P covers
+    int n = ec::point_order(ec.P, ec.curve);
+    uint32_t bound = static_cast<uint32_t>(n > 1 ? n - 1 : ec.curve.p - 1);
+
+    ec::ec_point C1;
+    ec::ec_point S;
+    do {
+        int k = static_cast<int>(random.uniform(bound)) + 1;
+        C1 = ec::fixed_base_mult(ec.table, ec.table_size, k, ec.curve);
+        S = ec::fixed_base_mult(q_table, q_size, k, ec.curve);
+    } while (ec::is_infinity(C1) || ec::is_infinity(S));
+
+    header.scheme = WRAP_EC;
+    header.wrapped[0] = C1.x;
+    header.wrapped[1] = C1.y;
+    header.nonce = random.next_u64();
+
+    unsigned char shared[8];
+    put_u32(shared, static_cast<uint32_t>(S.x));
+    put_u32(shared + 4, static_cast<uint32_t>(S.y));
+    return derive_key(header, shared, sizeof(shared));
+}
+
+/**
+ * Recover the stream key of an EC wrapped message from dC1 = kQ.
+ *
+ * @param ec the recipient's key
+ * @param header the received header
+ * @param key set to the stream key
+ * @return false if the header does not hold a point of the group of P
+ */
+bool unwrap_ec(const keystore::ec_record& ec, const hybrid_header& header, stream_key& key) {
+    if (header.scheme != WRAP_EC) {
+        return false;
+    }
+
+    ec::ec_point C1;
+    C1.x = header.wrapped[0];
+    C1.y = header.wrapped[1];
+
+    // C1 must be a multiple of P. The payload is not authenticated, so a
+    // forged C1 of small order (off the curve, or outside the group of P)
+    // would show d modulo that order in what the stream decrypts to.
+    if (!ec::on_curve(C1, ec.curve)) {
+        return false;
+    }
+    int n = ec::point_order(ec.P, ec.curve);
+    if (n > 1 && !ec::is_infinity(ec::scalar_mult(C1, n, ec.curve))) {
+        return false;
+    }
+
+    ec::ec_point table[keystore::EC_TABLE_SIZE];
+    int size = ec::build_fixed_base_table(C1, ec.curve, table, keystore::EC_TABLE_SIZE);
+    ec::ec_point S = ec::fixed_base_mult(table, size, ec.keys.pr_k.d, ec.curve);
+    if (ec::is_infinity(S)) {
+        return false;
+    }
+
+    unsigned char shared[8];
+    put_u32(shared, static_cast<uint32_t>(S.x));
+    put_u32(shared + 4, static_cast<uint32_t>(S.y));
+    key = derive_key(header, shared, sizeof(shared));
+    return true;
+}
+
+/**
+ * Wrap a fresh stream key with X25519: generate an ephemeral key pair and
+ * derive the key from its shared secret with the recipient.
+ *
+ * @param x25519 the recipient's key
+ * @param header filled in with the scheme and nonce
+ * @param ephemeral set to the ephemeral public key, sent after the header
+ * @param random the generator for the ephemeral key and the nonce
+ * @return the stream key
+ */
+stream_key wrap_x25519(const keystore::x25519_record& x25519, hybrid_header& header,
+                       uint8_t ephemeral[ec::X25519_SIZE], rng::chacha20_drbg& random) {
+    ec::x25519_keys keys = ec::x25519_generate_keys(random);
+    memcpy(ephemeral, keys.public_key, ec::X25519_SIZE);
+
+    header.scheme = WRAP_X25519;
+    header.wrapped[0] = 0;
+    header.wrapped[1] = 0;
+    header.nonce = random.next_u64();
+
+    // the recipient's key is a valid public key, so the secret is never zero
+    unsigned char shared[2 * ec::X25519_SIZE];
+    memcpy(shared, ephemeral, ec::X25519_SIZE);
+    ec::x25519_shared_secret(shared + ec::X25519_SIZE, keys.private_key, x25519.keys.public_key);
+    return derive_key(header, shared, sizeof(shared));
+}
+
+/**
+ * Recover the stream key of an X25519 wrapped message.
+ *
+ * @param x25519 the recipient's key
+ * @param header the received header
+ * @param ephemeral the ephemeral public key that followed the header
+ * @param key set to the stream key
+ * @return false if the header is not X25519 or the ephemeral key has small
+ *         order
+ */
+bool unwrap_x25519(const keystore::x25519_record& x25519, const hybrid_header& header,
+                   const uint8_t ephemeral[ec::X25519_SIZE], stream_key& key) {
+    if (header.scheme != WRAP_X25519) {
+        return false;
+    }
+
+    unsigned char shared[2 * ec::X25519_SIZE];
+    memcpy(shared, ephemeral, ec::X25519_SIZE);
+    if (!ec::x25519_shared_secret(shared + ec::X25519_SIZE, x25519.keys.private_key, ephemeral)) {
+        return false;
+    }
+    key = derive_key(header, shared, sizeof(shared));
+    return true;
+}
+
+/**
+ * Read until the buffer is full or the input ends.
+ *
+ * @return the number of bytes read
+ */
+size_t read_fully(istream& in, vector<unsigned char>& buffer) {
+    in.read(reinterpret_cast<char*>(buffer.data()), static_cast<streamsize>(buffer.size()));
+    return static_cast<size_t>(in.gcount());
+}
+
+/**
+ * Encrypt or decrypt a stream with ChaCha20. The input is read in batches of
+ * one HYBRID_CHUNK per worker; while the workers run on one batch the
+ * calling thread reads the next, so reading overlaps the cipher.
+ *
+ * @param in the input
+ * @param out the output
+ * @param key the stream key
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @return the number of bytes processed
+ */
+uint64_t process_stream(istream& in, ostream& out, const stream_key& key, unsigned int num_threads) {
+    num_threads = parallel::thread_count(num_threads);
+    size_t batch = HYBRID_CHUNK * num_threads;
+
+    vector<unsigned char> current(batch);
+    vector<unsigned char> next(batch);
+    size_t current_len = read_fully(in, current);
+    uint64_t offset = 0;
+
+    while (current_len > 0) {
+        auto xor_range = [&](size_t begin, size_t end) {
+            rng::chacha20_xor(key.key, key.nonce, (offset + begin) / 64, current.data() + begin,
+                              current.data() + begin, end - begin);
+        };
+
+        // one chunk per worker; this thread reads the next batch before
+        // taking its own
+        size_t next_len = 0;
+        parallel::for_ranges(current_len, num_threads, HYBRID_CHUNK, xor_range, [&] {
+            next_len = current_len == batch ? read_fully(in, next) : 0;
+        });
+
+        out.write(reinterpret_cast<const char*>(current.data()), static_cast<streamsize>(current_len));
+        offset += current_len;
+        swap(current, next);
+        current_len = next_len;
+    }
+
+    return offset;
+}
+
+void write_header(ostream& out, const hybrid_header& header) {
+    unsigned char bytes[HYBRID_HEADER_SIZE];
+    encode_header(header, bytes);
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+}
+
+bool read_header(istream& in, hybrid_header& header) {
+    unsigned char bytes[HYBRID_HEADER_SIZE];
+    in.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+    if (in.gcount() != static_cast<streamsize>(sizeof(bytes)) ||
+        memcmp(bytes, HYBRID_MAGIC, sizeof(HYBRID_MAGIC)) != 0) {
+        return false;
+    }
+
+    header.scheme = get_u32(bytes + 8);
+    header.wrapped[0] = static_cast<int32_t>(get_u32(bytes + 12));
+    header.wrapped[1] = static_cast<int32_t>(get_u32(bytes + 16));
+    header.nonce = uint64_t(get_u32(bytes + 20)) << 32 | get_u32(bytes + 24);
+    return true;
+}
+
+/**
+ * Encrypt a stream to an RSA key.
+ *
+ * @param in the plaintext
+ * @param out receives the header and ciphertext
+ * @param rsa the recipient's key
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @return true if everything was written
+ */
+bool encrypt(istream& in, ostream& out, const keystore::rsa_record& rsa, unsigned int num_threads) {
+    hybrid_header header;
+    stream_key key = wrap_rsa(rsa, header, rng::thread_rng());
+    write_header(out, header);
+    process_stream(in, out, key, num_threads);
+    return static_cast<bool>(out);
+}
+
+/**
+ * Encrypt a stream to an EC key.
+ *
+ * @param in the plaintext
+ * @param out receives the header and ciphertext
+ * @param ec the recipient's key
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @return true if everything was written
+ */
+bool encrypt(istream& in, ostream& out, const keystore::ec_record& ec, unsigned int num_threads) {
+    hybrid_header header;
+    stream_key key = wrap_ec(ec, header, rng::thread_rng());
+    write_header(out, header);
+    process_stream(in, out, key, num_threads);
+    return static_cast<bool>(out);
+}
+
+/**
+ * Encrypt a stream to an X25519 key.
+ *
+ * @param in the plaintext
+ * @param out receives the header, ephemeral key and ciphertext
+ * @param x25519 the recipient's key
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @return true if everything was written
+ */
+bool encrypt(istream& in, ostream& out, const keystore::x25519_record& x25519, unsigned int num_threads) {
+    hybrid_header header;
+    uint8_t ephemeral[ec::X25519_SIZE];
+    stream_key key = wrap_x25519(x25519, header, ephemeral, rng::thread_rng());
+    write_header(out, header);
+    out.write(reinterpret_cast<const char*>(ephemeral), sizeof(ephemeral));
+    process_stream(in, out, key, num_threads);
+    return static_cast<bool>(out);
+}
+
+/**
+ * Decrypt a stream with whichever key matches its header.
+ *
+ * @param in the header and ciphertext
+ * @param out receives the plaintext
+ * @param rsa the RSA key, or nullptr
+ * @param ec the EC key, or nullptr
+ * @param x25519 the X25519 key, or nullptr
+ * @param error set to the reason on failure
+ * @param num_threads the number of workers to use, 0 for one per core
+ * @return true if the stream was decrypted
+ */
+bool decrypt(istream& in, ostream& out, const keystore::rsa_record* rsa, const keystore::ec_record* ec,
+             const keystore::x25519_record* x25519, string& error, unsigned int num_threads) {
+    hybrid_header header;
+    if (!read_header(in, header)) {
+        error = "not a hybrid encrypted stream";
+        return false;
+    }
+
+    stream_key key;
+    bool unwrapped = false;
+    if (header.scheme == WRAP_RSA) {
+        unwrapped = rsa && unwrap_rsa(*rsa, header, key);
+    }
+    else if (header.scheme == WRAP_EC) {
+        unwrapped = ec && unwrap_ec(*ec, header, key);
+    }
+    else if (header.scheme == WRAP_X25519) {
+        uint8_t ephemeral[ec::X25519_SIZE];
+        in.read(reinterpret_cast<char*>(ephemeral), sizeof(ephemeral));
+        if (in.gcount() != static_cast<streamsize>(sizeof(ephemeral))) {
+            error = "not a hybrid encrypted stream";
+            return false;
+        }
+        unwrapped = x25519 && unwrap_x25519(*x25519, header, ephemeral, key);
+    }
+    if (!unwrapped) {
+        error = "no key to unwrap this stream";
+        return false;
+    }
+
+    process_stream(in, out, key, num_threads);
+    if (!out) {
+        error = "write failed";
+        return false;
+    }
+    return true;
+}
+
+} // namespace hybrid
@@ -0,0 +1,75 @@
+#ifndef HYBRID_H
+#define HYBRID_H
+// Hybrid encryption: a fresh ChaCha20 key per message, wrapped with RSA,
+// EC ElGamal or X25519, so the public key operation is paid once per
+// message and the payload runs at stream cipher speed.
+//
+// Encrypted stream layout, integers big endian:
+//
+//   8 bytes   HYBRID_MAGIC
+//   u32       scheme, 1 = RSA, 2 = EC, 3 = X25519
+//   i32 i32   wrapped key: RSA ciphertext and 0, the EC point C1, or 0 0
+//   u64       nonce
+//   32 bytes  X25519 only: the ephemeral public key
+//   ...       payload XOR the ChaCha20 keystream
+//
+// The keys here are far too small to carry a 256-bit key directly, so the
+// wrap is a key encapsulation: RSA encrypts a random r < n and EC ElGamal
+// sends C1 = kP with the shared point kQ; the stream key is SHA-256 of the
+// shared value, the wrapped value and the nonce. X25519 is an ephemeral
+// Diffie-Hellman with the recipient's key, hashed with the ephemeral public
+// key. The payload is not authenticated.
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include "keystore.h"
+#include "../common/chacha20.h"
+
+namespace hybrid {
+
+const char HYBRID_MAGIC[8] = { 'M', '2', '4', '1', 'H', 'Y', 'B', '1' };
+const size_t HYBRID_HEADER_SIZE = 28;
+
+// Bytes per pipeline chunk. A multiple of the 64-byte ChaCha20 block, so
+// every chunk starts on a block boundary and chunks can run in parallel.
+const size_t HYBRID_CHUNK = 64 * 1024;
+
+enum wrap_scheme : uint32_t {
+    WRAP_RSA = 1,
+    WRAP_EC = 2,
+    WRAP_X25519 = 3
+};
+
+struct hybrid_header {
+    uint32_t scheme;
+    int32_t wrapped[2];
+    uint64_t nonce;
+};
+
+struct stream_key {
+    uint32_t key[8];
+    uint64_t nonce;
+};
+
+stream_key wrap_rsa(const keystore::rsa_record& rsa, hybrid_header& header, rng::chacha20_drbg& random);
+bool unwrap_rsa(const keystore::rsa_record& rsa, const hybrid_header& header, stream_key& key);
+stream_key wrap_ec(const keystore::ec_record& ec, hybrid_header& header, rng::chacha20_drbg& random);
+bool unwrap_ec(const keystore::ec_record& ec, const hybrid_header& header, stream_key& key);
+stream_key wrap_x25519(const keystore::x25519_record& x25519, hybrid_header& header,
+                       uint8_t ephemeral[ec::X25519_SIZE], rng::chacha20_drbg& random);
+bool unwrap_x25519(const keystore::x25519_record& x25519, const hybrid_header& header,
+                   const uint8_t ephemeral[ec::X25519_SIZE], stream_key& key);
+
+uint64_t process_stream(std::istream& in, std::ostream& out, const stream_key& key, unsigned int num_threads = 0);
+
+bool encrypt(std::istream& in, std::ostream& out, const keystore::rsa_record& rsa, unsigned int num_threads = 0);
+bool encrypt(std::istream& in, std::ostream& out, const keystore::ec_record& ec, unsigned int num_threads = 0);
+bool encrypt(std::istream& in, std::ostream& out, const keystore::x25519_record& x25519,
+             unsigned int num_threads = 0);
+bool decrypt(std::istream& in, std::ostream& out, const keystore::rsa_record* rsa, const keystore::ec_record* ec,
+             const keystore::x25519_record* x25519, std::string& error, unsigned int num_threads = 0);
+
+} // namespace hybrid
+
+#endif
@@ -0,0 +1,98 @@
+// main.cpp : Encrypts and decrypts files with the keys of a keystore.
+//
+//   hybrid encrypt --keys FILE (--rsa | --ec | --x25519) [--threads N] IN OUT
+//   hybrid decrypt --keys FILE [--threads N] IN OUT
+//
+#include "hybrid.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void usage() {
+    cerr << "usage: hybrid encrypt --keys FILE (--rsa | --ec | --x25519) [--threads N] IN OUT\n"
+            "       hybrid decrypt --keys FILE [--threads N] IN OUT" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+
+    string mode = argv[1];
+    string keys_path;
+    string scheme;
+    unsigned int num_threads = 0;
+    vector<string> files;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--keys" && i + 1 < argc) {
+            keys_path = argv[++i];
+        }
+        else if (arg == "--rsa" || arg == "--ec" || arg == "--x25519") {
+            scheme = arg;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            num_threads = static_cast<unsigned int>(atoi(argv[++i]));
+        }
+        else {
+            files.push_back(arg);
+        }
+    }
+    if ((mode != "encrypt" && mode != "decrypt") || keys_path.empty() || files.size() != 2 ||
+        (mode == "encrypt" && scheme.empty())) {
+        usage();
+        return 2;
+    }
+
+    keystore::mapped_keystore store;
+    string error;
+    if (!store.open(keys_path, error)) {
+        cerr << error << endl;
+        return 1;
+    }
+
+    ifstream in(files[0], ios::binary);
+    ofstream out(files[1], ios::binary | ios::trunc);
+    if (!in || !out) {
+        cerr << "cannot open " << (!in ? files[0] : files[1]) << endl;
+        return 1;
+    }
+
+    bool ok;
+    if (mode == "encrypt") {
+        bool has_key = scheme == "--rsa" ? store.rsa() != nullptr
+                     : scheme == "--ec" ? store.ec() != nullptr
+                     : store.x25519() != nullptr;
+        if (!has_key) {
+            cerr << "the keystore has no " << scheme.substr(2) << " key" << endl;
+            return 1;
+        }
+        if (scheme == "--rsa") {
+            ok = hybrid::encrypt(in, out, *store.rsa(), num_threads);
+        }
+        else if (scheme == "--ec") {
+            ok = hybrid::encrypt(in, out, *store.ec(), num_threads);
+        }
+        else {
+            ok = hybrid::encrypt(in, out, *store.x25519(), num_threads);
+        }
+        if (!ok) {
+            error = "write failed";
+        }
+    }
+    else {
+        ok = hybrid::decrypt(in, out, store.rsa(), store.ec(), store.x25519(), error, num_threads);
+    }
+
+    if (!ok) {
+        cerr << error << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,676 @@
+// keyd.cpp : Long running key server. Loads the keys and their tables once,
+// then answers encrypt/decrypt/sign requests over a Unix domain socket.
+//
+// Every request and response is a frame:
+//
+//   u32 length      bytes that follow, big endian
+//   u32 request_id  echoed back in the response
+//   u8  scheme      1 = RSA, 2 = EC, 3 = Hill
+//   u8  op          1 = encrypt, 2 = decrypt, 3 = sign (RSA only)
+//                   in a response this byte is the status instead
+//   ...             the body
+//
+// Bodies are big endian int32 values for RSA (one per message), pairs of
+// int32 (x, y) per message point for EC encryption, four int32 (C1, C2) per
+// ciphertext for EC decryption, and letters for Hill. Responses may come
+// back in a different order than the requests were sent.
+//
+// Requests that arrive together are grouped by scheme and op and handed to
+// the batch kernels in one call, so per-request overhead is paid once per
+// batch. The server waits up to --batch-us for a batch to fill.
+//
+// Keys come either from the command line or from a keystore written by
+// keytool (--keys FILE), which is mapped and used without recomputing the
+// inverses and tables.
+//
+#include "RSA.h"
+#include "EC.h"
+#include "keystore.h"
+#include "../common/parallel.h"
+#ifdef MATH241_HAVE_HC
+#include "HC.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+enum scheme_id : uint8_t {
+    SCHEME_RSA = 1,
+    SCHEME_EC = 2,
+    SCHEME_HILL = 3
+};
+
+enum op_id : uint8_t {
+    OP_ENCRYPT = 1,
+    OP_DECRYPT = 2,
+    OP_SIGN = 3
+};
+
+enum status_id : uint8_t {
+    STATUS_OK = 0,
+    STATUS_BAD_REQUEST = 1,
+    STATUS_UNSUPPORTED = 2
+};
+
+const uint32_t MAX_FRAME = 16 << 20;
+const size_t HEADER_SIZE = 6;
+const size_t RSA_BATCH_GRAIN = 4096;
+
+/**
+ * Keys and precomputed state, loaded once at start up
+ */
+struct server_keys {
+    bool has_rsa = false;
+    int n = 0;
+    int e = 0;
+    int d = 0;
+    rsa::crt_params crt = {};
+    rsa::mont_ctx mont = {};
+
+    bool has_ec = false;
+    ec::ec_curve curve = {};
+    ec::ec_point P = {};
+    ec::keys ec_keys = {};
+
+#ifdef MATH241_HAVE_HC
+    shared_ptr<const hc::hill_key_schedule> hill;
+#endif
+};
+
+struct connection {
+    string in;
+    string out;
+    uint32_t events = EPOLLIN;  // what epoll is watching for
+    bool closing = false;       // the client closed its side
+};
+
+struct request {
+    int fd;
+    uint32_t id;
+    uint8_t scheme;
+    uint8_t op;
+    string body;
+};
+
+volatile sig_atomic_t stop_requested = 0;
+
+void handle_stop(int) {
+    stop_requested = 1;
+}
+
+uint32_t read_u32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return ntohl(v);
+}
+
+void append_u32(string& out, uint32_t v) {
+    v = htonl(v);
+    out.append(reinterpret_cast<const char*>(&v), 4);
+}
+
+/**
+ * Queue a response frame on a connection.
+ */
+void queue_response(unordered_map<int, connection>& conns, int fd, uint32_t id, uint8_t status,
+                    const string& body) {
+    auto found = conns.find(fd);
+    if (found == conns.end()) {
+        return;     // the client went away
+    }
+
+    string& out = found->second.out;
+    append_u32(out, static_cast<uint32_t>(HEADER_SIZE + body.size()));
+    append_u32(out, id);
+    out.push_back(0);
+    out.push_back(static_cast<char>(status));
+    out += body;
+}
+
+/**
+ * Run one batch of RSA requests that share an op. All values are gathered
+ * into one array, transformed in parallel and handed back per request.
+ */
+void run_rsa_batch(const server_keys& keys, vector<request*>& batch, unordered_map<int, connection>& conns) {
+    vector<int> values;
+    vector<size_t> offsets;
+    for (request* r : batch) {
+        offsets.push_back(values.size());
+        for (size_t i = 0; i < r->body.size(); i += 4) {
+            values.push_back(static_cast<int>(read_u32(r->body.data() + i)));
+        }
+    }
+    offsets.push_back(values.size());
+
+    uint8_t op = batch.front()->op;
+    vector<int> results(values.size());
+    // at least RSA_BATCH_GRAIN values per thread, so small batches stay on
+    // this one
+    parallel::for_ranges(values.size(), 0, RSA_BATCH_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            results[i] = op == OP_ENCRYPT ? rsa::mont_modexp(keys.mont, values[i], keys.e)
+                                          : rsa::rsa_decryption_crt(keys.crt, values[i]);
+        }
+    });
+
+    for (size_t r = 0; r < batch.size(); ++r) {
+        string body;
+        for (size_t i = offsets[r]; i < offsets[r + 1]; ++i) {
+            append_u32(body, static_cast<uint32_t>(results[i]));
+        }
+        queue_response(conns, batch[r]->fd, batch[r]->id, STATUS_OK, body);
+    }
+}
+
+/**
+ * Run one batch of EC ElGamal requests that share an op. Requests are
+ * answered one by one, so a request the group law still rejects fails
+ * alone.
+ */
+void run_ec_batch(const server_keys& keys, vector<request*>& batch, unordered_map<int, connection>& conns) {
+    for (request* r : batch) {
+        string body;
+        const char* p = r->body.data();
+        try {
+            if (r->op == OP_ENCRYPT) {
+                for (size_t i = 0; i < r->body.size(); i += 8) {
+                    ec::ec_point M = { static_cast<int>(read_u32(p + i)), static_cast<int>(read_u32(p + i + 4)) };
+                    ec::encrypted c = ec::encryption(keys.curve, keys.P, keys.ec_keys.pub_k.Q, M);
+                    append_u32(body, c.C1.x);
+                    append_u32(body, c.C1.y);
+                    append_u32(body, c.C2.x);
+                    append_u32(body, c.C2.y);
+                }
+            }
+            else {
+                for (size_t i = 0; i < r->body.size(); i += 16) {
+                    ec::ec_point C1 = { static_cast<int>(read_u32(p + i)), static_cast<int>(read_u32(p + i + 4)) };
+                    ec::ec_point C2 = { static_cast<int>(read_u32(p + i + 8)), static_cast<int>(read_u32(p + i + 12)) };
+                    ec::ec_point M = ec::decryption(keys.curve, C1, C2, keys.ec_keys.pr_k.d);
+                    append_u32(body, M.x);
+                    append_u32(body, M.y);
+                }
+            }
+        }
+        catch (const exception&) {
+            queue_response(conns, r->fd, r->id, STATUS_BAD_REQUEST, string());
+            continue;
+        }
+        queue_response(conns, r->fd, r->id, STATUS_OK, body);
+    }
+}
+
+#ifdef MATH241_HAVE_HC
+/**
+ * Run one batch of Hill requests that share an op. Each body is padded to
+ * whole blocks, then every body is processed in one call on the tables.
+ */
+void run_hill_batch(const server_keys& keys, vector<request*>& batch, unordered_map<int, connection>& conns) {
+    vector<int> values;
+    vector<size_t> offsets;
+    for (request* r : batch) {
+        offsets.push_back(values.size());
+        for (char c : r->body) {
+            values.push_back(c - 'A');
+        }
+        while (values.size() % 3 != 0) {
+            values.push_back(0);
+        }
+    }
+    offsets.push_back(values.size());
+
+    vector<int> results(values.size());
+    if (batch.front()->op == OP_ENCRYPT) {
+        hc::encrypt_hill_cipher(*keys.hill, values.data(), results.data(), values.size(), 0);
+    }
+    else {
+        hc::decrypt_hill_cipher(*keys.hill, values.data(), results.data(), values.size(), 0);
+    }
+
+    for (size_t r = 0; r < batch.size(); ++r) {
+        string body;
+        for (size_t i = offsets[r]; i < offsets[r + 1]; ++i) {
+            body.push_back(static_cast<char>(results[i] + 'A'));
+        }
+        queue_response(conns, batch[r]->fd, batch[r]->id, STATUS_OK, body);
+    }
+}
+#endif
+
+/**
+ * Check a request before it joins a batch.
+ *
+ * @return STATUS_OK if the batch kernels can run it, otherwise the status
+ *         to answer with
+ */
+uint8_t validate(const server_keys& keys, request& r) {
+    switch (r.scheme) {
+    case SCHEME_RSA:
+        if (!keys.has_rsa || r.op < OP_ENCRYPT || r.op > OP_SIGN) {
+            return STATUS_UNSUPPORTED;
+        }
+        if (r.op == OP_SIGN) {
+            // a textbook signature is the private key operation
+            r.op = OP_DECRYPT;
+        }
+        if (r.body.size() % 4 != 0) {
+            return STATUS_BAD_REQUEST;
+        }
+        for (size_t i = 0; i < r.body.size(); i += 4) {
+            int32_t v = static_cast<int32_t>(read_u32(r.body.data() + i));
+            if (v < 0 || v >= keys.n) {
+                return STATUS_BAD_REQUEST;
+            }
+        }
+        return STATUS_OK;
+
+    case SCHEME_EC:
+        if (!keys.has_ec || (r.op != OP_ENCRYPT && r.op != OP_DECRYPT)) {
+            return STATUS_UNSUPPORTED;
+        }
+        if (r.body.size() % (r.op == OP_ENCRYPT ? 8 : 16) != 0) {
+            return STATUS_BAD_REQUEST;
+        }
+        // every point must be on the curve, so the group law never meets a
+        // coordinate it has no inverse for
+        for (size_t i = 0; i < r.body.size(); i += 8) {
+            ec::ec_point point = { static_cast<int32_t>(read_u32(r.body.data() + i)),
+                                   static_cast<int32_t>(read_u32(r.body.data() + i + 4)) };
+            if (!ec::is_infinity(point) && !ec::on_curve(point, keys.curve)) {
+                return STATUS_BAD_REQUEST;
+            }
+        }
+        return STATUS_OK;
+
+#ifdef MATH241_HAVE_HC
+    case SCHEME_HILL:
+        if (!keys.hill || (r.op != OP_ENCRYPT && r.op != OP_DECRYPT)) {
+            return STATUS_UNSUPPORTED;
+        }
+        for (auto& c : r.body) {
+            c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+            if (c < 'A' || c > 'Z') {
+                return STATUS_BAD_REQUEST;
+            }
+        }
+        return STATUS_OK;
+#endif
+
+    default:
+        return STATUS_UNSUPPORTED;
+    }
+}
+
+/**
+ * Run one (scheme, op) group on its batch kernel.
+ */
+void run_group(const server_keys& keys, uint8_t scheme, vector<request*>& batch, unordered_map<int, connection>& conns) {
+    switch (scheme) {
+    case SCHEME_RSA:
+        run_rsa_batch(keys, batch, conns);
+        break;
+    case SCHEME_EC:
+        run_ec_batch(keys, batch, conns);
+        break;
+#ifdef MATH241_HAVE_HC
+    case SCHEME_HILL:
+        run_hill_batch(keys, batch, conns);
+        break;
+#endif
+    }
+}
+
+/**
+ * Answer every pending request, one kernel call per (scheme, op) group.
+ */
+void dispatch(const server_keys& keys, vector<request>& pending, unordered_map<int, connection>& conns) {
+    map<pair<uint8_t, uint8_t>, vector<request*>> groups;
+    for (request& r : pending) {
+        uint8_t status = validate(keys, r);
+        if (status != STATUS_OK) {
+            queue_response(conns, r.fd, r.id, status, string());
+            continue;
+        }
+        groups[make_pair(r.scheme, r.op)].push_back(&r);
+    }
+
+    for (auto& group : groups) {
+        try {
+            run_group(keys, group.first.first, group.second, conns);
+        }
+        catch (const exception&) {
+            // the batch answers nobody if one request throws, so run its
+            // requests one at a time and fail only the ones that throw alone
+            for (request* r : group.second) {
+                vector<request*> single(1, r);
+                try {
+                    run_group(keys, group.first.first, single, conns);
+                }
+                catch (const exception&) {
+                    queue_response(conns, r->fd, r->id, STATUS_BAD_REQUEST, string());
+                }
+            }
+        }
+    }
+
+    pending.clear();
+}
+
+/**
+ * Cut every complete frame off the front of a connection's input.
+ */
+void parse_frames(int fd, connection& conn, vector<request>& pending, bool& failed) {
+    size_t pos = 0;
+    while (conn.in.size() - pos >= 4) {
+        uint32_t length = read_u32(conn.in.data() + pos);
+        if (length < HEADER_SIZE || length > MAX_FRAME) {
+            failed = true;
+            return;
+        }
+        if (conn.in.size() - pos - 4 < length) {
+            break;
+        }
+
+        const char* frame = conn.in.data() + pos + 4;
+        request r;
+        r.fd = fd;
+        r.id = read_u32(frame);
+        r.scheme = static_cast<uint8_t>(frame[4]);
+        r.op = static_cast<uint8_t>(frame[5]);
+        r.body.assign(frame + HEADER_SIZE, length - HEADER_SIZE);
+        pending.push_back(move(r));
+
+        pos += 4 + length;
+    }
+    conn.in.erase(0, pos);
+}
+
+/**
+ * Point epoll at what the connection needs next: input until the client
+ * closes its side, output while some is queued.
+ */
+void update_events(int epfd, int fd, connection& conn) {
+    uint32_t events = (conn.closing ? 0u : uint32_t(EPOLLIN)) | (conn.out.empty() ? 0u : uint32_t(EPOLLOUT));
+    if (events != conn.events) {
+        epoll_event ev = {};
+        ev.events = events;
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+        conn.events = events;
+    }
+}
+
+/**
+ * Write as much queued output as the socket takes.
+ *
+ * @return false if the connection failed
+ */
+bool flush(int epfd, int fd, connection& conn) {
+    while (!conn.out.empty()) {
+        ssize_t written = send(fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        conn.out.erase(0, static_cast<size_t>(written));
+    }
+
+    update_events(epfd, fd, conn);
+    return true;
+}
+
+/**
+ * Close a connection and drop the requests it still has pending. Requests
+ * only carry the fd, and accept can hand the same number to the next
+ * client before the batch runs, which would then get these answers.
+ */
+void close_connection(int epfd, int fd, unordered_map<int, connection>& conns, vector<request>& pending) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    conns.erase(fd);
+    pending.erase(remove_if(pending.begin(), pending.end(), [fd](const request& r) { return r.fd == fd; }),
+                  pending.end());
+}
+
+void usage() {
+    cerr << "usage: keyd --socket PATH [--keys FILE] [--rsa P Q] [--ec A B P X Y] [--hill KEY]\n"
+            "            [--batch-us US] [--max-batch N]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    string socket_path;
+    server_keys keys;
+    keystore::mapped_keystore store;
+    int batch_us = 200;
+    size_t max_batch = 1024;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        }
+        else if (arg == "--keys" && i + 1 < argc) {
+            string error;
+            if (!store.open(argv[++i], error)) {
+                cerr << error << endl;
+                return 1;
+            }
+            if (const keystore::rsa_record* r = store.rsa()) {
+                keys.has_rsa = true;
+                keys.n = r->n;
+                keys.e = r->e;
+                keys.d = r->d;
+                keys.crt = r->crt;
+                keys.mont = r->mont;
+            }
+            if (const keystore::ec_record* r = store.ec()) {
+                keys.has_ec = true;
+                keys.curve = r->curve;
+                keys.P = r->P;
+                keys.ec_keys = r->keys;
+            }
+#ifdef MATH241_HAVE_HC
+            if (const keystore::hill_record* r = store.hill()) {
+                keys.hill = make_shared<const hc::hill_key_schedule>(keystore::load_hill_schedule(*r));
+            }
+#endif
+        }
+        else if (arg == "--rsa" && i + 2 < argc) {
+            int p = atoi(argv[++i]);
+            int q = atoi(argv[++i]);
+            rsa::keys k = rsa::generate_keys(p, q);
+            keys.has_rsa = true;
+            keys.n = get<0>(k.public_key);
+            keys.e = get<1>(k.public_key);
+            keys.d = k.private_key;
+            keys.crt = rsa::make_crt_params(p, q, keys.d);
+            keys.mont = rsa::mont_init(keys.n);
+        }
+        else if (arg == "--ec" && i + 5 < argc) {
+            keys.curve.a = atoi(argv[++i]);
+            keys.curve.b = atoi(argv[++i]);
+            keys.curve.p = atoi(argv[++i]);
+            keys.P.x = atoi(argv[++i]);
+            keys.P.y = atoi(argv[++i]);
+            keys.ec_keys = ec::generate_keys(keys.curve, keys.P);
+            keys.has_ec = true;
+        }
+#ifdef MATH241_HAVE_HC
+        else if (arg == "--hill" && i + 1 < argc) {
+            hc::hill_key_cache cache(1);
+            keys.hill = cache.get(argv[++i]);
+            if (!keys.hill) {
+                cerr << "Hill key does not have an inverse" << endl;
+                return 1;
+            }
+        }
+#endif
+        else if (arg == "--batch-us" && i + 1 < argc) {
+            batch_us = atoi(argv[++i]);
+        }
+        else if (arg == "--max-batch" && i + 1 < argc) {
+            max_batch = max(1, atoi(argv[++i]));
+        }
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (socket_path.empty()) {
+        usage();
+        return 2;
+    }
+    if (keys.has_rsa && keys.n % 2 == 0) {
+        cerr << "RSA modulus must be odd" << endl;
+        return 1;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (listen_fd < 0 || socket_path.size() >= sizeof(addr.sun_path)) {
+        cerr << "cannot create socket" << endl;
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path.c_str());
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd, 128) < 0) {
+        cerr << "cannot listen on " << socket_path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev);
+
+    unordered_map<int, connection> conns;
+    vector<request> pending;
+    auto batch_start = chrono::steady_clock::now();
+    vector<epoll_event> events(256);
+
+    while (!stop_requested) {
+        // block while idle; while a batch is filling, wait only for the rest
+        // of its window
+        int timeout = -1;
+        if (!pending.empty()) {
+            auto waited = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - batch_start);
+            long long left_us = batch_us - waited.count();
+            timeout = left_us > 0 ? static_cast<int>((left_us + 999) / 1000) : 0;
+        }
+
+        int ready = epoll_wait(epfd, events.data(), static_cast<int>(events.size()), timeout);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == listen_fd) {
+                int client;
+                while ((client = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    epoll_event cev = {};
+                    cev.events = EPOLLIN;
+                    cev.data.fd = client;
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, client, &cev);
+                    conns[client];
+                }
+                continue;
+            }
+
+            auto found = conns.find(fd);
+            if (found == conns.end()) {
+                continue;
+            }
+            connection& conn = found->second;
+
+            bool failed = (events[i].events & EPOLLERR) != 0;
+            if (events[i].events & (EPOLLIN | EPOLLHUP)) {
+                char buffer[65536];
+                while (!conn.closing) {
+                    ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+                    if (got > 0) {
+                        conn.in.append(buffer, static_cast<size_t>(got));
+                    }
+                    else if (got == 0) {
+                        conn.closing = true;
+                    }
+                    else {
+                        failed = errno != EAGAIN && errno != EWOULDBLOCK;
+                        break;
+                    }
+                }
+
+                size_t before = pending.size();
+                parse_frames(fd, conn, pending, failed);
+                if (before == 0 && !pending.empty()) {
+                    batch_start = chrono::steady_clock::now();
+                }
+            }
+
+            if (!failed) {
+                failed = !flush(epfd, fd, conn);
+            }
+
+            // a client that closed its side still gets the answers to the
+            // requests it already sent
+            bool waiting = any_of(pending.begin(), pending.end(), [fd](const request& r) { return r.fd == fd; });
+            if (failed || (conn.closing && conn.out.empty() && !waiting)) {
+                close_connection(epfd, fd, conns, pending);
+            }
+        }
+
+        auto waited = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - batch_start);
+        if (!pending.empty() && (pending.size() >= max_batch || waited.count() >= batch_us)) {
+            dispatch(keys, pending, conns);
+
+            vector<int> done;
+            for (auto& entry : conns) {
+                bool ok = flush(epfd, entry.first, entry.second);
+                if (!ok || (entry.second.closing && entry.second.out.empty())) {
+                    done.push_back(entry.first);
+                }
+            }
+            for (int fd : done) {
+                close_connection(epfd, fd, conns, pending);
+            }
+        }
+    }
+
+    for (auto& entry : conns) {
+        close(entry.first);
+    }
+    close(listen_fd);
+    close(epfd);
+    unlink(socket_path.c_str());
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+// keystore.cpp : Writing and mapping the binary key file.
+//
+#include "keystore.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef MAP_POPULATE
+#define MAP_POPULATE 0
+#endif
+#endif
+
+using namespace std;
+
+namespace keystore {
+
+/**
+ * Builds an RSA record with every precomputed value filled in.
+ *
+ * @param p The first prime.
+ * @param q The second prime.
+ * @param e The public exponent.
+ * @param d The private exponent.
+ * @return The record.
+ */
+rsa_record make_rsa_record(int p, int q, int e, int d) {
+    rsa_record record;
+    memset(&record, 0, sizeof(record));
+
+    record.n = p * q;
+    record.e = e;
+    record.d = d;
+    record.crt = rsa::make_crt_params(p, q, d);
+    record.mont = rsa::mont_init(record.n);
+
+    return record;
+}
+
+/**
+ * Builds an EC record with the fixed-base table of P.
+ *
+ * @param curve Parameters of the elliptic curve.
+ * @param P The base point.
+ * @param keys The key pair generated for P.
+ * @return The record.
+ */
+ec_record make_ec_record(ec::ec_curve curve, ec::ec_point P, ec::keys keys) {
+    ec_record record;
+    memset(&record, 0, sizeof(record));
+
+    record.curve = curve;
+    record.P = P;
+    record.keys = keys;
+    // entries past bit_length(n - 1) would never be used
+    int size = ec::fixed_base_table_size(P, curve);
+    record.table_size = ec::build_fixed_base_table(P, curve, record.table,
+                                                   size > 0 && size < EC_TABLE_SIZE ? size : EC_TABLE_SIZE);
+
+    return record;
+}
+
+#ifdef MATH241_HAVE_HC
+/**
+ * Copies a Hill key schedule into a record.
+ *
+ * @param schedule The validated key schedule.
+ * @return The record.
+ */
+hill_record make_hill_record(const hc::hill_key_schedule& schedule) {
+    hill_record record;
+    memset(&record, 0, sizeof(record));
+
+    memcpy(record.key_string, schedule.key_string.data(), min(schedule.key_string.size(), size_t(9)));
+    for (int i = 0; i < 9; ++i) {
+        record.key[i] = schedule.key(i / 3, i % 3);
+        record.inverse_key[i] = schedule.inverse_key(i / 3, i % 3);
+    }
+    memcpy(record.encrypt_table, schedule.encrypt_table.col, sizeof(record.encrypt_table));
+    memcpy(record.decrypt_table, schedule.decrypt_table.col, sizeof(record.decrypt_table));
+
+    return record;
+}
+
+/**
+ * Rebuilds a Hill key schedule from a record without inverting anything.
+ *
+ * @param record The stored record.
+ * @return The key schedule.
+ */
+hc::hill_key_schedule load_hill_schedule(const hill_record& record) {
+    hc::hill_key_schedule schedule;
+
+    schedule.key_string.assign(record.key_string, strnlen(record.key_string, sizeof(record.key_string)));
+    schedule.key.set_size(3, 3);
+    schedule.inverse_key.set_size(3, 3);
+    for (int i = 0; i < 9; ++i) {
+        schedule.key(i / 3, i % 3) = record.key[i];
+        schedule.inverse_key(i / 3, i % 3) = record.inverse_key[i];
+    }
+    memcpy(schedule.encrypt_table.col, record.encrypt_table, sizeof(record.encrypt_table));
+    memcpy(schedule.decrypt_table.col, record.decrypt_table, sizeof(record.decrypt_table));
+
+    return schedule;
+}
+#endif
+
+/**
+ * Writes a keystore holding whichever records are given.
+ *
+ * @param path Where to write the file.
+ * @param rsa The RSA record, or nullptr.
+ * @param ec The EC record, or nullptr.
+ * @param hill The Hill record, or nullptr.
+ * @param x25519 The X25519 record, or nullptr.
+ * @return True on success.
+ */
+bool write_keystore(const string& path, const rsa_record* rsa, const ec_record* ec, const hill_record* hill,
+                    const x25519_record* x25519) {
+    struct pending_section {
+        uint32_t type;
+        const void* data;
+        uint32_t size;
+    };
+    vector<pending_section> sections;
+    if (rsa) {
+        sections.push_back({ SECTION_RSA, rsa, sizeof(rsa_record) });
+    }
+    if (ec) {
+        sections.push_back({ SECTION_EC, ec, sizeof(ec_record) });
+    }
+    if (hill) {
+        sections.push_back({ SECTION_HILL, hill, sizeof(hill_record) });
+    }
+    if (x25519) {
+        sections.push_back({ SECTION_X25519, x25519, sizeof(x25519_record) });
+    }
+
+    auto align = [](uint64_t offset) { return (offset + KEYSTORE_ALIGN - 1) / KEYSTORE_ALIGN * KEYSTORE_ALIGN; };
+
+    vector<keystore_section> directory;
+    uint64_t offset = align(sizeof(keystore_header) + sections.size() * sizeof(keystore_section));
+    for (const auto& section : sections) {
+        keystore_section entry = { section.type, section.size, offset };
+        directory.push_back(entry);
+        offset = align(offset + section.size);
+    }
+
+    vector<char> image(offset, 0);
+
+    keystore_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KEYSTORE_MAGIC, sizeof(header.magic));
+    header.version = KEYSTORE_VERSION;
+    header.endian = KEYSTORE_ENDIAN;
+    header.section_count = static_cast<uint32_t>(sections.size());
+    header.file_size = offset;
+    memcpy(image.data(), &header, sizeof(header));
+
+    for (size_t i = 0; i < sections.size(); ++i) {
+        memcpy(image.data() + sizeof(header) + i * sizeof(keystore_section), &directory[i], sizeof(keystore_section));
+        memcpy(image.data() + directory[i].offset, sections[i].data, sections[i].size);
+    }
+
+    // write to a temporary name and rename, so readers never see half a file
+    string temp = path + ".tmp";
+    ofstream out(temp, ios::binary | ios::trunc);
+    out.write(image.data(), static_cast<streamsize>(image.size()));
+    out.close();
+    if (!out) {
+        remove(temp.c_str());
+        return false;
+    }
+    remove(path.c_str());
+    return rename(temp.c_str(), path.c_str()) == 0;
+}
+
+mapped_keystore::~mapped_keystore() {
+    close();
+}
+
+/**
+ * Releases the mapping. The record pointers become null.
+ */
+void mapped_keystore::close() {
+    if (base) {
+#ifdef _WIN32
+        _aligned_free(base);
+#else
+        munmap(base, length);
+#endif
+    }
+    base = nullptr;
+    length = 0;
+    rsa_key = nullptr;
+    ec_key = nullptr;
+    hill_key = nullptr;
+    x25519_key = nullptr;
+}
+
+/**
+ * Maps a keystore and checks its header, directory and section bounds.
+ *
+ * @param path The keystore file.
+ * @param error Set to the reason when the file is rejected.
+ * @return True if the file was mapped and is usable.
+ */
+bool mapped_keystore::open(const string& path, string& error) {
+    close();
+
+#ifdef _WIN32
+    // no mmap; read into an aligned buffer instead
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    length = static_cast<size_t>(in.tellg());
+    base = _aligned_malloc(length ? length : 1, KEYSTORE_ALIGN);
+    in.seekg(0);
+    in.read(static_cast<char*>(base), static_cast<streamsize>(length));
+    if (!in) {
+        error = "cannot read " + path;
+        close();
+        return false;
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(keystore_header))) {
+        ::close(fd);
+        error = "file is too small to be a keystore";
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "cannot map " + path;
+        length = 0;
+        return false;
+    }
+    base = mapped;
+#endif
+
+    const char* bytes = static_cast<const char*>(base);
+    const keystore_header* header = reinterpret_cast<const keystore_header*>(bytes);
+
+    if (length < sizeof(keystore_header) || memcmp(header->magic, KEYSTORE_MAGIC, sizeof(header->magic)) != 0) {
+        error = "not a keystore file";
+    }
+    else if (header->endian != KEYSTORE_ENDIAN) {
+        error = "keystore was written on a machine with a different byte order";
+    }
+    else if (header->version != KEYSTORE_VERSION) {
+        error = "unsupported keystore version " + to_string(header->version);
+    }
+    else if (header->file_size != length ||
+             sizeof(keystore_header) + uint64_t(header->section_count) * sizeof(keystore_section) > length) {
+        error = "keystore is truncated";
+    }
+
+    const keystore_section* directory = reinterpret_cast<const keystore_section*>(bytes + sizeof(keystore_header));
+    for (uint32_t i = 0; error.empty() && i < header->section_count; ++i) {
+        const keystore_section& section = directory[i];
+        // compared without adding, so a huge offset cannot wrap into range
+        if (section.offset % KEYSTORE_ALIGN != 0 || section.offset > length ||
+            section.record_size > length - section.offset) {
+            error = "keystore section out of bounds";
+            break;
+        }
+
+        const void* record = bytes + section.offset;
+        switch (section.type) {
+        case SECTION_RSA:
+            if (section.record_size == sizeof(rsa_record)) {
+                rsa_key = static_cast<const rsa_record*>(record);
+            }
+            break;
+        case SECTION_EC:
+            if (section.record_size == sizeof(ec_record)) {
+                const ec_record* ec = static_cast<const ec_record*>(record);
+                // fixed_base_mult reads this many table entries
+                if (ec->table_size < 0 || ec->table_size > EC_TABLE_SIZE) {
+                    error = "EC fixed-base table size out of range";
+                    break;
+                }
+                ec_key = ec;
+            }
+            break;
+        case SECTION_HILL:
+            if (section.record_size == sizeof(hill_record)) {
+                hill_key = static_cast<const hill_record*>(record);
+            }
+            break;
+        case SECTION_X25519:
+            if (section.record_size == sizeof(x25519_record)) {
+                x25519_key = static_cast<const x25519_record*>(record);
+            }
+            break;
+        default:
+            // sections from newer writers are skipped
+            break;
+        }
+    }
+
+    if (!error.empty()) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace keystore
@@ -0,0 +1,141 @@
+#ifndef KEYSTORE_H
+#define KEYSTORE_H
+// Versioned binary key file. The file is a header, a section directory and
+// 64-byte aligned sections holding fixed-layout records, so a mapped file
+// is used in place: opening it checks the header and bounds, nothing is
+// parsed or recomputed.
+//
+//   offset 0    keystore_header
+//   offset 64   keystore_section[section_count]
+//   ...         records, each at a multiple of 64
+//
+// All fields are in the byte order of the machine that wrote the file; the
+// endian marker lets a reader on another byte order reject it.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "RSA.h"
+#include "EC.h"
+#include "x25519.h"
+#ifdef MATH241_HAVE_HC
+#include "HC.h"
+#endif
+
+namespace keystore {
+
+const char KEYSTORE_MAGIC[8] = { 'M', '2', '4', '1', 'K', 'E', 'Y', 'S' };
+const uint32_t KEYSTORE_VERSION = 1;
+const uint32_t KEYSTORE_ENDIAN = 0x01020304;
+const uint64_t KEYSTORE_ALIGN = 64;
+const int EC_TABLE_SIZE = 32;
+
+enum section_type : uint32_t {
+    SECTION_RSA = 1,
+    SECTION_EC = 2,
+    SECTION_HILL = 3,
+    SECTION_X25519 = 4
+};
+
+struct keystore_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t section_count;
+    uint32_t reserved;
+    uint64_t file_size;
+    uint8_t padding[32];
+};
+
+struct keystore_section {
+    uint32_t type;
+    uint32_t record_size;
+    uint64_t offset;
+};
+
+/**
+ * RSA key with its Montgomery constants and CRT parameters
+ */
+struct rsa_record {
+    int32_t n;
+    int32_t e;
+    int32_t d;
+    rsa::crt_params crt;
+    rsa::mont_ctx mont;
+};
+
+/**
+ * EC key pair with its curve and the fixed-base table of the base point,
+ * table[i] = 2^i P
+ */
+struct ec_record {
+    ec::ec_curve curve;
+    ec::ec_point P;
+    ec::keys keys;
+    int32_t table_size;
+    ec::ec_point table[EC_TABLE_SIZE];
+};
+
+/**
+ * X25519 key pair
+ */
+struct x25519_record {
+    ec::x25519_keys keys;
+};
+
+/**
+ * Hill key with its inverse and the column product tables, laid out like
+ * hc::hill_key_schedule so the tables can be copied over directly
+ */
+struct hill_record {
+    char key_string[12];            // 9 letters, zero padded
+    int32_t key[9];                 // row by row
+    int32_t inverse_key[9];
+    uint8_t encrypt_table[3][26][4];
+    uint8_t decrypt_table[3][26][4];
+};
+
+static_assert(sizeof(keystore_header) == 64, "keystore_header must stay 64 bytes");
+static_assert(sizeof(keystore_section) == 16, "keystore_section must stay 16 bytes");
+
+rsa_record make_rsa_record(int p, int q, int e, int d);
+ec_record make_ec_record(ec::ec_curve curve, ec::ec_point P, ec::keys keys);
+
+#ifdef MATH241_HAVE_HC
+hill_record make_hill_record(const hc::hill_key_schedule& schedule);
+hc::hill_key_schedule load_hill_schedule(const hill_record& record);
+#endif
+
+bool write_keystore(const std::string& path, const rsa_record* rsa, const ec_record* ec,
+                    const hill_record* hill, const x25519_record* x25519 = nullptr);
+
+/**
+ * A keystore file mapped read-only into memory. The record pointers stay
+ * valid until the object is destroyed.
+ */
+class mapped_keystore {
+public:
+    mapped_keystore() = default;
+    ~mapped_keystore();
+    mapped_keystore(const mapped_keystore&) = delete;
+    mapped_keystore& operator=(const mapped_keystore&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const rsa_record* rsa() const { return rsa_key; }
+    const ec_record* ec() const { return ec_key; }
+    const hill_record* hill() const { return hill_key; }
+    const x25519_record* x25519() const { return x25519_key; }
+
+private:
+    void* base = nullptr;
+    size_t length = 0;
+    const rsa_record* rsa_key = nullptr;
+    const ec_record* ec_key = nullptr;
+    const hill_record* hill_key = nullptr;
+    const x25519_record* x25519_key = nullptr;
+};
+
+} // namespace keystore
+
+#endif
@@ -0,0 +1,138 @@
+// keytool.cpp : Creates and inspects keystore files.
+//
+//   keytool create FILE [--seed N] [--rsa P Q] [--ec A B P X Y] [--hill KEY]
+//                       [--x25519]
+//   keytool show FILE
+//
+#include "keystore.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+void usage() {
+    cerr << "usage: keytool create FILE [--seed N] [--rsa P Q] [--ec A B P X Y] [--hill KEY] [--x25519]\n"
+            "       keytool show FILE" << endl;
+}
+
+int create(int argc, char* argv[]) {
+    string path = argv[2];
+    keystore::rsa_record rsa_key;
+    keystore::ec_record ec_key;
+    keystore::hill_record hill_key;
+    keystore::x25519_record x25519_key;
+    bool has_rsa = false;
+    bool has_ec = false;
+    bool has_hill = false;
+    bool has_x25519 = false;
+
+    for (int i = 3; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            // reproducible keys, e.g. for fixtures
+            rng::set_seed(strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--rsa" && i + 2 < argc) {
+            int p = atoi(argv[++i]);
+            int q = atoi(argv[++i]);
+            if (p * q % 2 == 0) {
+                cerr << "RSA primes must be odd" << endl;
+                return 1;
+            }
+            rsa::keys k = rsa::generate_keys(p, q);
+            rsa_key = keystore::make_rsa_record(p, q, get<1>(k.public_key), k.private_key);
+            has_rsa = true;
+        }
+        else if (arg == "--ec" && i + 5 < argc) {
+            ec::ec_curve curve;
+            curve.a = atoi(argv[++i]);
+            curve.b = atoi(argv[++i]);
+            curve.p = atoi(argv[++i]);
+            ec::ec_point P;
+            P.x = atoi(argv[++i]);
+            P.y = atoi(argv[++i]);
+            ec_key = keystore::make_ec_record(curve, P, ec::generate_keys(curve, P));
+            has_ec = true;
+        }
+        else if (arg == "--x25519") {
+            x25519_key.keys = ec::x25519_generate_keys();
+            has_x25519 = true;
+        }
+#ifdef MATH241_HAVE_HC
+        else if (arg == "--hill" && i + 1 < argc) {
+            hc::hill_key_cache cache(1);
+            shared_ptr<const hc::hill_key_schedule> schedule = cache.get(argv[++i]);
+            if (!schedule) {
+                cerr << "Hill key does not have an inverse" << endl;
+                return 1;
+            }
+            hill_key = keystore::make_hill_record(*schedule);
+            has_hill = true;
+        }
+#endif
+        else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (!keystore::write_keystore(path, has_rsa ? &rsa_key : nullptr, has_ec ? &ec_key : nullptr,
+                                  has_hill ? &hill_key : nullptr, has_x25519 ? &x25519_key : nullptr)) {
+        cerr << "cannot write " << path << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int show(const string& path) {
+    keystore::mapped_keystore store;
+    string error;
+    if (!store.open(path, error)) {
+        cerr << error << endl;
+        return 1;
+    }
+
+    if (const keystore::rsa_record* r = store.rsa()) {
+        cout << "RSA: n = " << r->n << ", e = " << r->e << ", d = " << r->d << endl;
+        cout << "     p = " << r->crt.p << ", q = " << r->crt.q << ", dP = " << r->crt.dP
+             << ", dQ = " << r->crt.dQ << ", qInv = " << r->crt.qInv << endl;
+    }
+    if (const keystore::ec_record* r = store.ec()) {
+        cout << "EC: y^2 = x^3 + " << r->curve.a << "x + " << r->curve.b << " (mod " << r->curve.p << ")" << endl;
+        cout << "    P = (" << r->P.x << ", " << r->P.y << "), Q = (" << r->keys.pub_k.Q.x << ", "
+             << r->keys.pub_k.Q.y << "), d = " << r->keys.pr_k.d << endl;
+        cout << "    fixed-base table: " << r->table_size << " points" << endl;
+    }
+    if (const keystore::hill_record* r = store.hill()) {
+        cout << "Hill: key = " << r->key_string << ", inverse =";
+        for (int i = 0; i < 9; ++i) {
+            cout << " " << r->inverse_key[i];
+        }
+        cout << endl;
+    }
+    if (const keystore::x25519_record* r = store.x25519()) {
+        cout << "X25519: public key = " << hex << setfill('0');
+        for (uint8_t byte : r->keys.public_key) {
+            cout << setw(2) << static_cast<int>(byte);
+        }
+        cout << dec << endl;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 3 && string(argv[1]) == "create") {
+        return create(argc, argv);
+    }
+    if (argc == 3 && string(argv[1]) == "show") {
+        return show(argv[2]);
+    }
+
+    usage();
+    return 2;
+}
@@ -0,0 +1,510 @@
+// bigint.cpp : Arithmetic on arbitrary-size non-negative integers.
+//
+#include "bigint.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace mp {
+
+// The largest power of ten in a limb, for decimal conversion
+const limb DECIMAL_BASE = 10000000000000000000ULL;
+const int DECIMAL_DIGITS = 19;
+
+// Divisors of at least this many limbs are divided by Barrett reduction
+// with a Newton reciprocal instead of long division
+const size_t NEWTON_THRESHOLD = 1024;
+
+/**
+ * Drops leading zero limbs so every value has one representation.
+ */
+void trim(vector<limb>& limbs) {
+    while (!limbs.empty() && limbs.back() == 0) {
+        limbs.pop_back();
+    }
+}
+
+/**
+ * a = a * m + add, in place.
+ */
+void mul_add_small(vector<limb>& a, limb m, limb add) {
+    limb carry = add;
+    for (limb& v : a) {
+        limb hi;
+        limb lo = mul_wide(v, m, hi);
+        v = lo + carry;
+        carry = hi + (v < lo);
+    }
+    if (carry != 0) {
+        a.push_back(carry);
+    }
+}
+
+/**
+ * a = a / d, in place.
+ *
+ * @return the remainder
+ */
+limb div_small(vector<limb>& a, limb d) {
+    limb rem = 0;
+    for (size_t i = a.size(); i-- > 0;) {
+        a[i] = div_wide(rem, a[i], d, rem);
+    }
+    trim(a);
+    return rem;
+}
+
+bigint from_u64(uint64_t v) {
+    bigint r;
+    if (v != 0) {
+        r.limbs.push_back(v);
+    }
+    return r;
+}
+
+/**
+ * Parses a decimal number.
+ *
+ * @param text digits only, no sign or spaces
+ * @param out set to the value
+ * @return false if the text is empty or not all digits
+ */
+bool from_decimal(const string& text, bigint& out) {
+    if (text.empty()) {
+        return false;
+    }
+
+    vector<limb> limbs;
+    size_t first = text.size() % DECIMAL_DIGITS;
+    if (first == 0) {
+        first = DECIMAL_DIGITS;
+    }
+    for (size_t pos = 0; pos < text.size(); pos = pos == 0 ? first : pos + DECIMAL_DIGITS) {
+        size_t end = pos == 0 ? first : pos + DECIMAL_DIGITS;
+        limb chunk = 0;
+        limb scale = 1;
+        for (size_t i = pos; i < end; ++i) {
+            if (text[i] < '0' || text[i] > '9') {
+                return false;
+            }
+            chunk = chunk * 10 + static_cast<limb>(text[i] - '0');
+            scale *= 10;
+        }
+        mul_add_small(limbs, scale, chunk);
+    }
+    trim(limbs);
+    out.limbs = limbs;
+    return true;
+}
+
+string to_decimal(const bigint& a) {
+    if (a.limbs.empty()) {
+        return "0";
+    }
+
+    vector<limb> rest = a.limbs;
+    vector<limb> chunks;
+    while (!rest.empty()) {
+        chunks.push_back(div_small(rest, DECIMAL_BASE));
+    }
+
+    string text = to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        string part = to_string(chunks[i]);
+        text.append(DECIMAL_DIGITS - part.size(), '0');
+        text += part;
+    }
+    return text;
+}
+
+bool is_zero(const bigint& a) {
+    return a.limbs.empty();
+}
+
+bool fits_u64(const bigint& a) {
+    return a.limbs.size() <= 1;
+}
+
+/**
+ * @return the low 64 bits of a
+ */
+uint64_t to_u64(const bigint& a) {
+    return a.limbs.empty() ? 0 : a.limbs[0];
+}
+
+size_t bit_length(const bigint& a) {
+    if (a.limbs.empty()) {
+        return 0;
+    }
+    return 64 * a.limbs.size() - static_cast<size_t>(leading_zeros(a.limbs.back()));
+}
+
+/**
+ * @return -1, 0 or 1 as a is less than, equal to or greater than b
+ */
+int compare(const bigint& a, const bigint& b) {
+    if (a.limbs.size() != b.limbs.size()) {
+        return a.limbs.size() < b.limbs.size() ? -1 : 1;
+    }
+    for (size_t i = a.limbs.size(); i-- > 0;) {
+        if (a.limbs[i] != b.limbs[i]) {
+            return a.limbs[i] < b.limbs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+bigint add(const bigint& a, const bigint& b) {
+    const vector<limb>& longer = a.limbs.size() >= b.limbs.size() ? a.limbs : b.limbs;
+    const vector<limb>& shorter = a.limbs.size() >= b.limbs.size() ? b.limbs : a.limbs;
+
+    bigint r;
+    r.limbs.resize(longer.size() + 1);
+    limb carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        r.limbs[i] = add_carry(longer[i], i < shorter.size() ? shorter[i] : 0, carry);
+    }
+    r.limbs[longer.size()] = carry;
+    trim(r.limbs);
+    return r;
+}
+
+/**
+ * @return a - b
+ * @throws std::invalid_argument if b > a
+ */
+bigint sub(const bigint& a, const bigint& b) {
+    if (compare(a, b) < 0) {
+        throw invalid_argument("bigint subtraction would go negative");
+    }
+
+    bigint r;
+    r.limbs.resize(a.limbs.size());
+    limb borrow = 0;
+    for (size_t i = 0; i < a.limbs.size(); ++i) {
+        r.limbs[i] = sub_borrow(a.limbs[i], i < b.limbs.size() ? b.limbs[i] : 0, borrow);
+    }
+    trim(r.limbs);
+    return r;
+}
+
+bigint shift_left(const bigint& a, size_t bits) {
+    bigint r;
+    if (a.limbs.empty()) {
+        return r;
+    }
+
+    size_t limb_shift = bits / 64;
+    int bit_shift = static_cast<int>(bits % 64);
+    r.limbs.assign(a.limbs.size() + limb_shift + 1, 0);
+    for (size_t i = 0; i < a.limbs.size(); ++i) {
+        r.limbs[i + limb_shift] |= a.limbs[i] << bit_shift;
+        if (bit_shift != 0) {
+            r.limbs[i + limb_shift + 1] = a.limbs[i] >> (64 - bit_shift);
+        }
+    }
+    trim(r.limbs);
+    return r;
+}
+
+bigint shift_right(const bigint& a, size_t bits) {
+    bigint r;
+    size_t limb_shift = bits / 64;
+    if (limb_shift >= a.limbs.size()) {
+        return r;
+    }
+
+    int bit_shift = static_cast<int>(bits % 64);
+    r.limbs.assign(a.limbs.size() - limb_shift, 0);
+    for (size_t i = 0; i < r.limbs.size(); ++i) {
+        r.limbs[i] = a.limbs[i + limb_shift] >> bit_shift;
+        if (bit_shift != 0 && i + limb_shift + 1 < a.limbs.size()) {
+            r.limbs[i] |= a.limbs[i + limb_shift + 1] << (64 - bit_shift);
+        }
+    }
+    trim(r.limbs);
+    return r;
+}
+
+/**
+ * Long division (Knuth, TAOCP vol. 2, algorithm D). The divisor is shifted
+ * so its top limb has the high bit set, which keeps each estimated quotient
+ * limb at most two above the true one. O(|q| |b|) limb products.
+ */
+void divmod_long(const bigint& a, const bigint& b, bigint& quotient, bigint& remainder) {
+    if (compare(a, b) < 0) {
+        quotient.limbs.clear();
+        remainder = a;
+        return;
+    }
+    if (b.limbs.size() == 1) {
+        vector<limb> q = a.limbs;
+        limb r = div_small(q, b.limbs[0]);
+        quotient.limbs = q;
+        remainder = from_u64(r);
+        return;
+    }
+
+    int shift = leading_zeros(b.limbs.back());
+    vector<limb> v = shift_left(b, static_cast<size_t>(shift)).limbs;
+    vector<limb> u = shift_left(a, static_cast<size_t>(shift)).limbs;
+    u.resize(a.limbs.size() + 1, 0);
+
+    size_t n = v.size();
+    size_t m = u.size() - n;
+    vector<limb> q(m, 0);
+    limb top = v[n - 1];
+    limb second = v[n - 2];
+
+    for (size_t j = m; j-- > 0;) {
+        // estimate the quotient limb from the top two limbs of u
+        limb q_hat;
+        limb r_hat;
+        bool r_hat_overflow = false;
+        if (u[j + n] >= top) {
+            q_hat = ~limb(0);
+            r_hat = u[j + n - 1] + top;
+            r_hat_overflow = r_hat < top;
+        }
+        else {
+            q_hat = div_wide(u[j + n], u[j + n - 1], top, r_hat);
+        }
+        while (!r_hat_overflow) {
+            limb hi;
+            limb lo = mul_wide(q_hat, second, hi);
+            if (hi < r_hat || (hi == r_hat && lo <= u[j + n - 2])) {
+                break;
+            }
+            --q_hat;
+            r_hat += top;
+            r_hat_overflow = r_hat < top;
+        }
+
+        // u[j..j+n] -= q_hat v
+        limb mul_carry = 0;
+        limb borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            limb hi;
+            limb lo = mul_wide(q_hat, v[i], hi);
+            lo += mul_carry;
+            hi += lo < mul_carry;
+            mul_carry = hi;
+            u[i + j] = sub_borrow(u[i + j], lo, borrow);
+        }
+        u[j + n] = sub_borrow(u[j + n], mul_carry, borrow);
+
+        if (borrow != 0) {
+            // q_hat was one too large; add v back
+            --q_hat;
+            limb carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                u[i + j] = add_carry(u[i + j], v[i], carry);
+            }
+            u[j + n] += carry;
+        }
+        q[j] = q_hat;
+    }
+
+    trim(q);
+    quotient.limbs = q;
+    u.resize(n);
+    trim(u);
+    bigint shifted;
+    shifted.limbs = u;
+    remainder = shift_right(shifted, static_cast<size_t>(shift));
+}
+
+bigint power_of_two(size_t bits) {
+    bigint r;
+    r.limbs.assign(bits / 64 + 1, 0);
+    r.limbs.back() = limb(1) << (bits % 64);
+    return r;
+}
+
+/**
+ * @return a mod 2^bits
+ */
+bigint low_bits(const bigint& a, size_t bits) {
+    bigint r;
+    size_t whole = bits / 64;
+    if (whole >= a.limbs.size()) {
+        return a;
+    }
+    r.limbs.assign(a.limbs.begin(), a.limbs.begin() + static_cast<ptrdiff_t>(whole));
+    if (bits % 64 != 0) {
+        r.limbs.push_back(a.limbs[whole] & ((limb(1) << (bits % 64)) - 1));
+    }
+    trim(r.limbs);
+    return r;
+}
+
+/**
+ * floor(2^2k / m) for k = bit_length(m), or a few units less, by Newton's
+ * iteration: the reciprocal of the top half of m, shifted into place, is
+ * right to about k / 2 bits, and one step x' = 2x - m x^2 / 2^2k doubles
+ * that. Newton approaches 1/m from below, so after rounding x' is at most
+ * two above the floor, and two less is never above it. O(M(k)) instead of
+ * the O(k^2) of long division.
+ */
+bigint reciprocal(const bigint& m, unsigned int num_threads) {
+    size_t k = bit_length(m);
+    if (m.limbs.size() < NEWTON_THRESHOLD) {
+        bigint q;
+        bigint r;
+        divmod_long(power_of_two(2 * k), m, q, r);
+        return q;
+    }
+
+    // x = top 2^shift; the square only needs the short top
+    size_t h = k / 2 + 32;
+    size_t shift = k - h;
+    bigint top = reciprocal(shift_right(m, shift), num_threads);
+    bigint correction = shift_right(mul(m, sqr(top, num_threads), num_threads), 2 * k - 2 * shift);
+    bigint x = sub(shift_left(top, shift + 1), correction);
+    return sub(x, from_u64(2));
+}
+
+/**
+ * Barrett division (HAC 14.42): with mu from reciprocal(m), the quotient
+ * of any a < 2^2k is floor(floor(a / 2^(k-1)) mu / 2^(k+1)) or a few more,
+ * so a division costs two k-bit multiplications. Longer dividends are
+ * taken k bits at a time from the top, each step's remainder becoming the
+ * high part of the next.
+ */
+void divmod_barrett(const bigint& a, const bigint& m, bigint& quotient, bigint& remainder, unsigned int num_threads) {
+    size_t k = bit_length(m);
+    bigint mu = reciprocal(m, num_threads);
+
+    auto step = [&](const bigint& x, bigint& q, bigint& r) {
+        q = shift_right(mul(shift_right(x, k - 1), mu, num_threads), k + 1);
+        r = sub(x, mul(q, m, num_threads));
+        while (compare(r, m) >= 0) {
+            r = sub(r, m);
+            q = add(q, from_u64(1));
+        }
+    };
+
+    size_t length = bit_length(a);
+    if (length <= 2 * k) {
+        step(a, quotient, remainder);
+        return;
+    }
+
+    size_t chunks = (length - k + k - 1) / k;
+    bigint r = shift_right(a, chunks * k);
+    bigint q;
+    for (size_t i = chunks; i-- > 0;) {
+        bigint x = add(shift_left(r, k), low_bits(shift_right(a, i * k), k));
+        bigint qi;
+        step(x, qi, r);
+        q = add(shift_left(q, k), qi);
+    }
+    quotient = q;
+    remainder = r;
+}
+
+/**
+ * Divides with remainder: long division for short divisors, Barrett with a
+ * Newton reciprocal for long ones.
+ *
+ * @param a the dividend
+ * @param b the divisor
+ * @param quotient set to a / b
+ * @param remainder set to a mod b
+ * @param num_threads threads for the multiplications of long divisions, 0
+ *        for one per core
+ * @throws std::invalid_argument if b is zero
+ */
+void divmod(const bigint& a, const bigint& b, bigint& quotient, bigint& remainder, unsigned int num_threads) {
+    if (b.limbs.empty()) {
+        throw invalid_argument("bigint division by zero");
+    }
+    if (b.limbs.size() < NEWTON_THRESHOLD || compare(a, b) < 0) {
+        divmod_long(a, b, quotient, remainder);
+    }
+    else {
+        divmod_barrett(a, b, quotient, remainder, num_threads);
+    }
+}
+
+bigint div(const bigint& a, const bigint& b, unsigned int num_threads) {
+    bigint q;
+    bigint r;
+    divmod(a, b, q, r, num_threads);
+    return q;
+}
+
+bigint mod(const bigint& a, const bigint& b, unsigned int num_threads) {
+    bigint q;
+    bigint r;
+    divmod(a, b, q, r, num_threads);
+    return r;
+}
+
+/**
+ * a = a - b in place, for a >= b.
+ */
+void sub_in_place(vector<limb>& a, const vector<limb>& b) {
+    limb borrow = 0;
+    for (size_t i = 0; i < a.size() && (i < b.size() || borrow != 0); ++i) {
+        a[i] = sub_borrow(a[i], i < b.size() ? b[i] : 0, borrow);
+    }
+    trim(a);
+}
+
+/**
+ * Shifts a non-zero value right until it is odd.
+ *
+ * @return the number of bits shifted out
+ */
+size_t make_odd(vector<limb>& a) {
+    size_t zero_limbs = 0;
+    while (a[zero_limbs] == 0) {
+        ++zero_limbs;
+    }
+    int bits = 0;
+    while (((a[zero_limbs] >> bits) & 1) == 0) {
+        ++bits;
+    }
+
+    a.erase(a.begin(), a.begin() + static_cast<ptrdiff_t>(zero_limbs));
+    if (bits != 0) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] = a[i] >> bits | (i + 1 < a.size() ? a[i + 1] << (64 - bits) : 0);
+        }
+        trim(a);
+    }
+    return 64 * zero_limbs + static_cast<size_t>(bits);
+}
+
+/**
+ * Binary gcd (Stein): only subtractions and shifts in place, no divisions
+ * or allocations, at most one iteration per bit of a and b. gcd(0, b) = b.
+ */
+bigint gcd(bigint a, bigint b) {
+    if (a.limbs.empty()) {
+        return b;
+    }
+    if (b.limbs.empty()) {
+        return a;
+    }
+
+    size_t a_twos = make_odd(a.limbs);
+    size_t b_twos = make_odd(b.limbs);
+    while (true) {
+        int order = compare(a, b);
+        if (order == 0) {
+            break;
+        }
+        if (order < 0) {
+            swap(a, b);
+        }
+        // both odd, so a - b is even and non-zero
+        sub_in_place(a.limbs, b.limbs);
+        make_odd(a.limbs);
+    }
+    return shift_left(a, min(a_twos, b_twos));
+}
+
+} // namespace mp
@@ -0,0 +1,76 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+// Non-negative integers of any size, for the code whose values outgrow the
+// int arithmetic of RSA.cpp: the key audit and its product trees.
+// Multiplication is subquadratic (Karatsuba, then Toom-3) for long operands,
+// with squares taking their own cheaper routines, and so is division by long
+// divisors, which goes through a Newton reciprocal. Where the algorithms
+// take over is measured on the machine by tune_mul_thresholds (mp_tune).
+// Products of 256, 1024 and 2048 bits and Montgomery reduction at those
+// sizes run on the fixed-size kernels of kernels.h, MULX/ADX where the CPU
+// has them.
+//
+// A bigint is a little-endian vector of 64-bit limbs with no leading zero
+// limbs; zero is the empty vector. Everything is plain value semantics and
+// nothing here is constant time, so it is for analysis, not for keys in use.
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "limb.h"
+
+namespace mp {
+
+struct bigint {
+    std::vector<limb> limbs;
+};
+
+// Operand sizes, in limbs of the shorter factor, from which each algorithm
+// takes over from the one below it
+struct mul_thresholds {
+    size_t karatsuba;       // schoolbook below
+    size_t toom3;           // Karatsuba below
+    size_t karatsuba_sqr;   // schoolbook squaring below
+    size_t toom3_sqr;       // Karatsuba squaring below
+};
+
+struct mont_ctx {
+    bigint n;
+    limb n_prime;   // -n^-1 mod 2^64
+    bigint r2;      // R^2 mod n, R = 2^(64 limbs of n)
+};
+
+bigint from_u64(uint64_t v);
+bool from_decimal(const std::string& text, bigint& out);
+std::string to_decimal(const bigint& a);
+
+bool is_zero(const bigint& a);
+bool fits_u64(const bigint& a);
+uint64_t to_u64(const bigint& a);
+size_t bit_length(const bigint& a);
+int compare(const bigint& a, const bigint& b);
+
+bigint add(const bigint& a, const bigint& b);
+bigint sub(const bigint& a, const bigint& b);
+bigint mul(const bigint& a, const bigint& b, unsigned int num_threads = 1);
+bigint sqr(const bigint& a, unsigned int num_threads = 1);
+bigint shift_left(const bigint& a, size_t bits);
+bigint shift_right(const bigint& a, size_t bits);
+void divmod(const bigint& a, const bigint& b, bigint& quotient, bigint& remainder, unsigned int num_threads = 1);
+bigint div(const bigint& a, const bigint& b, unsigned int num_threads = 1);
+bigint mod(const bigint& a, const bigint& b, unsigned int num_threads = 1);
+bigint gcd(bigint a, bigint b);
+
+mont_ctx mont_init(const bigint& n);
+bigint mont_mul(const mont_ctx& ctx, const bigint& a, const bigint& b);
+bigint mont_modexp(const mont_ctx& ctx, const bigint& base, const bigint& exponent);
+bigint pow_mod(const bigint& base, const bigint& exponent, const bigint& n);
+
+mul_thresholds get_mul_thresholds();
+void set_mul_thresholds(const mul_thresholds& t);
+mul_thresholds tune_mul_thresholds();
+const char* limb_kernels();
+bool use_adx_kernels(bool enable);
+
+} // namespace mp
+
+#endif
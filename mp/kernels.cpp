@@ -0,0 +1,247 @@
+// kernels.cpp : Fixed-size multiply-accumulate rows, portable and
+// MULX/ADCX/ADOX, with CPUID dispatch and Montgomery reduction on top.
+//
+#include "kernels.h"
+#include "bigint.h"
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MP_ADX_KERNELS
+#include <cpuid.h>
+#endif
+
+using namespace std;
+
+namespace mp {
+
+// r[0..n) += m * b[0..n) for one fixed n, returning the carry limb
+typedef limb (*row_kernel)(limb* r, const limb* b, limb m);
+
+struct kernel_set {
+    const char* name;
+    row_kernel row_4;
+    row_kernel row_16;
+    row_kernel row_32;
+};
+
+template <size_t N>
+limb row_portable(limb* r, const limb* b, limb m) {
+    return addmul_1(r, b, N, m);
+}
+
+const kernel_set PORTABLE_KERNELS = { "portable", row_portable<4>, row_portable<16>, row_portable<32> };
+
+#ifdef MP_ADX_KERNELS
+// One limb of a row, with m in rdx: MULX gives lo and hi of m b_j without
+// touching the flags, ADCX adds r_j to lo on the CF chain and ADOX adds the
+// previous hi on the OF chain, so the two carries never wait on each other.
+// The hi registers alternate between h0 and h1.
+#define MP_ADX_STEP(j, hi, prev)                                               \
+    "mulxq " #j "*8(%[b]), %[lo], %[" #hi "]\n\t"                              \
+    "adcxq " #j "*8(%[r]), %[lo]\n\t"                                          \
+    "adoxq %[" #prev "], %[lo]\n\t"                                            \
+    "movq %[lo], " #j "*8(%[r])\n\t"
+
+#define MP_ADX_QUAD(j0, j1, j2, j3)                                            \
+    MP_ADX_STEP(j0, h1, h0) MP_ADX_STEP(j1, h0, h1)                            \
+    MP_ADX_STEP(j2, h1, h0) MP_ADX_STEP(j3, h0, h1)
+
+// A whole row: both chains start clear with h0 = 0, and the last hi (in h0,
+// the limb count being even) takes in both final carries. It cannot
+// overflow, since r + m b always fits n + 1 limbs.
+#define MP_ADX_ROW(N, STEPS)                                                   \
+    limb row_adx_##N(limb* r, const limb* b, limb m) {                         \
+        limb lo;                                                               \
+        limb h0;                                                               \
+        limb h1;                                                               \
+        __asm__ volatile(                                                      \
+            "xorl %k[h0], %k[h0]\n\t"                                          \
+            STEPS                                                              \
+            "movl $0, %k[lo]\n\t"                                              \
+            "adcxq %[lo], %[h0]\n\t"                                           \
+            "adoxq %[lo], %[h0]\n\t"                                           \
+            : [lo] "=&r"(lo), [h0] "=&r"(h0), [h1] "=&r"(h1)                   \
+            : [r] "r"(r), [b] "r"(b), "d"(m)                                   \
+            : "cc", "memory");                                                 \
+        return h0;                                                             \
+    }
+
+MP_ADX_ROW(4, MP_ADX_QUAD(0, 1, 2, 3))
+
+MP_ADX_ROW(16, MP_ADX_QUAD(0, 1, 2, 3) MP_ADX_QUAD(4, 5, 6, 7) MP_ADX_QUAD(8, 9, 10, 11)
+                   MP_ADX_QUAD(12, 13, 14, 15))
+
+MP_ADX_ROW(32, MP_ADX_QUAD(0, 1, 2, 3) MP_ADX_QUAD(4, 5, 6, 7) MP_ADX_QUAD(8, 9, 10, 11)
+                   MP_ADX_QUAD(12, 13, 14, 15) MP_ADX_QUAD(16, 17, 18, 19) MP_ADX_QUAD(20, 21, 22, 23)
+                       MP_ADX_QUAD(24, 25, 26, 27) MP_ADX_QUAD(28, 29, 30, 31))
+
+const kernel_set ADX_KERNELS = { "adx", row_adx_4, row_adx_16, row_adx_32 };
+
+/**
+ * @return whether the CPU has MULX (BMI2) and ADCX/ADOX (ADX), from CPUID
+ *         leaf 7
+ */
+bool cpu_has_adx() {
+    unsigned int eax;
+    unsigned int ebx;
+    unsigned int ecx;
+    unsigned int edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    const unsigned int BMI2 = 1u << 8;
+    const unsigned int ADX = 1u << 19;
+    return (ebx & BMI2) != 0 && (ebx & ADX) != 0;
+}
+#endif
+
+/**
+ * @return whether every row of a kernel set gives the same limbs and carry
+ *         as the portable rows, on random operands and on all-ones ones,
+ *         which carry the most
+ */
+bool kernels_agree(const kernel_set& kernels) {
+    const size_t sizes[] = { 4, 16, 32 };
+    const row_kernel rows[] = { kernels.row_4, kernels.row_16, kernels.row_32 };
+    const row_kernel portable[] = { PORTABLE_KERNELS.row_4, PORTABLE_KERNELS.row_16, PORTABLE_KERNELS.row_32 };
+
+    uint64_t state = 0x853c49e6748fea9bULL;
+    auto next = [&] {
+        // xorshift64
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+
+    for (size_t k = 0; k < 3; ++k) {
+        size_t n = sizes[k];
+        for (int trial = 0; trial < 16; ++trial) {
+            bool ones = trial == 0;
+            limb r[32];
+            limb b[32];
+            for (size_t j = 0; j < n; ++j) {
+                r[j] = ones ? ~limb(0) : next();
+                b[j] = ones ? ~limb(0) : next();
+            }
+            limb m = ones ? ~limb(0) : next();
+            limb expected[32];
+            copy(r, r + n, expected);
+            limb expected_carry = portable[k](expected, b, m);
+            limb carry = rows[k](r, b, m);
+            if (carry != expected_carry || !equal(r, r + n, expected)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @return the ADX kernels if the CPU has them and they check out, else the
+ *         portable ones
+ */
+const kernel_set* select_kernels(bool allow_adx) {
+#ifdef MP_ADX_KERNELS
+    if (allow_adx && cpu_has_adx() && kernels_agree(ADX_KERNELS)) {
+        return &ADX_KERNELS;
+    }
+#endif
+    (void)allow_adx;
+    return &PORTABLE_KERNELS;
+}
+
+const kernel_set*& active_kernels() {
+    static const kernel_set* active = select_kernels(true);
+    return active;
+}
+
+/**
+ * @return the row kernel for n limbs, or nullptr if n has none
+ */
+row_kernel fixed_row(size_t n) {
+    const kernel_set* kernels = active_kernels();
+    switch (n) {
+    case 4:
+        return kernels->row_4;
+    case 16:
+        return kernels->row_16;
+    case 32:
+        return kernels->row_32;
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * @return the name of the kernel set in use, "adx" or "portable"
+ */
+const char* limb_kernels() {
+    return active_kernels()->name;
+}
+
+/**
+ * Switches between the ADX and the portable kernels, to compare them. Not
+ * synchronized: call it before other threads multiply.
+ *
+ * @param enable whether to use the ADX kernels where the CPU has them
+ * @return whether the ADX kernels are now in use
+ */
+bool use_adx_kernels(bool enable) {
+    active_kernels() = select_kernels(enable);
+    return using_adx_kernels();
+}
+
+/**
+ * @return whether the ADX kernels are in use
+ */
+bool using_adx_kernels() {
+    return active_kernels() != &PORTABLE_KERNELS;
+}
+
+/**
+ * @return whether n limbs is one of the sizes with dedicated kernels
+ */
+bool has_fixed_kernel(size_t n) {
+    return n == 4 || n == 16 || n == 32;
+}
+
+/**
+ * r[0..2n) = a * b for n-limb operands of a size with dedicated kernels,
+ * one kernel row per limb of a.
+ */
+void mul_fixed(limb* r, const limb* a, const limb* b, size_t n) {
+    row_kernel row = fixed_row(n);
+    fill(r, r + 2 * n, limb(0));
+    for (size_t i = 0; i < n; ++i) {
+        r[i + n] = row(r + i, b, a[i]);
+    }
+}
+
+/**
+ * Montgomery reduction: r[0..n) = t R^-1 mod m for R = 2^64n, from
+ * t[0..2n] with t < m R and t[2n] = 0; t is overwritten. Each step adds
+ * the multiple of m that clears the lowest limb, t_i m' m with
+ * m' = -m^-1 mod 2^64, through the kernel rows where n has them.
+ */
+void redc(limb* r, limb* t, const limb* m, limb m_prime, size_t n) {
+    row_kernel row = fixed_row(n);
+    for (size_t i = 0; i < n; ++i) {
+        limb q = t[i] * m_prime;
+        limb carry = row != nullptr ? row(t + i, m, q) : addmul_1(t + i, m, n, q);
+        add_into(t + i + n, n + 1 - i, &carry, 1);
+    }
+
+    // t / R < 2m
+    limb* u = t + n;
+    int order = u[n] != 0 ? 1 : 0;
+    for (size_t i = n; order == 0 && i-- > 0;) {
+        order = u[i] != m[i] ? (u[i] < m[i] ? -1 : 1) : 0;
+    }
+    if (order >= 0) {
+        sub_into(u, n + 1, m, n);
+    }
+    copy(u, u + n, r);
+}
+
+} // namespace mp
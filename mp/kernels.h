@@ -0,0 +1,22 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+// Fixed-size limb kernels for 256, 1024 and 2048-bit operands (4, 16 and 32
+// limbs), the sizes of EC field elements and RSA moduli. On x86-64 CPUs
+// with BMI2 and ADX each row is a fully unrolled MULX/ADCX/ADOX block that
+// carries the low and high halves of the products on two separate flag
+// chains; everywhere else the rows are the portable addmul_1 of limb.h.
+// The kernel set is chosen from CPUID on first use, and the ADX one only
+// after it has matched the portable one on a self-check.
+#include <cstddef>
+#include "limb.h"
+
+namespace mp {
+
+bool has_fixed_kernel(size_t n);
+bool using_adx_kernels();
+void mul_fixed(limb* r, const limb* a, const limb* b, size_t n);
+void redc(limb* r, limb* t, const limb* m, limb m_prime, size_t n);
+
+} // namespace mp
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef LIMB_H
+#define LIMB_H
+// Double-width limb operations for the multiprecision code: 64 x 64 -> 128
+// bit products and 128 / 64 bit division, on compilers with a 128-bit type
+// and on MSVC through its intrinsics.
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(__SIZEOF_INT128__) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace mp {
+
+typedef uint64_t limb;
+
+#if defined(__SIZEOF_INT128__)
+/**
+ * @return the low half of a * b; the high half goes to hi
+ */
+inline limb mul_wide(limb a, limb b, limb& hi) {
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    hi = static_cast<limb>(product >> 64);
+    return static_cast<limb>(product);
+}
+
+/**
+ * @return (hi 2^64 + lo) / d, which must fit a limb (hi < d); the
+ *         remainder goes to rem
+ */
+inline limb div_wide(limb hi, limb lo, limb d, limb& rem) {
+    unsigned __int128 n = static_cast<unsigned __int128>(hi) << 64 | lo;
+    rem = static_cast<limb>(n % d);
+    return static_cast<limb>(n / d);
+}
+#else
+inline limb mul_wide(limb a, limb b, limb& hi) {
+    return _umul128(a, b, &hi);
+}
+
+inline limb div_wide(limb hi, limb lo, limb d, limb& rem) {
+    return _udiv128(hi, lo, d, &rem);
+}
+#endif
+
+/**
+ * @return the number of leading zero bits of a non-zero limb
+ */
+inline int leading_zeros(limb v) {
+    int count = 0;
+    while ((v & (limb(1) << 63)) == 0) {
+        v <<= 1;
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * @return a + b + carry, with the carry out in carry (0 or 1)
+ */
+inline limb add_carry(limb a, limb b, limb& carry) {
+    limb sum = a + carry;
+    limb c = sum < carry;
+    sum += b;
+    carry = c + (sum < b);
+    return sum;
+}
+
+/**
+ * @return a - b - borrow, with the borrow out in borrow (0 or 1)
+ */
+inline limb sub_borrow(limb a, limb b, limb& borrow) {
+    limb diff = a - b;
+    limb c = a < b;
+    limb result = diff - borrow;
+    borrow = c + (diff < borrow);
+    return result;
+}
+
+/**
+ * r[0..n) += m * b[0..n), one row of a schoolbook product.
+ *
+ * @return the limb carried out of r[n - 1]
+ */
+inline limb addmul_1(limb* r, const limb* b, size_t n, limb m) {
+    limb carry = 0;
+    for (size_t j = 0; j < n; ++j) {
+        // m b_j + r_j + carry < 2^128, so the high half cannot overflow
+        limb hi;
+        limb lo = mul_wide(m, b[j], hi);
+        limb c = 0;
+        limb sum = add_carry(r[j], lo, c);
+        r[j] = sum + carry;
+        c += r[j] < carry;
+        carry = hi + c;
+    }
+    return carry;
+}
+
+/**
+ * r[0..n) += a[0..an), an <= n, carrying through the rest of r.
+ *
+ * @return the carry out of r[n - 1]
+ */
+inline limb add_into(limb* r, size_t n, const limb* a, size_t an) {
+    limb carry = 0;
+    size_t i = 0;
+    for (; i < an; ++i) {
+        r[i] = add_carry(r[i], a[i], carry);
+    }
+    for (; carry != 0 && i < n; ++i) {
+        r[i] += 1;
+        carry = r[i] == 0;
+    }
+    return carry;
+}
+
+/**
+ * r[0..n) -= a[0..an), an <= n, borrowing through the rest of r.
+ *
+ * @return the borrow out of r[n - 1]
+ */
+inline limb sub_into(limb* r, size_t n, const limb* a, size_t an) {
+    limb borrow = 0;
+    size_t i = 0;
+    for (; i < an; ++i) {
+        r[i] = sub_borrow(r[i], a[i], borrow);
+    }
+    for (; borrow != 0 && i < n; ++i) {
+        borrow = r[i] == 0;
+        r[i] -= 1;
+    }
+    return borrow;
+}
+
+} // namespace mp
+
+#endif
@@ -0,0 +1,193 @@
+// montgomery.cpp : Montgomery multiplication and modular exponentiation on
+// bigints, the multi-limb counterpart of mont_mul in RSA.cpp.
+//
+#include "bigint.h"
+#include "kernels.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace mp {
+
+// Exponent bits handled per table lookup in mont_modexp
+const size_t MODEXP_WINDOW = 4;
+
+/**
+ * @return a as exactly k limbs, zero-padded; a must fit
+ */
+vector<limb> padded(const bigint& a, size_t k) {
+    vector<limb> r(a.limbs);
+    r.resize(k, 0);
+    return r;
+}
+
+/**
+ * r[0..k) = a b R^-1 mod n for k-limb a, b < n, with t as scratch of
+ * 2k + 1 limbs. Products of the kernel sizes go through mul_fixed, others
+ * through mul.
+ */
+void mont_mul_limbs(const mont_ctx& ctx, limb* r, const limb* a, const limb* b, vector<limb>& t) {
+    size_t k = ctx.n.limbs.size();
+    t.assign(2 * k + 1, 0);
+    if (has_fixed_kernel(k)) {
+        mul_fixed(t.data(), a, b, k);
+    }
+    else {
+        bigint x;
+        bigint y;
+        x.limbs.assign(a, a + k);
+        y.limbs.assign(b, b + k);
+        while (!x.limbs.empty() && x.limbs.back() == 0) {
+            x.limbs.pop_back();
+        }
+        while (!y.limbs.empty() && y.limbs.back() == 0) {
+            y.limbs.pop_back();
+        }
+        bigint p = mul(x, y);
+        copy(p.limbs.begin(), p.limbs.end(), t.begin());
+    }
+    redc(r, t.data(), ctx.n.limbs.data(), ctx.n_prime, k);
+}
+
+bigint trimmed(vector<limb> limbs) {
+    bigint r;
+    r.limbs = move(limbs);
+    while (!r.limbs.empty() && r.limbs.back() == 0) {
+        r.limbs.pop_back();
+    }
+    return r;
+}
+
+/**
+ * Sets up Montgomery arithmetic mod n with R = 2^64k, k the limb count of
+ * n.
+ *
+ * @param n the modulus, odd and above 1
+ * @return the context: n, n' = -n^-1 mod 2^64 and R^2 mod n
+ * @throws std::invalid_argument if n is even or 1
+ */
+mont_ctx mont_init(const bigint& n) {
+    if (n.limbs.empty() || (n.limbs[0] & 1) == 0 || compare(n, from_u64(1)) == 0) {
+        throw invalid_argument("Montgomery modulus must be odd and above 1");
+    }
+
+    // Newton's iteration x = x (2 - n x) doubles the correct low bits of
+    // n^-1, and n is its own inverse mod 8
+    limb inverse = n.limbs[0];
+    for (int i = 0; i < 5; ++i) {
+        inverse *= 2 - n.limbs[0] * inverse;
+    }
+
+    mont_ctx ctx;
+    ctx.n = n;
+    ctx.n_prime = limb(0) - inverse;
+    ctx.r2 = mod(shift_left(from_u64(1), 128 * n.limbs.size()), n);
+    return ctx;
+}
+
+/**
+ * Montgomery product a * b * R^-1 mod n.
+ *
+ * @param ctx the Montgomery context
+ * @param a the first factor, below n
+ * @param b the second factor, below n
+ * @return the reduced product, below n
+ */
+bigint mont_mul(const mont_ctx& ctx, const bigint& a, const bigint& b) {
+    size_t k = ctx.n.limbs.size();
+    vector<limb> x = padded(a, k);
+    vector<limb> y = padded(b, k);
+    vector<limb> r(k);
+    vector<limb> t;
+    mont_mul_limbs(ctx, r.data(), x.data(), y.data(), t);
+    return trimmed(move(r));
+}
+
+/**
+ * Modular exponentiation with Montgomery multiplication, scanning the
+ * exponent MODEXP_WINDOW bits at a time from the top against a table of
+ * the first 2^MODEXP_WINDOW powers of the base.
+ *
+ * @param ctx the Montgomery context of the modulus
+ * @param base the base, any size
+ * @param exponent the exponent
+ * @return base^exponent mod n
+ */
+bigint mont_modexp(const mont_ctx& ctx, const bigint& base, const bigint& exponent) {
+    size_t k = ctx.n.limbs.size();
+    vector<limb> t;
+    vector<limb> r2 = padded(ctx.r2, k);
+    vector<limb> one(k, 0);
+    one[0] = 1;
+
+    // table[i] = base^i R mod n
+    size_t entries = size_t(1) << MODEXP_WINDOW;
+    vector<vector<limb>> table(entries, vector<limb>(k));
+    vector<limb> x = padded(compare(base, ctx.n) < 0 ? base : mod(base, ctx.n), k);
+    mont_mul_limbs(ctx, table[0].data(), one.data(), r2.data(), t);
+    mont_mul_limbs(ctx, table[1].data(), x.data(), r2.data(), t);
+    for (size_t i = 2; i < entries; ++i) {
+        mont_mul_limbs(ctx, table[i].data(), table[i - 1].data(), table[1].data(), t);
+    }
+
+    vector<limb> acc = table[0];
+    vector<limb> next(k);
+    size_t bits = bit_length(exponent);
+    size_t position = (bits + MODEXP_WINDOW - 1) / MODEXP_WINDOW * MODEXP_WINDOW;
+    while (position > 0) {
+        position -= MODEXP_WINDOW;
+        for (size_t i = 0; i < MODEXP_WINDOW; ++i) {
+            mont_mul_limbs(ctx, next.data(), acc.data(), acc.data(), t);
+            acc.swap(next);
+        }
+
+        size_t digit = 0;
+        for (size_t i = MODEXP_WINDOW; i-- > 0;) {
+            size_t bit = position + i;
+            digit = digit << 1 | (bit < bits ? (exponent.limbs[bit / 64] >> (bit % 64)) & 1 : 0);
+        }
+        if (digit != 0) {
+            mont_mul_limbs(ctx, next.data(), acc.data(), table[digit].data(), t);
+            acc.swap(next);
+        }
+    }
+
+    mont_mul_limbs(ctx, next.data(), acc.data(), one.data(), t);
+    return trimmed(move(next));
+}
+
+/**
+ * Modular exponentiation, through Montgomery arithmetic for odd moduli and
+ * square-and-multiply with division otherwise.
+ *
+ * @param base the base, any size
+ * @param exponent the exponent
+ * @param n the modulus, above 0
+ * @return base^exponent mod n
+ * @throws std::invalid_argument if n is zero
+ */
+bigint pow_mod(const bigint& base, const bigint& exponent, const bigint& n) {
+    if (compare(n, from_u64(1)) <= 0) {
+        if (is_zero(n)) {
+            throw invalid_argument("bigint division by zero");
+        }
+        return bigint();
+    }
+    if ((n.limbs[0] & 1) != 0) {
+        return mont_modexp(mont_init(n), base, exponent);
+    }
+
+    bigint result = from_u64(1);
+    bigint square = mod(base, n);
+    for (size_t bit = 0; bit < bit_length(exponent); ++bit) {
+        if ((exponent.limbs[bit / 64] >> (bit % 64)) & 1) {
+            result = mod(mul(result, square), n);
+        }
+        square = mod(sqr(square), n);
+    }
+    return result;
+}
+
+} // namespace mp
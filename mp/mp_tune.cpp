@@ -0,0 +1,25 @@
+// mp_tune.cpp : Measures where Karatsuba and Toom-3 take over on this
+// machine and prints the thresholds to build into mul.cpp.
+//
+//   mp_tune
+//
+#include "bigint.h"
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+    mp::mul_thresholds built_in = mp::get_mul_thresholds();
+    mp::mul_thresholds t = mp::tune_mul_thresholds();
+
+    cout << "            built in   measured" << endl;
+    cout << "karatsuba     " << built_in.karatsuba << "\t" << t.karatsuba << endl;
+    cout << "toom3         " << built_in.toom3 << "\t" << t.toom3 << endl;
+    cout << "karatsuba_sqr " << built_in.karatsuba_sqr << "\t" << t.karatsuba_sqr << endl;
+    cout << "toom3_sqr     " << built_in.toom3_sqr << "\t" << t.toom3_sqr << endl;
+    cout << endl;
+    cout << "mul_thresholds thresholds = { " << t.karatsuba << ", " << t.toom3 << ", " << t.karatsuba_sqr << ", "
+         << t.toom3_sqr << " };" << endl;
+    return 0;
+}
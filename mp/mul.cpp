@@ -0,0 +1,407 @@
+// mul.cpp : Multiplication and squaring: schoolbook, Karatsuba, Toom-3 and a
+// threaded top level, switching at tunable operand sizes.
+//
+#include "bigint.h"
+#include "kernels.h"
+#include "../common/parallel.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace mp {
+
+// Balanced products at least this many limbs long run the sub-products of
+// their top Karatsuba or Toom-3 level on separate threads
+const size_t PARALLEL_MUL_THRESHOLD = 512;
+
+// 3^-1 mod 2^64, for exact division by 3
+const limb INVERSE_3 = 0xaaaaaaaaaaaaaaabULL;
+
+// Measured with mp_tune; see tune_mul_thresholds
+mul_thresholds thresholds = { 36, 230, 54, 300 };
+
+/**
+ * @return the multiplication and squaring thresholds in use
+ */
+mul_thresholds get_mul_thresholds() {
+    return thresholds;
+}
+
+/**
+ * Replaces the multiplication and squaring thresholds. Not synchronized:
+ * call it before other threads multiply, as mp_tune and the benchmarks do.
+ *
+ * @param t the new thresholds; each is clamped to the smallest size its
+ *        algorithm can split
+ */
+void set_mul_thresholds(const mul_thresholds& t) {
+    thresholds.karatsuba = max<size_t>(t.karatsuba, 4);
+    thresholds.toom3 = max<size_t>(t.toom3, 5);
+    thresholds.karatsuba_sqr = max<size_t>(t.karatsuba_sqr, 4);
+    thresholds.toom3_sqr = max<size_t>(t.toom3_sqr, 5);
+}
+
+/**
+ * r[0..an+bn) = a * b by schoolbook, O(an bn) limb products.
+ */
+void mul_basecase(limb* r, const limb* a, size_t an, const limb* b, size_t bn) {
+    fill(r, r + an + bn, limb(0));
+    for (size_t i = 0; i < an; ++i) {
+        r[i + bn] = addmul_1(r + i, b, bn, a[i]);
+    }
+}
+
+/**
+ * r[0..2n) = a^2 by schoolbook: each cross product a_i a_j, i < j, once,
+ * then doubled, then the squares a_i^2 added on the diagonal, so about half
+ * the limb products of mul_basecase.
+ */
+void sqr_basecase(limb* r, const limb* a, size_t n) {
+    fill(r, r + 2 * n, limb(0));
+    for (size_t i = 0; i + 1 < n; ++i) {
+        r[i + n] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    }
+
+    limb top = 0;
+    for (size_t i = 0; i < 2 * n; ++i) {
+        limb next = r[i] >> 63;
+        r[i] = r[i] << 1 | top;
+        top = next;
+    }
+
+    limb carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        limb hi;
+        limb lo = mul_wide(a[i], a[i], hi);
+        r[2 * i] = add_carry(r[2 * i], lo, carry);
+        r[2 * i + 1] = add_carry(r[2 * i + 1], hi, carry);
+    }
+}
+
+/**
+ * @return the length of a[0..n) without its leading zero limbs
+ */
+size_t trimmed_length(const limb* a, size_t n) {
+    while (n > 0 && a[n - 1] == 0) {
+        --n;
+    }
+    return n;
+}
+
+void mul_limbs(limb* r, const limb* a, size_t an, const limb* b, size_t bn, unsigned int num_threads);
+
+/**
+ * r[0..2n) = a * b for two n-limb operands by Karatsuba: with each operand
+ * split in halves x1 B^h + x0, three half-size products give
+ * z0 = a0 b0, z2 = a1 b1 and z1 = (a0 + a1)(b0 + b1) - z0 - z2, and
+ * a b = z2 B^2h + z1 B^h + z0. O(n^1.585) limb products. With a == b
+ * every product is a square.
+ */
+void mul_karatsuba(limb* r, const limb* a, const limb* b, size_t n, unsigned int num_threads) {
+    bool square = a == b;
+    size_t h = n / 2;
+    size_t hi = n - h;
+    const limb* a0 = a;
+    const limb* a1 = a + h;
+    const limb* b0 = b;
+    const limb* b1 = b + h;
+
+    vector<limb> sa(a1, a1 + hi);
+    sa.push_back(add_into(sa.data(), hi, a0, h));
+    vector<limb> sb;
+    if (!square) {
+        sb.assign(b1, b1 + hi);
+        sb.push_back(add_into(sb.data(), hi, b0, h));
+    }
+    const limb* sum_b = square ? sa.data() : sb.data();
+    vector<limb> z1(2 * (hi + 1));
+
+    if (num_threads > 1 && n >= PARALLEL_MUL_THRESHOLD) {
+        unsigned int share = max(1u, num_threads / 3);
+        thread low([&] { mul_limbs(r, a0, h, b0, h, share); });
+        thread high([&] { mul_limbs(r + 2 * h, a1, hi, b1, hi, share); });
+        mul_limbs(z1.data(), sa.data(), hi + 1, sum_b, hi + 1, share);
+        low.join();
+        high.join();
+    }
+    else {
+        mul_limbs(r, a0, h, b0, h, 1);
+        mul_limbs(r + 2 * h, a1, hi, b1, hi, 1);
+        mul_limbs(z1.data(), sa.data(), hi + 1, sum_b, hi + 1, 1);
+    }
+
+    sub_into(z1.data(), z1.size(), r, 2 * h);
+    sub_into(z1.data(), z1.size(), r + 2 * h, 2 * hi);
+    add_into(r + h, 2 * n - h, z1.data(), trimmed_length(z1.data(), z1.size()));
+}
+
+/**
+ * A signed intermediate of Toom-3, as a trimmed magnitude and a sign.
+ */
+struct toom_value {
+    vector<limb> magnitude;
+    bool negative;
+};
+
+toom_value toom_from(const limb* a, size_t n) {
+    toom_value v;
+    v.magnitude.assign(a, a + trimmed_length(a, n));
+    v.negative = false;
+    return v;
+}
+
+/**
+ * @return x + y, or x - y with subtract set
+ */
+toom_value toom_add(const toom_value& x, const toom_value& y, bool subtract = false) {
+    bool y_negative = y.negative != subtract;
+    const vector<limb>& xm = x.magnitude;
+    const vector<limb>& ym = y.magnitude;
+    toom_value r;
+    if (x.negative == y_negative) {
+        r.magnitude = xm.size() >= ym.size() ? xm : ym;
+        const vector<limb>& shorter = xm.size() >= ym.size() ? ym : xm;
+        r.magnitude.push_back(0);
+        add_into(r.magnitude.data(), r.magnitude.size(), shorter.data(), shorter.size());
+        r.negative = x.negative;
+    }
+    else {
+        int order = xm.size() != ym.size() ? (xm.size() < ym.size() ? -1 : 1) : 0;
+        for (size_t i = xm.size(); order == 0 && i-- > 0;) {
+            order = xm[i] != ym[i] ? (xm[i] < ym[i] ? -1 : 1) : 0;
+        }
+        const vector<limb>& larger = order >= 0 ? xm : ym;
+        const vector<limb>& smaller = order >= 0 ? ym : xm;
+        r.magnitude = larger;
+        sub_into(r.magnitude.data(), r.magnitude.size(), smaller.data(), smaller.size());
+        r.negative = order >= 0 ? x.negative : y_negative;
+    }
+    r.magnitude.resize(trimmed_length(r.magnitude.data(), r.magnitude.size()));
+    r.negative = r.negative && !r.magnitude.empty();
+    return r;
+}
+
+/**
+ * @return x * 2^bits, bits < 64
+ */
+toom_value toom_shift_left(const toom_value& x, int bits) {
+    toom_value r = x;
+    r.magnitude.push_back(0);
+    for (size_t i = r.magnitude.size(); i-- > 1;) {
+        r.magnitude[i] = r.magnitude[i] << bits | r.magnitude[i - 1] >> (64 - bits);
+    }
+    r.magnitude[0] <<= bits;
+    r.magnitude.resize(trimmed_length(r.magnitude.data(), r.magnitude.size()));
+    return r;
+}
+
+/**
+ * @return x / 2, which must be exact
+ */
+toom_value toom_half(const toom_value& x) {
+    toom_value r = x;
+    vector<limb>& m = r.magnitude;
+    for (size_t i = 0; i < m.size(); ++i) {
+        m[i] = m[i] >> 1 | (i + 1 < m.size() ? m[i + 1] << 63 : 0);
+    }
+    m.resize(trimmed_length(m.data(), m.size()));
+    return r;
+}
+
+/**
+ * @return x / 3, which must be exact: each quotient limb is the low limb
+ *         times 3^-1 mod 2^64, and the high limb of 3 q is the borrow into
+ *         the next one
+ */
+toom_value toom_third(const toom_value& x) {
+    toom_value r = x;
+    limb borrow = 0;
+    for (limb& v : r.magnitude) {
+        limb under = v < borrow;
+        limb q = (v - borrow) * INVERSE_3;
+        limb hi;
+        mul_wide(q, 3, hi);
+        v = q;
+        borrow = hi + under;
+    }
+    r.magnitude.resize(trimmed_length(r.magnitude.data(), r.magnitude.size()));
+    return r;
+}
+
+/**
+ * @return a(0), a(1), a(-1), a(-2), a(inf) for a = a2 x^2 + a1 x + a0
+ */
+vector<toom_value> toom_evaluate(const limb* a, size_t n, size_t k) {
+    toom_value a0 = toom_from(a, k);
+    toom_value a1 = toom_from(a + k, k);
+    toom_value a2 = toom_from(a + 2 * k, n - 2 * k);
+    toom_value even = toom_add(a0, a2);
+    toom_value minus_two = toom_add(toom_shift_left(toom_add(toom_shift_left(a2, 1), a1, true), 1), a0);
+    return { a0, toom_add(even, a1), toom_add(even, a1, true), minus_two, a2 };
+}
+
+/**
+ * r[0..2n) = a * b for two n-limb operands by Toom-3: each operand is split
+ * in three, both are evaluated at 0, 1, -1, -2 and infinity, the five
+ * third-size products are multiplied out and the product's five
+ * coefficients interpolated back (Bodrato's sequence, with only exact
+ * divisions by 2 and 3). O(n^1.465) limb products. With a == b every
+ * product is a square.
+ */
+void mul_toom3(limb* r, const limb* a, const limb* b, size_t n, unsigned int num_threads) {
+    bool square = a == b;
+    size_t k = (n + 2) / 3;
+    vector<toom_value> ea = toom_evaluate(a, n, k);
+    vector<toom_value> eb;
+    if (!square) {
+        eb = toom_evaluate(b, n, k);
+    }
+
+    vector<toom_value> w(5);
+    auto product = [&](size_t i, unsigned int threads) {
+        const toom_value& x = ea[i];
+        const toom_value& y = square ? x : eb[i];
+        w[i].negative = false;
+        if (x.magnitude.empty() || y.magnitude.empty()) {
+            return;
+        }
+        w[i].magnitude.resize(x.magnitude.size() + y.magnitude.size());
+        mul_limbs(w[i].magnitude.data(), x.magnitude.data(), x.magnitude.size(), y.magnitude.data(),
+                  y.magnitude.size(), threads);
+        w[i].magnitude.resize(trimmed_length(w[i].magnitude.data(), w[i].magnitude.size()));
+        w[i].negative = x.negative != y.negative;
+    };
+
+    if (num_threads > 1 && n >= PARALLEL_MUL_THRESHOLD) {
+        unsigned int share = max(1u, num_threads / 5);
+        vector<thread> pool;
+        for (size_t i = 0; i < 4; ++i) {
+            pool.emplace_back(product, i, share);
+        }
+        product(4, share);
+        for (auto& worker : pool) {
+            worker.join();
+        }
+    }
+    else {
+        for (size_t i = 0; i < 5; ++i) {
+            product(i, 1);
+        }
+    }
+
+    // w = r(0), r(1), r(-1), r(-2), r(inf); solve for the coefficients
+    // c0 = r(0), c1, c2, c3 and c4 = r(inf)
+    const toom_value& w0 = w[0];
+    const toom_value& w4 = w[4];
+    toom_value c3 = toom_third(toom_add(w[3], w[1], true));
+    toom_value c1 = toom_half(toom_add(w[1], w[2], true));
+    toom_value c2 = toom_add(w[2], w0, true);
+    c3 = toom_add(toom_half(toom_add(c2, c3, true)), toom_shift_left(w4, 1));
+    c2 = toom_add(toom_add(c2, c1), w4, true);
+    c1 = toom_add(c1, c3, true);
+
+    fill(r, r + 2 * n, limb(0));
+    copy(w0.magnitude.begin(), w0.magnitude.end(), r);
+    copy(w4.magnitude.begin(), w4.magnitude.end(), r + 4 * k);
+    add_into(r + k, 2 * n - k, c1.magnitude.data(), c1.magnitude.size());
+    add_into(r + 2 * k, 2 * n - 2 * k, c2.magnitude.data(), c2.magnitude.size());
+    add_into(r + 3 * k, 2 * n - 3 * k, c3.magnitude.data(), c3.magnitude.size());
+}
+
+/**
+ * r[0..an+bn) = a * b for operands of any sizes, by whichever algorithm
+ * the thresholds pick for the shorter one; a == b with an == bn is a
+ * square. A much longer operand is cut into slices the size of the
+ * shorter one, so every product is balanced.
+ */
+void mul_limbs(limb* r, const limb* a, size_t an, const limb* b, size_t bn, unsigned int num_threads) {
+    if (an < bn) {
+        swap(a, b);
+        swap(an, bn);
+    }
+    if (a == b && an == bn) {
+        if (an < thresholds.karatsuba_sqr) {
+            // full ADX rows beat the half-size portable ones
+            if (has_fixed_kernel(an) && using_adx_kernels()) {
+                mul_fixed(r, a, a, an);
+            }
+            else {
+                sqr_basecase(r, a, an);
+            }
+        }
+        else if (an < thresholds.toom3_sqr) {
+            mul_karatsuba(r, a, a, an, num_threads);
+        }
+        else {
+            mul_toom3(r, a, a, an, num_threads);
+        }
+        return;
+    }
+    if (bn < thresholds.karatsuba) {
+        if (an == bn && has_fixed_kernel(an)) {
+            mul_fixed(r, a, b, an);
+            return;
+        }
+        mul_basecase(r, a, an, b, bn);
+        return;
+    }
+    if (an == bn) {
+        if (an < thresholds.toom3) {
+            mul_karatsuba(r, a, b, an, num_threads);
+        }
+        else {
+            mul_toom3(r, a, b, an, num_threads);
+        }
+        return;
+    }
+
+    fill(r, r + an + bn, limb(0));
+    vector<limb> part(2 * bn);
+    for (size_t offset = 0; offset < an; offset += bn) {
+        size_t length = min(bn, an - offset);
+        mul_limbs(part.data(), a + offset, length, b, bn, num_threads);
+        add_into(r + offset, an + bn - offset, part.data(), length + bn);
+    }
+}
+
+/**
+ * Multiplies two integers, by schoolbook for short operands and Karatsuba
+ * or Toom-3 for long ones. Squaring a number through mul(a, a) takes the
+ * squaring routines too.
+ *
+ * @param a the first factor
+ * @param b the second factor
+ * @param num_threads threads for the top levels of long products, 0 for
+ *        one per core
+ * @return a * b
+ */
+bigint mul(const bigint& a, const bigint& b, unsigned int num_threads) {
+    bigint r;
+    if (a.limbs.empty() || b.limbs.empty()) {
+        return r;
+    }
+    num_threads = parallel::thread_count(num_threads);
+
+    r.limbs.resize(a.limbs.size() + b.limbs.size());
+    mul_limbs(r.limbs.data(), a.limbs.data(), a.limbs.size(), b.limbs.data(), b.limbs.size(), num_threads);
+    r.limbs.resize(trimmed_length(r.limbs.data(), r.limbs.size()));
+    return r;
+}
+
+/**
+ * Squares an integer, with about half the limb products of a schoolbook
+ * multiplication for short operands and one evaluation instead of two at
+ * each Karatsuba or Toom-3 level.
+ *
+ * @param a the number
+ * @param num_threads threads for the top levels of long squares, 0 for one
+ *        per core
+ * @return a^2
+ */
+bigint sqr(const bigint& a, unsigned int num_threads) {
+    return mul(a, a, num_threads);
+}
+
+} // namespace mp
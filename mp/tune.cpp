@@ -0,0 +1,105 @@
+// tune.cpp : Finds the multiplication thresholds by timing the algorithms
+// against each other on this machine.
+//
+#include "bigint.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using namespace std;
+
+namespace mp {
+
+// Thresholds that keep an algorithm out of the way while another is timed
+const size_t NEVER = numeric_limits<size_t>::max() / 4;
+
+// Each timing is the best of this many runs, each at least this long
+const int TUNE_RUNS = 5;
+const double TUNE_RUN_SECONDS = 0.002;
+
+/**
+ * @return the best time in seconds of one multiplication (or squaring,
+ *         with square set) of n-limb operands under the given thresholds
+ */
+double time_mul(size_t n, const mul_thresholds& t, bool square) {
+    bigint a;
+    bigint b;
+    for (size_t i = 0; i < n; ++i) {
+        a.limbs.push_back(0x9e3779b97f4a7c15ULL * (i + 1));
+        b.limbs.push_back(0xc2b2ae3d27d4eb4fULL * (i + 3));
+    }
+    set_mul_thresholds(t);
+
+    double best = numeric_limits<double>::max();
+    size_t reps = 1;
+    for (int run = 0; run < TUNE_RUNS; ++run) {
+        double seconds = 0;
+        while (true) {
+            auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < reps; ++i) {
+                bigint r = square ? sqr(a) : mul(a, b);
+                if (r.limbs.empty()) {
+                    return 0;
+                }
+            }
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (seconds >= TUNE_RUN_SECONDS) {
+                break;
+            }
+            reps *= 2;
+        }
+        best = min(best, seconds / reps);
+    }
+    return best;
+}
+
+/**
+ * @return the smallest size from which splitting once more beats the
+ *         algorithm below: field is the threshold being searched, with
+ *         field = n + 1 timing the old algorithm at size n and field = n
+ *         the new one on top of it. Two wins in a row are needed, against
+ *         timing noise.
+ */
+size_t find_crossover(mul_thresholds t, size_t mul_thresholds::*field, size_t from, size_t to, bool square) {
+    int wins = 0;
+    size_t first_win = to;
+    for (size_t n = from; n <= to; n += max<size_t>(1, n / 8)) {
+        t.*field = n + 1;
+        double below = time_mul(n, t, square);
+        t.*field = n;
+        double above = time_mul(n, t, square);
+        if (above < below) {
+            if (wins++ == 0) {
+                first_win = n;
+            }
+            if (wins == 2) {
+                return first_win;
+            }
+        }
+        else {
+            wins = 0;
+            first_win = to;
+        }
+    }
+    return first_win;
+}
+
+/**
+ * Times schoolbook against Karatsuba and Karatsuba against Toom-3, for
+ * products and for squares, and installs the crossovers found as the
+ * thresholds. Takes a few seconds; mp_tune prints the result so it can be
+ * built in as the default.
+ *
+ * @return the thresholds now in use
+ */
+mul_thresholds tune_mul_thresholds() {
+    mul_thresholds t = { NEVER, NEVER, NEVER, NEVER };
+    t.karatsuba = find_crossover(t, &mul_thresholds::karatsuba, 4, 256, false);
+    t.toom3 = find_crossover(t, &mul_thresholds::toom3, max<size_t>(t.karatsuba, 8), 1024, false);
+    t.karatsuba_sqr = find_crossover(t, &mul_thresholds::karatsuba_sqr, 4, 256, true);
+    t.toom3_sqr = find_crossover(t, &mul_thresholds::toom3_sqr, max<size_t>(t.karatsuba_sqr, 8), 1024, true);
+    set_mul_thresholds(t);
+    return get_mul_thresholds();
+}
+
+} // namespace mp
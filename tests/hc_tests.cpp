@@ -0,0 +1,119 @@
+// hc_tests.cpp : Round trips and thread-count agreement for the Hill cipher.
+//
+#include "HC.h"
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Spans several HILL_CHUNK_BLOCKS, so more than one worker gets a share
+const size_t SAMPLE_BLOCKS = 200000;
+
+shared_ptr<const hc::hill_key_schedule> sample_schedule() {
+    hc::hill_key_cache cache(1);
+    return cache.get("GYBNQKURP");
+}
+
+vector<int> sample_message() {
+    vector<int> message(3 * SAMPLE_BLOCKS);
+    for (size_t i = 0; i < message.size(); ++i) {
+        message[i] = static_cast<int>((i * 7 + i / 5) % 26);
+    }
+    return message;
+}
+
+/**
+ * @brief The key from the usual textbook example takes ACT to POH.
+ */
+bool check_known_block() {
+    auto schedule = sample_schedule();
+    if (!schedule) {
+        cerr << "  the key was rejected" << endl;
+        return false;
+    }
+    const int act[3] = { 0, 2, 19 };
+    int out[3];
+    hc::encrypt_hill_cipher(*schedule, act, out, 3);
+    return out[0] == 15 && out[1] == 14 && out[2] == 7;
+}
+
+/**
+ * @brief The table path gives the same bytes on one thread and on every
+ * core, and decrypts back to the message.
+ */
+bool check_table_threads() {
+    auto schedule = sample_schedule();
+    vector<int> message = sample_message();
+
+    bool ok = true;
+    vector<int> reference;
+    for (unsigned int threads : { 1u, 0u }) {
+        vector<int> encrypted(message.size());
+        vector<int> decrypted(message.size());
+        hc::encrypt_hill_cipher(*schedule, message.data(), encrypted.data(), message.size(), threads);
+        hc::decrypt_hill_cipher(*schedule, encrypted.data(), decrypted.data(), encrypted.size(), threads);
+        if (decrypted != message) {
+            cerr << "  threads = " << threads << " does not round trip" << endl;
+            ok = false;
+        }
+        if (reference.empty()) {
+            reference = encrypted;
+        }
+        else if (encrypted != reference) {
+            cerr << "  threads = " << threads << " differs from one thread" << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief The Armadillo matrix path agrees with the table path and round
+ * trips on one thread and on every core.
+ */
+bool check_matrix_threads() {
+    auto schedule = sample_schedule();
+    vector<int> message = sample_message();
+    vector<int> expected(message.size());
+    hc::encrypt_hill_cipher(*schedule, message.data(), expected.data(), message.size(), 1);
+
+    bool ok = true;
+    for (unsigned int threads : { 1u, 0u }) {
+        vector<int> encrypted(message.size());
+        vector<int> decrypted(message.size());
+        hc::encrypt_hill_cipher_parallel(message.data(), encrypted.data(), message.size(), schedule->key, threads);
+        hc::decrypt_hill_cipher_parallel(encrypted.data(), decrypted.data(), encrypted.size(),
+                                         schedule->inverse_key, threads);
+        if (encrypted != expected) {
+            cerr << "  threads = " << threads << " differs from the table path" << endl;
+            ok = false;
+        }
+        if (decrypted != message) {
+            cerr << "  threads = " << threads << " does not round trip" << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main()
+{
+    struct test {
+        const char* name;
+        bool (*run)();
+    };
+    const test tests[] = {
+        { "known_block", check_known_block },
+        { "table_threads", check_table_threads },
+        { "matrix_threads", check_matrix_threads },
+    };
+
+    size_t failed = 0;
+    for (const test& t : tests) {
+        bool ok = t.run();
+        cout << t.name << ": " << (ok ? "ok" : "FAILED") << endl;
+        failed += ok ? 0 : 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
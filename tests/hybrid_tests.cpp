@@ -0,0 +1,141 @@
+// hybrid_tests.cpp : Round trips and forged headers for hybrid encryption.
+//
+#include "hybrid.h"
+#include "EC.h"
+#include "keystore.h"
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief An EC record with keys drawn from a fixed seed.
+ */
+keystore::ec_record ec_key(ec::ec_curve curve, ec::ec_point P) {
+    uint32_t seed[8] = { 7 };
+    rng::chacha20_drbg random(seed);
+    return keystore::make_ec_record(curve, P, ec::generate_keys(curve, P, random));
+}
+
+string sample_plaintext() {
+    string text;
+    for (int i = 0; i < 200000; ++i) {
+        text.push_back(static_cast<char>(i * 131 + i / 7));
+    }
+    return text;
+}
+
+string encrypt_ec(const keystore::ec_record& ec, const string& plaintext) {
+    istringstream in(plaintext);
+    ostringstream out;
+    hybrid::encrypt(in, out, ec, 1);
+    return out.str();
+}
+
+/**
+ * @brief Decrypts a stream with only the EC key.
+ *
+ * @return Whether decrypt accepted the stream.
+ */
+bool decrypt_ec(const keystore::ec_record& ec, const string& stream, string& plaintext) {
+    istringstream in(stream);
+    ostringstream out;
+    string error;
+    bool ok = hybrid::decrypt(in, out, nullptr, &ec, nullptr, error, 1);
+    plaintext = out.str();
+    return ok;
+}
+
+/**
+ * @brief Writes C1 into the header of an encrypted stream.
+ */
+string with_c1(string stream, ec::ec_point C1) {
+    int32_t coordinates[2] = { C1.x, C1.y };
+    for (int i = 0; i < 2; ++i) {
+        uint32_t v = static_cast<uint32_t>(coordinates[i]);
+        for (int b = 0; b < 4; ++b) {
+            stream[12 + 4 * i + b] = static_cast<char>(v >> (24 - 8 * b));
+        }
+    }
+    return stream;
+}
+
+bool check_ec_round_trip() {
+    keystore::ec_record ec = ec_key({ 2, 10, 509 }, { 3, 68 });
+    string plaintext = sample_plaintext();
+    string decrypted;
+    return decrypt_ec(ec, encrypt_ec(ec, plaintext), decrypted) && decrypted == plaintext;
+}
+
+/**
+ * @brief A header whose C1 is off the curve, the point at infinity or out of
+ * range is refused before the private key touches it.
+ */
+bool check_ec_off_curve_header() {
+    keystore::ec_record ec = ec_key({ 2, 10, 509 }, { 3, 68 });
+    string stream = encrypt_ec(ec, sample_plaintext());
+    const ec::ec_point forged[] = { { 3, 69 }, { 0, 0 }, { -1, -1 }, { 3, 68 + 509 }, { -3, 68 } };
+
+    bool ok = true;
+    for (const ec::ec_point& C1 : forged) {
+        string decrypted;
+        if (decrypt_ec(ec, with_c1(stream, C1), decrypted)) {
+            cerr << "  accepted C1 = (" << C1.x << ", " << C1.y << ")" << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @brief On a curve of order 18 with P of order 6, a C1 on the curve but
+ * outside the group of P is refused too.
+ */
+bool check_ec_outside_subgroup_header() {
+    ec::ec_curve curve = { 0, 7, 17 };
+    ec::ec_point P = { 8, 3 };
+    keystore::ec_record ec = ec_key(curve, P);
+    string stream = encrypt_ec(ec, sample_plaintext());
+    int n = ec::point_order(P, curve);
+
+    int outside = 0;
+    bool ok = true;
+    for (int x = 0; x < curve.p; ++x) {
+        for (int y = 0; y < curve.p; ++y) {
+            ec::ec_point C1 = { x, y };
+            if (!ec::on_curve(C1, curve) || ec::is_infinity(ec::scalar_mult(C1, n, curve))) {
+                continue;
+            }
+            ++outside;
+            string decrypted;
+            if (decrypt_ec(ec, with_c1(stream, C1), decrypted)) {
+                cerr << "  accepted C1 = (" << x << ", " << y << ")" << endl;
+                ok = false;
+            }
+        }
+    }
+    return ok && outside > 0;
+}
+
+int main()
+{
+    struct test {
+        const char* name;
+        bool (*run)();
+    };
+    const test tests[] = {
+        { "ec_round_trip", check_ec_round_trip },
+        { "ec_off_curve_header", check_ec_off_curve_header },
+        { "ec_outside_subgroup_header", check_ec_outside_subgroup_header },
+    };
+
+    size_t failed = 0;
+    for (const test& t : tests) {
+        bool ok = t.run();
+        cout << t.name << ": " << (ok ? "ok" : "FAILED") << endl;
+        failed += ok ? 0 : 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+// keyd_tests.cpp : Runs keyd against scripted clients.
+//
+//   keyd_tests KEYD
+//
+// KEYD is the path of the keyd executable. It is started on a socket of
+// its own with an RSA key and a long batch window, so every client below
+// connects and sends before its batch runs.
+//
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Long enough that a test's clients all get in before the batch runs
+const char* BATCH_US = "300000";
+const int TIMEOUT_MS = 5000;
+
+const uint8_t SCHEME_RSA = 1;
+const uint8_t OP_ENCRYPT = 1;
+const uint8_t OP_DECRYPT = 2;
+
+struct response {
+    uint32_t id;
+    uint8_t status;
+    string body;
+};
+
+void append_u32(string& out, uint32_t v) {
+    v = htonl(v);
+    out.append(reinterpret_cast<const char*>(&v), 4);
+}
+
+uint32_t read_u32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return ntohl(v);
+}
+
+string frame(uint32_t id, uint8_t scheme, uint8_t op, const vector<uint32_t>& values) {
+    string body;
+    for (uint32_t v : values) {
+        append_u32(body, v);
+    }
+    string out;
+    append_u32(out, static_cast<uint32_t>(6 + body.size()));
+    append_u32(out, id);
+    out.push_back(static_cast<char>(scheme));
+    out.push_back(static_cast<char>(op));
+    return out + body;
+}
+
+/**
+ * @brief Connects to the server, retrying while it starts up.
+ *
+ * @return The socket, or -1 if the server never listened.
+ */
+int connect_to(const string& path) {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+bool send_all(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Reads exactly length bytes, giving up after TIMEOUT_MS.
+ *
+ * @return False on timeout, error or end of stream.
+ */
+bool recv_exact(int fd, char* out, size_t length) {
+    size_t got = 0;
+    while (got < length) {
+        pollfd p = { fd, POLLIN, 0 };
+        if (poll(&p, 1, TIMEOUT_MS) <= 0) {
+            return false;
+        }
+        ssize_t n = recv(fd, out + got, length - got, 0);
+        if (n <= 0) {
+            return false;
+        }
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_response(int fd, response& r) {
+    char header[10];
+    if (!recv_exact(fd, header, sizeof(header))) {
+        return false;
+    }
+    uint32_t length = read_u32(header);
+    r.id = read_u32(header + 4);
+    r.status = static_cast<uint8_t>(header[9]);
+    r.body.assign(length - 6, '\0');
+    return length == 6 || recv_exact(fd, &r.body[0], length - 6);
+}
+
+/**
+ * @brief Waits for the server to close a connection.
+ */
+bool wait_closed(int fd) {
+    char byte;
+    while (true) {
+        pollfd p = { fd, POLLIN, 0 };
+        if (poll(&p, 1, TIMEOUT_MS) <= 0) {
+            return false;
+        }
+        ssize_t n = recv(fd, &byte, 1, 0);
+        if (n <= 0) {
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief A client whose connection fails with requests in flight is
+ * followed by one that gets the same fd number. The new client must get
+ * only its own answers, not the dropped client's decryptions.
+ */
+bool check_dropped_client(const string& path) {
+    int dropped = connect_to(path);
+    if (dropped < 0) {
+        cerr << "  cannot connect" << endl;
+        return false;
+    }
+    // two good frames, then a length below the header size, all in one
+    // write: the server queues the first two and then fails the connection
+    string data = frame(100, SCHEME_RSA, OP_DECRYPT, { 42 }) + frame(101, SCHEME_RSA, OP_DECRYPT, { 43 });
+    append_u32(data, 0);
+    bool ok = send_all(dropped, data) && wait_closed(dropped);
+    close(dropped);
+    if (!ok) {
+        cerr << "  the server did not close the malformed connection" << endl;
+        return false;
+    }
+
+    // one request in each op, so whichever group the server answers first
+    // would carry a stray answer
+    int fresh = connect_to(path);
+    string requests = frame(1, SCHEME_RSA, OP_ENCRYPT, { 7 }) + frame(2, SCHEME_RSA, OP_DECRYPT, { 7 });
+    if (fresh < 0 || !send_all(fresh, requests)) {
+        cerr << "  cannot send on the new connection" << endl;
+        return false;
+    }
+    ok = true;
+    for (int i = 0; i < 2 && ok; ++i) {
+        response r;
+        if (!read_response(fresh, r)) {
+            cerr << "  no response on the new connection" << endl;
+            ok = false;
+        }
+        else if (r.id != 1 && r.id != 2) {
+            cerr << "  the new connection got the answer to request " << r.id << endl;
+            ok = false;
+        }
+        else if (r.status != 0 || r.body.size() != 4) {
+            cerr << "  request " << r.id << " failed" << endl;
+            ok = false;
+        }
+    }
+    close(fresh);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        cerr << "usage: keyd_tests KEYD" << endl;
+        return 1;
+    }
+
+    string path = "/tmp/keyd_tests." + to_string(getpid()) + ".sock";
+    pid_t server = fork();
+    if (server == 0) {
+        execl(argv[1], argv[1], "--socket", path.c_str(), "--rsa", "61", "53", "--batch-us", BATCH_US,
+              static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    struct test {
+        const char* name;
+        bool (*run)(const string&);
+    };
+    const test tests[] = {
+        { "dropped_client", check_dropped_client },
+    };
+
+    size_t failed = 0;
+    for (const test& t : tests) {
+        bool ok = t.run(path);
+        cout << t.name << ": " << (ok ? "ok" : "FAILED") << endl;
+        failed += ok ? 0 : 1;
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+    return failed == 0 ? 0 : 1;
+}
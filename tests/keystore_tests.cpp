@@ -0,0 +1,233 @@
+// keystore_tests.cpp : Round trips and damaged files for the binary keystore.
+//
+// Each damaged file is a good one written by write_keystore with one field
+// or its length changed, so open must fail on exactly that check.
+//
+#include "keystore.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+
+string store_path() {
+    return "/tmp/keystore_tests." + to_string(getpid()) + ".ks";
+}
+
+/**
+ * @brief The textbook RSA key n = 61 * 53 and an EC key on y^2 = x^3 + 2x + 10
+ * mod 509.
+ */
+void sample_records(keystore::rsa_record& rsa, keystore::ec_record& ec) {
+    rsa = keystore::make_rsa_record(61, 53, 17, 2753);
+    ec::ec_curve curve = { 2, 10, 509 };
+    ec::ec_point P = { 3, 68 };
+    uint32_t seed[8] = { 11 };
+    rng::chacha20_drbg random(seed);
+    ec = keystore::make_ec_record(curve, P, ec::generate_keys(curve, P, random));
+}
+
+/**
+ * @brief The bytes of a freshly written keystore holding the sample records.
+ */
+string sample_image() {
+    keystore::rsa_record rsa;
+    keystore::ec_record ec;
+    sample_records(rsa, ec);
+    string path = store_path();
+    if (!keystore::write_keystore(path, &rsa, &ec, nullptr)) {
+        return string();
+    }
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Writes image to disk and tries to open it.
+ *
+ * @return Whether open accepted the file.
+ */
+bool opens(const string& image, string& error) {
+    string path = store_path();
+    {
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(image.data(), static_cast<streamsize>(image.size()));
+    }
+    keystore::mapped_keystore store;
+    error.clear();
+    bool ok = store.open(path, error);
+    remove(path.c_str());
+    return ok;
+}
+
+/**
+ * @brief Checks that open refuses image and reports why.
+ */
+bool rejects(const string& image, const char* what) {
+    string error;
+    if (opens(image, error)) {
+        cerr << "  accepted " << what << endl;
+        return false;
+    }
+    if (error.empty()) {
+        cerr << "  no error message for " << what << endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+void put(string& image, size_t offset, T value) {
+    memcpy(&image[offset], &value, sizeof(value));
+}
+
+template <typename T>
+T get(const string& image, size_t offset) {
+    T value;
+    memcpy(&value, &image[offset], sizeof(value));
+    return value;
+}
+
+size_t section_entry(size_t i) {
+    return sizeof(keystore::keystore_header) + i * sizeof(keystore::keystore_section);
+}
+
+/**
+ * @return The file offset of the EC record in a sample image.
+ */
+size_t ec_record_offset(const string& image) {
+    for (size_t i = 0; i < 2; ++i) {
+        size_t entry = section_entry(i);
+        if (get<uint32_t>(image, entry + offsetof(keystore::keystore_section, type)) == keystore::SECTION_EC) {
+            return static_cast<size_t>(get<uint64_t>(image, entry + offsetof(keystore::keystore_section, offset)));
+        }
+    }
+    return 0;
+}
+
+bool check_round_trip() {
+    keystore::rsa_record rsa;
+    keystore::ec_record ec;
+    sample_records(rsa, ec);
+    string path = store_path();
+    if (!keystore::write_keystore(path, &rsa, &ec, nullptr)) {
+        cerr << "  cannot write " << path << endl;
+        return false;
+    }
+
+    keystore::mapped_keystore store;
+    string error;
+    bool ok = store.open(path, error);
+    if (!ok) {
+        cerr << "  " << error << endl;
+    }
+    else {
+        ok = store.rsa() && memcmp(store.rsa(), &rsa, sizeof(rsa)) == 0 && store.ec() &&
+             memcmp(store.ec(), &ec, sizeof(ec)) == 0 && !store.hill() && !store.x25519();
+        if (!ok) {
+            cerr << "  the mapped records differ from the written ones" << endl;
+        }
+    }
+    store.close();
+    remove(path.c_str());
+    return ok;
+}
+
+bool check_wrong_magic() {
+    string image = sample_image();
+    image[offsetof(keystore::keystore_header, magic)] ^= 0x20;
+    return rejects(image, "a wrong magic");
+}
+
+bool check_wrong_version() {
+    string image = sample_image();
+    put<uint32_t>(image, offsetof(keystore::keystore_header, version), keystore::KEYSTORE_VERSION + 1);
+    return rejects(image, "a newer version");
+}
+
+bool check_truncated() {
+    string image = sample_image();
+    return rejects(image.substr(0, image.size() - 1), "a file one byte short") &&
+           rejects(image.substr(0, sizeof(keystore::keystore_header) / 2), "half a header") &&
+           rejects(string(), "an empty file");
+}
+
+/**
+ * @brief A section starting at or past the end of the file, or whose offset
+ * is so large that adding the record size wraps, is refused.
+ */
+bool check_section_past_eof() {
+    string image = sample_image();
+    size_t offset = section_entry(1) + offsetof(keystore::keystore_section, offset);
+
+    string past_end = image;
+    put<uint64_t>(past_end, offset, image.size());
+    string wrapping = image;
+    put<uint64_t>(wrapping, offset, UINT64_MAX - keystore::KEYSTORE_ALIGN + 1);
+    string too_many = image;
+    put<uint32_t>(too_many, offsetof(keystore::keystore_header, section_count), 1000);
+
+    return rejects(past_end, "a section at the end of the file") &&
+           rejects(wrapping, "a section offset that wraps") &&
+           rejects(too_many, "a directory past the end of the file");
+}
+
+/**
+ * @brief The EC table size must lie in [0, EC_TABLE_SIZE].
+ */
+bool check_table_size() {
+    string image = sample_image();
+    size_t offset = ec_record_offset(image) + offsetof(keystore::ec_record, table_size);
+    if (offset == offsetof(keystore::ec_record, table_size)) {
+        cerr << "  no EC section" << endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (int32_t size : { -1, keystore::EC_TABLE_SIZE + 1, INT32_MIN }) {
+        string bad = image;
+        put<int32_t>(bad, offset, size);
+        ok = rejects(bad, ("table_size " + to_string(size)).c_str()) && ok;
+    }
+    for (int32_t size : { 0, keystore::EC_TABLE_SIZE }) {
+        string good = image;
+        put<int32_t>(good, offset, size);
+        string error;
+        if (!opens(good, error)) {
+            cerr << "  refused table_size " << size << ": " << error << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main()
+{
+    struct test {
+        const char* name;
+        bool (*run)();
+    };
+    const test tests[] = {
+        { "round_trip", check_round_trip },
+        { "wrong_magic", check_wrong_magic },
+        { "wrong_version", check_wrong_version },
+        { "truncated", check_truncated },
+        { "section_past_eof", check_section_past_eof },
+        { "table_size", check_table_size },
+    };
+
+    size_t failed = 0;
+    for (const test& t : tests) {
+        bool ok = t.run();
+        cout << t.name << ": " << (ok ? "ok" : "FAILED") << endl;
+        failed += ok ? 0 : 1;
+    }
+    return failed == 0 ? 0 : 1;
+}